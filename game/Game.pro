@@ -0,0 +1,11 @@
+TEMPLATE = subdirs
+
+#Simulation library, GLUT front end and headless runner
+SUBDIRS = game_sim tank_assignment headless
+
+game_sim.file = game_sim/GameSim.pro
+tank_assignment.file = tank_assignment/TankAssignment.pro
+headless.file = headless/Headless.pro
+
+tank_assignment.depends = game_sim
+headless.depends = game_sim
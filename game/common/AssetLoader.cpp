@@ -0,0 +1,94 @@
+#include "AssetLoader.h"
+
+//! Constructor
+AssetLoader::AssetLoader(int workerCount) : outstanding(0), quit(false)
+{
+	if(workerCount < 1) workerCount = 1;
+	for(int k = 0; k < workerCount; k++)
+		workers.push_back(std::thread(&AssetLoader::run, this));
+}
+
+//! Destructor
+AssetLoader::~AssetLoader()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	wake.notify_all();
+	for(size_t k = 0; k < workers.size(); k++)
+		workers[k].join();
+}
+
+// Hardware threads
+int AssetLoader::getDefaultWorkerCount()
+{
+	int count = (int)std::thread::hardware_concurrency();
+	return count > 0 ? count : 1;
+}
+
+// Number of workers
+int AssetLoader::getWorkerCount() const
+{
+	return (int)workers.size();
+}
+
+// Queue job
+void AssetLoader::add(Job * job)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		queued.push_back(job);
+		outstanding++;
+	}
+	wake.notify_one();
+}
+
+// Wait for next loaded job
+AssetLoader::Job * AssetLoader::next()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	if(outstanding == 0) return NULL;
+	while(loaded.empty()) done.wait(lock);
+
+	Job * job = loaded.front();
+	loaded.pop_front();
+	outstanding--;
+	return job;
+}
+
+// Upload jobs as they finish
+int AssetLoader::uploadAll()
+{
+	int uploaded = 0;
+	for(Job * job = next(); job; job = next())
+	{
+		job->upload();
+		uploaded++;
+	}
+	return uploaded;
+}
+
+// Worker main loop
+void AssetLoader::run()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while(true)
+	{
+		while(!quit && queued.empty()) wake.wait(lock);
+
+		// Queued jobs are dropped once stopping, only the ones being loaded are waited for
+		if(quit) return;
+
+		Job * job = queued.front();
+		queued.pop_front();
+
+		// Files are read without holding the lock
+		lock.unlock();
+		job->load();
+		lock.lock();
+
+		loaded.push_back(job);
+		done.notify_one();
+	}
+}
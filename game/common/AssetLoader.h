@@ -0,0 +1,83 @@
+#ifndef ASSETLOADER_H_
+#define ASSETLOADER_H_
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Pool of worker threads loading assets at startup.
+ * Each job is read and decoded on a worker, then handed back to the thread that owns the OpenGL context,
+ * which uploads jobs in the order they finish while the workers carry on with the rest.
+ */
+class AssetLoader
+{
+
+public:
+
+	/**
+	 * One asset, split into the work a worker can do and the OpenGL calls that must stay on the context thread
+	 */
+	class Job
+	{
+
+	public:
+
+		//! Destructor
+		virtual ~Job(){};
+
+		//! Read and decode files, runs on a worker without OpenGL
+		virtual void load() = 0;
+
+		//! Create OpenGL objects from what load produced, runs on the thread calling next
+		virtual void upload() = 0;
+
+	};
+
+	//! Constructor, starts workerCount threads, at least one
+	AssetLoader(int workerCount);
+
+	//! Destructor, waits for the jobs being loaded and stops the workers
+	~AssetLoader();
+
+	//! Hardware threads, or one when unknown
+	static int getDefaultWorkerCount();
+
+	//! Number of workers
+	int getWorkerCount() const;
+
+	//! Queue job for loading, it must stay alive until next has returned it
+	void add(Job * job);
+
+	//! Wait for the next loaded job, NULL once every job added has been returned
+	Job * next();
+
+	//! Upload every job as it finishes, returns the number uploaded
+	int uploadAll();
+
+private:
+
+	//! Not copyable
+	AssetLoader(const AssetLoader &);
+	void operator=(const AssetLoader &);
+
+	//! Worker main loop
+	void run();
+
+private:
+
+	//! Worker state, guarded by mutex
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	std::deque<Job *> queued;
+	std::deque<Job *> loaded;
+	int outstanding;
+	bool quit;
+
+};
+
+#endif
@@ -0,0 +1,340 @@
+#include "BatchSim.h"
+
+#include <math.h>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+// Runtime check for AVX2 support in CPU and OS
+bool cpuSupportsAVX2()
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	int info[4];
+	__cpuid(info, 0);
+	if(info[0] < 7) return false;
+
+	// AVX enabled by the OS for YMM registers
+	__cpuid(info, 1);
+	if((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0) return false;
+	if((_xgetbv(0) & 6) != 6) return false;
+
+	// AVX2 feature bit
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return false;
+#endif
+}
+
+// Integrate tanks, same arithmetic as GameSim::updateTank
+void updateTanksScalar(const TankArrays & tanks, int begin, int end, float timeStep)
+{
+	for(int w = begin; w < end; w++)
+	{
+		if(tanks.gameOver[w]) continue;
+
+		// Tank direction
+		float angle = tanks.angle[w];
+		float directionX = sinf(degreesToRadians(angle));
+		float directionZ = cosf(degreesToRadians(angle));
+
+		// Total tank acceleration according to driving, braking, and friction
+		float velocity = tanks.velocity[w];
+		float totalAcceleration = 0;
+		if(tanks.accelerate[w]) totalAcceleration += tankAcceleration;
+		if(tanks.decelerate[w]) totalAcceleration -= tankDeceleration;
+		if(velocity < 0) totalAcceleration += tankFriction;
+		if(velocity > 0) totalAcceleration -= tankFriction;
+
+		// Update and limit tank velocity
+		velocity += totalAcceleration * timeStep;
+		if(velocity > tankMaxVelocity) velocity = tankMaxVelocity;
+		if(velocity < -tankMaxVelocity) velocity = -tankMaxVelocity;
+		if(fabsf(velocity) < 1) velocity = 0;
+
+		// Update tank angle according to turning and forward/backward motion
+		float tankOmega = 0;
+		if(tanks.turnLeft[w]) tankOmega += tankTurningRate;
+		if(tanks.turnRight[w]) tankOmega -= tankTurningRate;
+		if(velocity < 0) angle -= tankOmega * timeStep;
+		if(velocity > 0) angle += tankOmega * timeStep;
+
+		// Update tank falling velocity
+		if(tanks.falling[w])
+		{
+			tanks.fallVelocity[w] += gravity * timeStep;
+			tanks.fallingTime[w] += timeStep;
+		}
+
+		// Update tank position and distance travelled
+		tanks.positionX[w] = tanks.positionX[w] + directionX * velocity * timeStep;
+		tanks.positionY[w] = tanks.positionY[w] + tanks.fallVelocity[w] * timeStep;
+		tanks.positionZ[w] = tanks.positionZ[w] + directionZ * velocity * timeStep;
+		tanks.distanceTravelled[w] += velocity * timeStep;
+
+		tanks.velocity[w] = velocity;
+		tanks.angle[w] = angle;
+	}
+}
+
+//! Constructor
+BatchSim::BatchSim(int worldCount)
+: tankPositionX(worldCount), tankPositionY(worldCount), tankPositionZ(worldCount),
+  tankVelocity(worldCount), tankAngle(worldCount), tankFallVelocity(worldCount),
+  tankFallingTime(worldCount), tankDistanceTravelled(worldCount), tankFalling(worldCount),
+  tankAccelerating(worldCount), tankDecelerating(worldCount),
+  tankTurningLeft(worldCount), tankTurningRight(worldCount),
+  shoot(worldCount), turretPan(worldCount),
+  shooting(worldCount),
+  ballPositionX(worldCount), ballPositionY(worldCount), ballPositionZ(worldCount),
+  ballVelocityX(worldCount), ballVelocityY(worldCount), ballVelocityZ(worldCount),
+  timeRemaining(worldCount), collectedCoins(worldCount), gameOver(worldCount), gameOverMessage(worldCount),
+  worldCount(worldCount), mazes(worldCount), turretHeight(defaultTurretHeight), useAVX2(cpuSupportsAVX2())
+{
+	restart();
+}
+
+// Load maze from file, shared layout for all worlds
+bool BatchSim::loadMaze(std::string filename)
+{
+	// Reuse the single world loader
+	GameSim loader;
+	if(!loader.loadMaze(filename)) return false;
+	loader.restart();
+
+	initialMaze = loader.getWorld().maze;
+	return true;
+}
+
+// Reset all worlds to the start of a game
+void BatchSim::restart()
+{
+	for(int w = 0; w < worldCount; w++) restart(w);
+}
+
+// Reset one world to the start of a game
+void BatchSim::restart(int w)
+{
+	// Reset maze
+	mazes[w] = initialMaze;
+
+	// Reset tank
+	tankPositionX[w] = cubeSize * (initialMaze.getCols() - 1);
+	tankPositionY[w] = -0.5f;
+	tankPositionZ[w] = cubeSize * 0;
+	tankDistanceTravelled[w] = 0;
+	tankAngle[w] = -90;
+	tankVelocity[w] = 0;
+	tankFallVelocity[w] = 0;
+	tankFallingTime[w] = 0;
+	tankAccelerating[w] = false;
+	tankDecelerating[w] = false;
+	tankTurningLeft[w] = false;
+	tankTurningRight[w] = false;
+	tankFalling[w] = false;
+
+	// Reset game
+	timeRemaining[w] = gameDuration;
+	collectedCoins[w] = 0;
+	shoot[w] = false;
+	shooting[w] = false;
+	gameOver[w] = false;
+	gameOverMessage[w] = "";
+}
+
+// Set inputs of one world for the next step
+void BatchSim::setInputs(int w, const Inputs & inputs)
+{
+	tankAccelerating[w] = inputs.accelerate;
+	tankDecelerating[w] = inputs.decelerate;
+	tankTurningLeft[w] = inputs.turnLeft;
+	tankTurningRight[w] = inputs.turnRight;
+	shoot[w] = inputs.shoot;
+	turretPan[w] = inputs.turretPan;
+}
+
+// Advance all worlds by one step, in the same order as GameSim::step
+void BatchSim::step(float timeStep)
+{
+	// Without worlds the arrays are empty and have no first element to point at
+	if(worldCount == 0) return;
+
+	// Shoot balls
+	for(int w = 0; w < worldCount; w++)
+	{
+		if(shoot[w] && !gameOver[w]) shootBall(w);
+	}
+
+	// Integrate tanks of running worlds
+	TankArrays tanks;
+	tanks.positionX = &tankPositionX[0];
+	tanks.positionY = &tankPositionY[0];
+	tanks.positionZ = &tankPositionZ[0];
+	tanks.velocity = &tankVelocity[0];
+	tanks.angle = &tankAngle[0];
+	tanks.fallVelocity = &tankFallVelocity[0];
+	tanks.fallingTime = &tankFallingTime[0];
+	tanks.distanceTravelled = &tankDistanceTravelled[0];
+	tanks.accelerate = &tankAccelerating[0];
+	tanks.decelerate = &tankDecelerating[0];
+	tanks.turnLeft = &tankTurningLeft[0];
+	tanks.turnRight = &tankTurningRight[0];
+	tanks.falling = &tankFalling[0];
+	tanks.gameOver = &gameOver[0];
+	if(useAVX2)
+		updateTanksAVX2(tanks, 0, worldCount, timeStep);
+	else
+		updateTanksScalar(tanks, 0, worldCount, timeStep);
+
+	// Per-world collisions, ball and timer
+	for(int w = 0; w < worldCount; w++)
+	{
+		if(!gameOver[w])
+		{
+			// Losing condition
+			if(tankFalling[w] && tankFallingTime[w] > 0.6f) endGame(w, "YOU LOSE!");
+
+			// Collision detection between coins and tank top
+			collideCoins(w, tankPositionX[w], tankPositionY[w] + turretHeight, tankPositionZ[w]);
+
+			// If tank position is not over block, it should fall
+			int i = (int)floorf(tankPositionZ[w] / cubeSize + 0.5f);
+			int j = (int)floorf(tankPositionX[w] / cubeSize + 0.5f);
+			if(!isBlock(i, j)) tankFalling[w] = true;
+		}
+
+		updateBall(w, timeStep);
+
+		if(!gameOver[w])
+		{
+			// Update timer
+			timeRemaining[w] -= timeStep;
+
+			// Losing condition
+			if(timeRemaining[w] < 0)
+			{
+				timeRemaining[w] = 0;
+				endGame(w, "YOU LOSE!");
+			}
+		}
+	}
+}
+
+// Use AVX2 kernel when supported
+bool BatchSim::setSIMD(bool enable)
+{
+	useAVX2 = enable && cpuSupportsAVX2();
+	return useAVX2;
+}
+
+// Number of worlds
+int BatchSim::getWorldCount() const
+{
+	return worldCount;
+}
+
+// Turret height used for muzzle and coin pickup
+void BatchSim::setTurretHeight(float height)
+{
+	turretHeight = height;
+}
+
+// Checking for blocks, shared by all worlds
+bool BatchSim::isBlock(int i, int j) const
+{
+	return initialMaze.isBlock(i, j);
+}
+
+// Colliding coins in a world
+void BatchSim::collideCoins(int w, float x, float y, float z)
+{
+	// Coins close to position, only cells around it are visited
+	int hitRows[coinQueryMax], hitCols[coinQueryMax];
+	int found = mazes[w].queryTargets(Vector3f(x, y, z), coinPickupRadius, cubeSize, coinHeight, hitRows, hitCols, coinQueryMax);
+
+	collectCoins(w, hitRows, hitCols, found);
+}
+
+// Colliding coins in a world along a path
+void BatchSim::sweepCoins(int w, Vector3f start, Vector3f end)
+{
+	// Collected coins are gone from the maze, so repeat until a sweep comes back short
+	int hitRows[coinQueryMax], hitCols[coinQueryMax];
+	int found;
+	do
+	{
+		found = mazes[w].sweepTargets(start, end, coinPickupRadius, cubeSize, coinHeight, hitRows, hitCols, coinQueryMax);
+		collectCoins(w, hitRows, hitCols, found);
+	}
+	while(found == coinQueryMax);
+}
+
+// Collecting found coins in a world
+void BatchSim::collectCoins(int w, const int * hitRows, const int * hitCols, int found)
+{
+	for(int k = 0; k < found; k++)
+	{
+		// Remove target
+		mazes[w].removeTarget(hitRows[k], hitCols[k]);
+		collectedCoins[w]++;
+
+		// Winning condition
+		if(collectedCoins[w] == initialMaze.countTargets()) endGame(w, "YOU WIN!");
+	}
+}
+
+// Shooting ball in a world
+void BatchSim::shootBall(int w)
+{
+	// One ball at time
+	if(shooting[w]) return;
+
+	// Initial ball velocity in turret direction
+	float turretAngle = radiansToDegrees(turretPan[w]) + 90;
+	float ballAngle = tankAngle[w] + turretAngle;
+	Vector3f ballDirection(sinf(degreesToRadians(ballAngle)), 0, cosf(degreesToRadians(ballAngle)));
+	Vector3f ballVelocity = ballDirection * ballSpeed;
+
+	// Initial ball position at turret muzzle
+	Vector3f ballPosition = Vector3f(tankPositionX[w], tankPositionY[w], tankPositionZ[w]) + ballDirection * 4;
+	ballPosition.y += turretHeight;
+
+	ballPositionX[w] = ballPosition.x;
+	ballPositionY[w] = ballPosition.y;
+	ballPositionZ[w] = ballPosition.z;
+	ballVelocityX[w] = ballVelocity.x;
+	ballVelocityY[w] = ballVelocity.y;
+	ballVelocityZ[w] = ballVelocity.z;
+	shooting[w] = true;
+}
+
+// Updating ball variables in a world
+void BatchSim::updateBall(int w, float timeStep)
+{
+	if(!shooting[w]) return;
+
+	// Falling under gravity
+	Vector3f previousPosition(ballPositionX[w], ballPositionY[w], ballPositionZ[w]);
+	ballVelocityY[w] += gravity * timeStep;
+	ballPositionX[w] = ballPositionX[w] + ballVelocityX[w] * timeStep;
+	ballPositionY[w] = ballPositionY[w] + ballVelocityY[w] * timeStep;
+	ballPositionZ[w] = ballPositionZ[w] + ballVelocityZ[w] * timeStep;
+
+	// End of falling
+	if(ballPositionY[w] < 0) shooting[w] = false;
+
+	// Collision detection between coins and the path of the ball this step
+	sweepCoins(w, previousPosition, Vector3f(ballPositionX[w], ballPositionY[w], ballPositionZ[w]));
+}
+
+// Finish game in a world with message
+void BatchSim::endGame(int w, const char * message)
+{
+	gameOver[w] = true;
+	gameOverMessage[w] = message;
+}
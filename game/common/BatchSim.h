@@ -0,0 +1,143 @@
+#ifndef BATCHSIM_H_
+#define BATCHSIM_H_
+
+#include <GameSim.h>
+#include <string>
+#include <vector>
+
+/**
+ * Per-world tank arrays handed to the tick kernels
+ */
+struct TankArrays
+{
+	float * positionX;
+	float * positionY;
+	float * positionZ;
+	float * velocity;
+	float * angle;
+	float * fallVelocity;
+	float * fallingTime;
+	float * distanceTravelled;
+	const unsigned char * accelerate;
+	const unsigned char * decelerate;
+	const unsigned char * turnLeft;
+	const unsigned char * turnRight;
+	const unsigned char * falling;
+	const unsigned char * gameOver;
+};
+
+//! Integrate tanks of worlds [begin, end), scalar reference path
+void updateTanksScalar(const TankArrays & tanks, int begin, int end, float timeStep);
+
+//! Integrate tanks of worlds [begin, end) eight at a time, only call when cpuSupportsAVX2()
+void updateTanksAVX2(const TankArrays & tanks, int begin, int end, float timeStep);
+
+//! Runtime check for AVX2 support in CPU and OS
+bool cpuSupportsAVX2();
+
+/**
+ * Many independent games stepped together, per-world state kept as structure of arrays
+ */
+class BatchSim
+{
+
+public:
+
+	//! Constructor
+	BatchSim(int worldCount);
+
+	//! Load maze from file, shared layout for all worlds
+	bool loadMaze(std::string filename);
+
+	//! Reset all worlds to the start of a game
+	void restart();
+
+	//! Reset one world to the start of a game
+	void restart(int world);
+
+	//! Set inputs of one world for the next step
+	void setInputs(int world, const Inputs & inputs);
+
+	//! Advance all worlds by one step
+	void step(float timeStep);
+
+	//! Use AVX2 kernel when supported, returns whether it is in use
+	bool setSIMD(bool enable);
+
+	//! Number of worlds
+	int getWorldCount() const;
+
+	//! Turret height used for muzzle and coin pickup
+	void setTurretHeight(float height);
+
+public:
+
+	//! Tank variables
+	std::vector<float> tankPositionX, tankPositionY, tankPositionZ;
+	std::vector<float> tankVelocity;
+	std::vector<float> tankAngle;
+	std::vector<float> tankFallVelocity;
+	std::vector<float> tankFallingTime;
+	std::vector<float> tankDistanceTravelled;
+	std::vector<unsigned char> tankFalling;
+
+	//! Inputs for the next step
+	std::vector<unsigned char> tankAccelerating, tankDecelerating;
+	std::vector<unsigned char> tankTurningLeft, tankTurningRight;
+	std::vector<unsigned char> shoot;
+	std::vector<float> turretPan;
+
+	//! Ball variables
+	std::vector<unsigned char> shooting;
+	std::vector<float> ballPositionX, ballPositionY, ballPositionZ;
+	std::vector<float> ballVelocityX, ballVelocityY, ballVelocityZ;
+
+	//! Game variables
+	std::vector<float> timeRemaining;
+	std::vector<int> collectedCoins;
+	std::vector<unsigned char> gameOver;
+	std::vector<const char *> gameOverMessage;
+
+private:
+
+	//! Checking for blocks, shared by all worlds
+	bool isBlock(int i, int j) const;
+
+	//! Colliding coins in a world
+	void collideCoins(int world, float x, float y, float z);
+
+	//! Colliding coins in a world along the path from start to end
+	void sweepCoins(int world, Vector3f start, Vector3f end);
+
+	//! Collecting found coins in a world
+	void collectCoins(int world, const int * hitRows, const int * hitCols, int found);
+
+	//! Shooting ball in a world
+	void shootBall(int world);
+
+	//! Updating ball variables in a world
+	void updateBall(int world, float timeStep);
+
+	//! Finish game in a world with message
+	void endGame(int world, const char * message);
+
+private:
+
+	//! Number of worlds
+	int worldCount;
+
+	//! Maze as loaded from file, blocks never change so all worlds test against it
+	MazeGrid initialMaze;
+
+	//! Maze of each world, targets are the coins left
+	std::vector<MazeGrid> mazes;
+
+	//! Turret height
+	float turretHeight;
+
+	//! AVX2 kernel in use
+	bool useAVX2;
+
+};
+
+#endif
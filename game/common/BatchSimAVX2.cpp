@@ -0,0 +1,152 @@
+#include "BatchSim.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+
+#include <immintrin.h>
+#include <math.h>
+
+// GCC and Clang need AVX2 enabled per function, MSVC accepts the intrinsics as is
+#if defined(__GNUC__)
+#define AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define AVX2_TARGET
+#endif
+
+// Load eight byte flags as lane masks
+AVX2_TARGET static inline __m256 loadFlags(const unsigned char * flags)
+{
+	__m128i bytes = _mm_loadl_epi64((const __m128i *)flags);
+	__m256i ints = _mm256_cvtepu8_epi32(bytes);
+	return _mm256_castsi256_ps(_mm256_cmpgt_epi32(ints, _mm256_setzero_si256()));
+}
+
+// Sine and cosine of eight angles in radians, Cephes polynomial with octant reduction
+AVX2_TARGET static inline void sincos(__m256 x, __m256 & s, __m256 & c)
+{
+	const __m256 signMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x80000000));
+
+	// Take absolute value, remember sign for sine
+	__m256 signSin = _mm256_and_ps(x, signMask);
+	x = _mm256_andnot_ps(signMask, x);
+
+	// Octant index rounded up to even
+	__m256 y = _mm256_mul_ps(x, _mm256_set1_ps(1.27323954473516f));
+	__m256i j = _mm256_cvttps_epi32(y);
+	j = _mm256_add_epi32(j, _mm256_set1_epi32(1));
+	j = _mm256_and_si256(j, _mm256_set1_epi32(~1));
+	y = _mm256_cvtepi32_ps(j);
+
+	// Sign flips and polynomial selection from octant
+	__m256 swapSignSin = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(j, _mm256_set1_epi32(4)), 29));
+	__m256 signCos = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_andnot_si256(_mm256_sub_epi32(j, _mm256_set1_epi32(2)), _mm256_set1_epi32(4)), 29));
+	__m256 polyMask = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(j, _mm256_set1_epi32(2)), _mm256_setzero_si256()));
+	signSin = _mm256_xor_ps(signSin, swapSignSin);
+
+	// Extended precision reduction x - y * pi/4
+	x = _mm256_add_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(-0.78515625f)));
+	x = _mm256_add_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(-2.4187564849853515625e-4f)));
+	x = _mm256_add_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(-3.77489497744594108e-8f)));
+	__m256 z = _mm256_mul_ps(x, x);
+
+	// Cosine polynomial
+	__m256 yc = _mm256_set1_ps(2.443315711809948e-5f);
+	yc = _mm256_add_ps(_mm256_mul_ps(yc, z), _mm256_set1_ps(-1.388731625493765e-3f));
+	yc = _mm256_add_ps(_mm256_mul_ps(yc, z), _mm256_set1_ps(4.166664568298827e-2f));
+	yc = _mm256_mul_ps(_mm256_mul_ps(yc, z), z);
+	yc = _mm256_sub_ps(yc, _mm256_mul_ps(z, _mm256_set1_ps(0.5f)));
+	yc = _mm256_add_ps(yc, _mm256_set1_ps(1.0f));
+
+	// Sine polynomial
+	__m256 ys = _mm256_set1_ps(-1.9515295891e-4f);
+	ys = _mm256_add_ps(_mm256_mul_ps(ys, z), _mm256_set1_ps(8.3321608736e-3f));
+	ys = _mm256_add_ps(_mm256_mul_ps(ys, z), _mm256_set1_ps(-1.6666654611e-1f));
+	ys = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(ys, z), x), x);
+
+	// Pick polynomials per lane and apply signs
+	s = _mm256_xor_ps(_mm256_blendv_ps(yc, ys, polyMask), signSin);
+	c = _mm256_xor_ps(_mm256_blendv_ps(ys, yc, polyMask), signCos);
+}
+
+// Integrate tanks eight worlds at a time, same arithmetic as updateTanksScalar
+AVX2_TARGET void updateTanksAVX2(const TankArrays & tanks, int begin, int end, float timeStep)
+{
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 dt = _mm256_set1_ps(timeStep);
+	const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+
+	int w = begin;
+	for(; w + 8 <= end; w += 8)
+	{
+		// Skip lanes of finished games
+		__m256 active = _mm256_xor_ps(loadFlags(tanks.gameOver + w), _mm256_castsi256_ps(_mm256_set1_epi32(-1)));
+		if(_mm256_movemask_ps(active) == 0) continue;
+
+		// Tank direction
+		__m256 angle = _mm256_loadu_ps(tanks.angle + w);
+		__m256 radians = _mm256_div_ps(_mm256_mul_ps(angle, _mm256_set1_ps((float)M_PI)), _mm256_set1_ps(180.0f));
+		__m256 directionX, directionZ;
+		sincos(radians, directionX, directionZ);
+
+		// Total tank acceleration according to driving, braking, and friction
+		__m256 velocity = _mm256_loadu_ps(tanks.velocity + w);
+		__m256 totalAcceleration = zero;
+		totalAcceleration = _mm256_add_ps(totalAcceleration, _mm256_and_ps(loadFlags(tanks.accelerate + w), _mm256_set1_ps(tankAcceleration)));
+		totalAcceleration = _mm256_sub_ps(totalAcceleration, _mm256_and_ps(loadFlags(tanks.decelerate + w), _mm256_set1_ps(tankDeceleration)));
+		totalAcceleration = _mm256_add_ps(totalAcceleration, _mm256_and_ps(_mm256_cmp_ps(velocity, zero, _CMP_LT_OQ), _mm256_set1_ps(tankFriction)));
+		totalAcceleration = _mm256_sub_ps(totalAcceleration, _mm256_and_ps(_mm256_cmp_ps(velocity, zero, _CMP_GT_OQ), _mm256_set1_ps(tankFriction)));
+
+		// Update and limit tank velocity
+		velocity = _mm256_add_ps(velocity, _mm256_mul_ps(totalAcceleration, dt));
+		velocity = _mm256_min_ps(velocity, _mm256_set1_ps(tankMaxVelocity));
+		velocity = _mm256_max_ps(velocity, _mm256_set1_ps(-tankMaxVelocity));
+		velocity = _mm256_andnot_ps(_mm256_cmp_ps(_mm256_and_ps(velocity, absMask), _mm256_set1_ps(1.0f), _CMP_LT_OQ), velocity);
+
+		// Update tank angle according to turning and forward/backward motion
+		__m256 tankOmega = zero;
+		tankOmega = _mm256_add_ps(tankOmega, _mm256_and_ps(loadFlags(tanks.turnLeft + w), _mm256_set1_ps(tankTurningRate)));
+		tankOmega = _mm256_sub_ps(tankOmega, _mm256_and_ps(loadFlags(tanks.turnRight + w), _mm256_set1_ps(tankTurningRate)));
+		__m256 turn = _mm256_mul_ps(tankOmega, dt);
+		__m256 newAngle = _mm256_blendv_ps(angle, _mm256_sub_ps(angle, turn), _mm256_cmp_ps(velocity, zero, _CMP_LT_OQ));
+		newAngle = _mm256_blendv_ps(newAngle, _mm256_add_ps(newAngle, turn), _mm256_cmp_ps(velocity, zero, _CMP_GT_OQ));
+
+		// Update tank falling velocity
+		__m256 falling = _mm256_and_ps(loadFlags(tanks.falling + w), active);
+		__m256 fallVelocity = _mm256_loadu_ps(tanks.fallVelocity + w);
+		__m256 fallingTime = _mm256_loadu_ps(tanks.fallingTime + w);
+		fallVelocity = _mm256_blendv_ps(fallVelocity, _mm256_add_ps(fallVelocity, _mm256_set1_ps(gravity * timeStep)), falling);
+		fallingTime = _mm256_blendv_ps(fallingTime, _mm256_add_ps(fallingTime, dt), falling);
+
+		// Update tank position and distance travelled
+		__m256 positionX = _mm256_loadu_ps(tanks.positionX + w);
+		__m256 positionY = _mm256_loadu_ps(tanks.positionY + w);
+		__m256 positionZ = _mm256_loadu_ps(tanks.positionZ + w);
+		__m256 distance = _mm256_loadu_ps(tanks.distanceTravelled + w);
+		__m256 newPositionX = _mm256_add_ps(positionX, _mm256_mul_ps(_mm256_mul_ps(directionX, velocity), dt));
+		__m256 newPositionY = _mm256_add_ps(positionY, _mm256_mul_ps(fallVelocity, dt));
+		__m256 newPositionZ = _mm256_add_ps(positionZ, _mm256_mul_ps(_mm256_mul_ps(directionZ, velocity), dt));
+		__m256 newDistance = _mm256_add_ps(distance, _mm256_mul_ps(velocity, dt));
+
+		// Store running lanes only
+		_mm256_storeu_ps(tanks.positionX + w, _mm256_blendv_ps(positionX, newPositionX, active));
+		_mm256_storeu_ps(tanks.positionY + w, _mm256_blendv_ps(positionY, newPositionY, active));
+		_mm256_storeu_ps(tanks.positionZ + w, _mm256_blendv_ps(positionZ, newPositionZ, active));
+		_mm256_storeu_ps(tanks.distanceTravelled + w, _mm256_blendv_ps(distance, newDistance, active));
+		_mm256_storeu_ps(tanks.velocity + w, _mm256_blendv_ps(_mm256_loadu_ps(tanks.velocity + w), velocity, active));
+		_mm256_storeu_ps(tanks.angle + w, _mm256_blendv_ps(angle, newAngle, active));
+		_mm256_storeu_ps(tanks.fallVelocity + w, fallVelocity);
+		_mm256_storeu_ps(tanks.fallingTime + w, fallingTime);
+	}
+
+	// Remaining worlds
+	updateTanksScalar(tanks, w, end, timeStep);
+}
+
+#else
+
+// No AVX2 on this architecture, cpuSupportsAVX2() is false so this is never selected
+void updateTanksAVX2(const TankArrays & tanks, int begin, int end, float timeStep)
+{
+	updateTanksScalar(tanks, begin, end, timeStep);
+}
+
+#endif
@@ -0,0 +1,254 @@
+#include "Bitmap.h"
+
+#include <MappedFile.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define BITMAP_SSSE3
+#include <tmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang need SSSE3 enabled per function, MSVC accepts the intrinsics as is
+#if defined(__GNUC__)
+#define SSSE3_TARGET __attribute__((target("ssse3")))
+#else
+#define SSSE3_TARGET
+#endif
+
+// Compression values of Windows headers, OS/2 V2 uses other meanings for the same numbers
+static const unsigned int compressionNone = 0;
+static const unsigned int compressionBitFields = 3;
+static const unsigned int compressionAlphaBitFields = 6;
+
+// Largest width or height accepted, keeps sizes well inside an int
+static const int maxSize = 32768;
+
+// Little-endian 16 and 32 bit values
+static inline unsigned int readShort(const unsigned char * bytes)
+{
+	return bytes[0] | (bytes[1] << 8);
+}
+
+static inline unsigned int readInt(const unsigned char * bytes)
+{
+	return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((unsigned int)bytes[3] << 24);
+}
+
+// Runtime check for SSSE3 support
+static bool cpuSupportsSSSE3()
+{
+#if defined(BITMAP_SSSE3) && defined(__GNUC__)
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("ssse3");
+#elif defined(BITMAP_SSSE3) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	return (info[2] & (1 << 9)) != 0;
+#else
+	return false;
+#endif
+}
+
+#ifdef BITMAP_SSSE3
+// Swap blue and red of five BGR pixels per 16 bytes, or of four BGRX pixels packed to twelve, the last bytes are overwritten by the next step
+SSSE3_TARGET static int convertRowSSSE3(const unsigned char * source, unsigned char * target, int width, int bytesPerPixel)
+{
+	int x = 0;
+	if(bytesPerPixel == 3)
+	{
+		const __m128i order = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15);
+		for(; x + 6 <= width; x += 5)
+			_mm_storeu_si128((__m128i *)(target + 3 * x), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(source + 3 * x)), order));
+	}
+	else
+	{
+		const __m128i order = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+		for(; x + 6 <= width; x += 4)
+			_mm_storeu_si128((__m128i *)(target + 3 * x), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(source + 4 * x)), order));
+	}
+	return x;
+}
+#endif
+
+//! Constructor
+Bitmap::Bitmap() : width(0), height(0)
+{
+}
+
+// Read and decode file
+Bitmap::Error Bitmap::load(std::string filename)
+{
+	MappedFile file;
+	if(!file.open(filename)) return OpenFailed;
+	return decode(file.getData(), file.getSize());
+}
+
+// Decode file in memory
+Bitmap::Error Bitmap::decode(const char * file, size_t size)
+{
+	const unsigned char * bytes = (const unsigned char *)file;
+	Layout layout;
+	Error error = readLayout(bytes, size, layout);
+	if(error != None) return error;
+
+	// Rows from the bottom whichever way they are stored
+	pixels.resize((size_t)layout.width * layout.height * 3);
+	for(int y = 0; y < layout.height; y++)
+	{
+		const unsigned char * row = bytes + layout.dataOffset + layout.stride * (layout.topDown ? layout.height - 1 - y : y);
+		convertRow(row, (unsigned char *)&pixels[(size_t)layout.width * 3 * y], layout.width, layout.bytesPerPixel);
+	}
+
+	width = layout.width;
+	height = layout.height;
+	return None;
+}
+
+// Read size from header
+Bitmap::Error Bitmap::readSize(std::string filename, int & width, int & height)
+{
+	MappedFile file;
+	if(!file.open(filename)) return OpenFailed;
+
+	Layout layout;
+	Error error = readLayout((const unsigned char *)file.getData(), file.getSize(), layout);
+	if(error != None) return error;
+	width = layout.width;
+	height = layout.height;
+	return None;
+}
+
+// Read headers of file in memory
+Bitmap::Error Bitmap::readLayout(const unsigned char * bytes, size_t size, Layout & layout)
+{
+	if(size < 2) return Truncated;
+	if(bytes[0] != 'B' || bytes[1] != 'M') return NotBitmap;
+	if(size < 18) return Truncated;
+
+	size_t dataOffset = readInt(bytes + 10);
+	size_t headerSize = readInt(bytes + 14);
+	if(headerSize > size - 14) return Truncated;
+	const unsigned char * header = bytes + 14;
+
+	int imageWidth, imageHeight, bitsPerPixel;
+	unsigned int compression = compressionNone;
+	switch(headerSize)
+	{
+		case 12:
+			//OS/2 V1, unsigned 16 bit sizes
+			imageWidth = readShort(header + 4);
+			imageHeight = readShort(header + 6);
+			bitsPerPixel = readShort(header + 10);
+			break;
+		case 16:
+		case 64:
+			//OS/2 V2, V3 layout where any compression is one of its own
+			imageWidth = (int)readInt(header + 4);
+			imageHeight = (int)readInt(header + 8);
+			bitsPerPixel = readShort(header + 14);
+			if(headerSize >= 20 && readInt(header + 16) != compressionNone) return Compressed;
+			break;
+		case 40:
+		case 52:
+		case 56:
+		case 108:
+		case 124:
+			//Windows V3, V3 with masks, V4 and V5
+			imageWidth = (int)readInt(header + 4);
+			imageHeight = (int)readInt(header + 8);
+			bitsPerPixel = readShort(header + 14);
+			compression = readInt(header + 16);
+			break;
+		default:
+			return UnknownHeader;
+	}
+
+	if(bitsPerPixel != 24 && bitsPerPixel != 32) return UnsupportedFormat;
+	if(compression == compressionBitFields || compression == compressionAlphaBitFields)
+	{
+		// Masks follow a V3 header and are part of larger ones, only byte-aligned BGR(A) is read
+		if(bitsPerPixel != 32) return UnsupportedFormat;
+		if(size < 14 + 40 + 12) return Truncated;
+		if(readInt(header + 40) != 0x00ff0000 || readInt(header + 44) != 0x0000ff00 || readInt(header + 48) != 0x000000ff) return UnsupportedFormat;
+	}
+	else if(compression != compressionNone) return Compressed;
+
+	// Negative heights are stored top-down
+	bool topDown = imageHeight < 0;
+	if(topDown) imageHeight = -imageHeight;
+	if(imageWidth <= 0 || imageHeight <= 0 || imageWidth > maxSize || imageHeight > maxSize) return BadSize;
+
+	// Rows padded to four bytes, the last one may end without its padding
+	int bytesPerPixel = bitsPerPixel / 8;
+	size_t stride = ((size_t)imageWidth * bitsPerPixel + 31) / 32 * 4;
+	if(dataOffset > size || size - dataOffset < stride * (imageHeight - 1) + (size_t)imageWidth * bytesPerPixel) return Truncated;
+
+	layout.width = imageWidth;
+	layout.height = imageHeight;
+	layout.topDown = topDown;
+	layout.bytesPerPixel = bytesPerPixel;
+	layout.dataOffset = dataOffset;
+	layout.stride = stride;
+	return None;
+}
+
+// Convert row to RGB
+void Bitmap::convertRow(const unsigned char * source, unsigned char * target, int width, int bytesPerPixel)
+{
+	int x = 0;
+#ifdef BITMAP_SSSE3
+	if(usesSSSE3()) x = convertRowSSSE3(source, target, width, bytesPerPixel);
+#endif
+
+	// Pixels left over, or all of them without SSSE3
+	for(source += x * bytesPerPixel, target += x * 3; x < width; x++, source += bytesPerPixel, target += 3)
+	{
+		target[0] = source[2];
+		target[1] = source[1];
+		target[2] = source[0];
+	}
+}
+
+// Whether rows are converted with SSSE3
+bool Bitmap::usesSSSE3()
+{
+	static const bool supported = cpuSupportsSSSE3();
+	return supported;
+}
+
+// Message for error
+const char * Bitmap::getErrorString(Error error)
+{
+	switch(error)
+	{
+		case None:				return "no error";
+		case OpenFailed:		return "could not open file";
+		case NotBitmap:			return "not a bitmap file";
+		case UnknownHeader:		return "unknown bitmap header";
+		case UnsupportedFormat:	return "only 24-bit and 32-bit BGR pixels are supported";
+		case Compressed:		return "compressed bitmaps are not supported";
+		case BadSize:			return "bad image size";
+		case Truncated:			return "file is truncated";
+	}
+	return "unknown error";
+}
+
+// Width in pixels
+int Bitmap::getWidth() const
+{
+	return width;
+}
+
+// Height in pixels
+int Bitmap::getHeight() const
+{
+	return height;
+}
+
+// RGB pixels
+const char * Bitmap::getPixels() const
+{
+	return pixels.empty() ? NULL : &pixels[0];
+}
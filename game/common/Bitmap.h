@@ -0,0 +1,73 @@
+#ifndef BITMAP_H_
+#define BITMAP_H_
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+/**
+ * BMP image decoder, independent of OpenGL.
+ * Reads Windows V3, V4 and V5 and OS/2 V1 and V2 headers with uncompressed 24-bit or 32-bit pixels,
+ * 32-bit ones also as bit fields in BGRA order, and rows stored bottom-up or top-down.
+ * The file is mapped in one go and whole rows are converted to RGB with SSSE3 byte shuffles where the CPU has them.
+ * Pixels come out as RGB rows from the bottom, as OpenGL expects them, any alpha is dropped.
+ */
+class Bitmap
+{
+
+public:
+
+	//! Reasons a file cannot be decoded
+	enum Error { None, OpenFailed, NotBitmap, UnknownHeader, UnsupportedFormat, Compressed, BadSize, Truncated };
+
+	//! Constructor
+	Bitmap();
+
+	//! Read and decode a BMP file
+	Error load(std::string filename);
+
+	//! Decode a BMP file already in memory
+	Error decode(const char * file, size_t size);
+
+	//! Read only the size of a BMP file from its header
+	static Error readSize(std::string filename, int & width, int & height);
+
+	//! Message for an error
+	static const char * getErrorString(Error error);
+
+	//! Size in pixels
+	int getWidth() const;
+	int getHeight() const;
+
+	//! RGB pixels, rows from the bottom without padding, NULL before a successful decode
+	const char * getPixels() const;
+
+	//! Whether rows are converted with SSSE3
+	static bool usesSSSE3();
+
+private:
+
+	//! Where and how the pixels of a file are stored
+	struct Layout
+	{
+		int width, height;
+		bool topDown;
+		int bytesPerPixel;
+		size_t dataOffset, stride;
+	};
+
+	//! Read the headers of a file in memory
+	static Error readLayout(const unsigned char * bytes, size_t size, Layout & layout);
+
+	//! Convert one row of BGR or BGRX pixels to RGB
+	static void convertRow(const unsigned char * source, unsigned char * target, int width, int bytesPerPixel);
+
+private:
+
+	//! Size and RGB pixels
+	int width, height;
+	std::vector<char> pixels;
+
+};
+
+#endif
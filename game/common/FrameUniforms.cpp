@@ -0,0 +1,73 @@
+#include "FrameUniforms.h"
+
+#include <string.h>
+
+//! Constructor
+FrameUniforms::FrameUniforms()
+: buffer(0), viewLocation(-1), projectionLocation(-1), lightPositionLocation(-1), ambientLocation(-1), specularPowerLocation(-1)
+{
+	memset(&data, 0, sizeof(data));
+}
+
+// Find block or plain uniforms
+void FrameUniforms::init(GLuint program)
+{
+	// Block declared only where the driver has uniform buffers
+	if(GLEW_VERSION_3_1 || GLEW_ARB_uniform_buffer_object)
+	{
+		GLuint blockIndex = glGetUniformBlockIndex(program, "Frame_block");
+		if(blockIndex != GL_INVALID_INDEX)
+		{
+			glUniformBlockBinding(program, blockIndex, bindingPoint);
+			glGenBuffers(1, &buffer);
+			glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+			glBufferData(GL_UNIFORM_BUFFER, sizeof(Data), NULL, GL_DYNAMIC_DRAW);
+			glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, buffer);
+			glBindBuffer(GL_UNIFORM_BUFFER, 0);
+			return;
+		}
+	}
+
+	viewLocation          = glGetUniformLocation(program, "ViewMatrix_uniform");
+	projectionLocation    = glGetUniformLocation(program, "ProjMatrix_uniform");
+	lightPositionLocation = glGetUniformLocation(program, "LightPosition_uniform");
+	ambientLocation       = glGetUniformLocation(program, "Ambient_uniform");
+	specularPowerLocation = glGetUniformLocation(program, "SpecularPower_uniform");
+}
+
+// Whether values go through a uniform buffer
+bool FrameUniforms::usesBuffer() const
+{
+	return buffer != 0;
+}
+
+// Upload frame values
+void FrameUniforms::update(Matrix4x4 & view, Matrix4x4 & projection, Vector3f lightPosition, Vector3f ambient, float specularPower)
+{
+	memcpy(data.view, view.getPtr(), sizeof(data.view));
+	memcpy(data.projection, projection.getPtr(), sizeof(data.projection));
+	data.lightPosition[0] = lightPosition.x;
+	data.lightPosition[1] = lightPosition.y;
+	data.lightPosition[2] = lightPosition.z;
+	data.lightPosition[3] = 1;
+	data.ambient[0] = ambient.x;
+	data.ambient[1] = ambient.y;
+	data.ambient[2] = ambient.z;
+	data.ambient[3] = 1;
+	data.specularPower[0] = specularPower;
+
+	// One upload for everything
+	if(buffer)
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Data), &data);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		return;
+	}
+
+	glUniformMatrix4fv(viewLocation, 1, false, data.view);
+	glUniformMatrix4fv(projectionLocation, 1, false, data.projection);
+	glUniform4fv(lightPositionLocation, 1, data.lightPosition);
+	glUniform4fv(ambientLocation, 1, data.ambient);
+	glUniform1f(specularPowerLocation, specularPower);
+}
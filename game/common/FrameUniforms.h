@@ -0,0 +1,56 @@
+#ifndef FRAMEUNIFORMS_H_
+#define FRAMEUNIFORMS_H_
+
+#include <GL/glew.h>
+#include <Matrix.h>
+#include <Vector.h>
+
+/**
+ * Camera and light values constant over a frame, uploaded once per frame.
+ * Programs declaring the Frame_block uniform block read them from one uniform buffer,
+ * others from plain uniforms of the same names, set once per frame as well.
+ */
+class FrameUniforms
+{
+
+public:
+
+	//! Block contents in std140 layout
+	struct Data
+	{
+		float view[16];
+		float projection[16];
+		float lightPosition[4];
+		float ambient[4];
+		float specularPower[4];
+	};
+
+	//! Binding point the block is attached to
+	static const GLuint bindingPoint = 0;
+
+	//! Constructor
+	FrameUniforms();
+
+	//! Find the block in program and create its buffer, or find the plain uniforms when there is no block
+	void init(GLuint program);
+
+	//! Whether values go through a uniform buffer
+	bool usesBuffer() const;
+
+	//! Upload frame values, program must be in use when there is no buffer
+	void update(Matrix4x4 & view, Matrix4x4 & projection, Vector3f lightPosition, Vector3f ambient, float specularPower);
+
+private:
+
+	//! Uniform buffer, zero without block support
+	GLuint buffer;
+
+	//! Plain uniform locations
+	GLint viewLocation, projectionLocation, lightPositionLocation, ambientLocation, specularPowerLocation;
+
+	//! Values uploaded last
+	Data data;
+
+};
+
+#endif
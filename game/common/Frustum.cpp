@@ -0,0 +1,84 @@
+#include "Frustum.h"
+
+#include <math.h>
+
+//! Constructor
+Frustum::Frustum()
+{
+	// Planes that everything is in front of
+	for(int p = 0; p < 6; p++)
+	{
+		planes[p][0] = planes[p][1] = planes[p][2] = 0;
+		planes[p][3] = 1;
+	}
+}
+
+// Set planes from projection * view
+void Frustum::set(Matrix4x4 & viewProjection)
+{
+	// Element at row r and column c is m[c * 4 + r]
+	const float * m = viewProjection.getPtr();
+
+	// Left, right, bottom, top, near and far are the last row plus or minus one of the others
+	for(int p = 0; p < 6; p++)
+	{
+		int row = p / 2;
+		float sign = (p & 1) ? -1.0f : 1.0f;
+		for(int c = 0; c < 4; c++)
+			planes[p][c] = m[c * 4 + 3] + sign * m[c * 4 + row];
+
+		// Normalized so distances are in world units
+		float length = sqrtf(planes[p][0] * planes[p][0] + planes[p][1] * planes[p][1] + planes[p][2] * planes[p][2]);
+		if(length > 0)
+			for(int c = 0; c < 4; c++)
+				planes[p][c] /= length;
+	}
+}
+
+// Sphere test
+bool Frustum::testSphere(Vector3f center, float radius) const
+{
+	for(int p = 0; p < 6; p++)
+	{
+		if(planes[p][0] * center.x + planes[p][1] * center.y + planes[p][2] * center.z + planes[p][3] < -radius)
+			return false;
+	}
+	return true;
+}
+
+// Box test
+Frustum::Result Frustum::testBox(Vector3f boxMin, Vector3f boxMax) const
+{
+	Result result = Inside;
+	for(int p = 0; p < 6; p++)
+	{
+		const float * plane = planes[p];
+
+		// Corner furthest along the plane normal, and the one opposite it
+		float outerX = plane[0] >= 0 ? boxMax.x : boxMin.x, innerX = plane[0] >= 0 ? boxMin.x : boxMax.x;
+		float outerY = plane[1] >= 0 ? boxMax.y : boxMin.y, innerY = plane[1] >= 0 ? boxMin.y : boxMax.y;
+		float outerZ = plane[2] >= 0 ? boxMax.z : boxMin.z, innerZ = plane[2] >= 0 ? boxMin.z : boxMax.z;
+
+		if(plane[0] * outerX + plane[1] * outerY + plane[2] * outerZ + plane[3] < 0) return Outside;
+		if(plane[0] * innerX + plane[1] * innerY + plane[2] * innerZ + plane[3] < 0) result = Intersects;
+	}
+	return result;
+}
+
+// World bounding sphere of a transformed sphere
+void Frustum::transformSphere(Matrix4x4 & matrix, Vector3f center, float radius, Vector3f & worldCenter, float & worldRadius)
+{
+	const float * m = matrix.getPtr();
+	worldCenter.x = m[0] * center.x + m[4] * center.y + m[8] * center.z + m[12];
+	worldCenter.y = m[1] * center.x + m[5] * center.y + m[9] * center.z + m[13];
+	worldCenter.z = m[2] * center.x + m[6] * center.y + m[10] * center.z + m[14];
+
+	// Longest transformed axis
+	float scale = 0;
+	for(int c = 0; c < 3; c++)
+	{
+		float length = sqrtf(m[c * 4] * m[c * 4] + m[c * 4 + 1] * m[c * 4 + 1] + m[c * 4 + 2] * m[c * 4 + 2]);
+		if(length > scale) scale = length;
+	}
+	worldRadius = radius * scale;
+}
@@ -0,0 +1,86 @@
+#ifndef FRUSTUM_H_
+#define FRUSTUM_H_
+
+#include <Matrix.h>
+#include <Vector.h>
+
+/**
+ * View frustum as six planes taken from a projection times view matrix, for culling spheres and boxes.
+ * Tests are conservative, whatever is reported outside is certainly not visible.
+ */
+class Frustum
+{
+
+public:
+
+	//! Box test result
+	enum Result { Outside, Intersects, Inside };
+
+	//! Constructor, nothing is culled until set
+	Frustum();
+
+	//! Set planes from projection * view, objects then tested in world space
+	void set(Matrix4x4 & viewProjection);
+
+	//! Checking whether any of the sphere can be visible
+	bool testSphere(Vector3f center, float radius) const;
+
+	//! Classify axis-aligned box against the frustum
+	Result testBox(Vector3f boxMin, Vector3f boxMax) const;
+
+	//! World bounding sphere of a sphere in model space transformed by matrix, radius grown by the largest axis scale
+	static void transformSphere(Matrix4x4 & matrix, Vector3f center, float radius, Vector3f & worldCenter, float & worldRadius);
+
+	/**
+	 * Visit cells of a rows x cols grid possibly in the frustum, cell (i, j) spanning x from originX + cellSize * j
+	 * and z from originZ + cellSize * i, both cellSize long, and y from yMin to yMax.
+	 * Cell ranges are tested as one box and split in halves while they intersect, so wholly visible or wholly
+	 * hidden parts cost a single test. visit(i0, j0, i1, j1) receives the visible rows [i0, i1) and columns [j0, j1).
+	 * Returns the number of boxes tested.
+	 */
+	template<class Visitor>
+	int visitGrid(int rows, int cols, float originX, float originZ, float cellSize, float yMin, float yMax, Visitor & visit) const
+	{
+		if(rows <= 0 || cols <= 0) return 0;
+		return visitCells(0, 0, rows, cols, originX, originZ, cellSize, yMin, yMax, visit);
+	}
+
+private:
+
+	//! Test cell range and recurse into the halves of ranges that intersect
+	template<class Visitor>
+	int visitCells(int i0, int j0, int i1, int j1, float originX, float originZ, float cellSize, float yMin, float yMax, Visitor & visit) const
+	{
+		Vector3f boxMin(originX + cellSize * j0, yMin, originZ + cellSize * i0);
+		Vector3f boxMax(originX + cellSize * j1, yMax, originZ + cellSize * i1);
+		Result result = testBox(boxMin, boxMax);
+		if(result == Outside) return 1;
+
+		// Single cells and ranges wholly inside need no further tests
+		if(result == Inside || (i1 - i0 == 1 && j1 - j0 == 1))
+		{
+			visit(i0, j0, i1, j1);
+			return 1;
+		}
+
+		// Split the longer side
+		if(i1 - i0 >= j1 - j0)
+		{
+			int middle = (i0 + i1) / 2;
+			return 1 + visitCells(i0, j0, middle, j1, originX, originZ, cellSize, yMin, yMax, visit)
+			         + visitCells(middle, j0, i1, j1, originX, originZ, cellSize, yMin, yMax, visit);
+		}
+
+		int middle = (j0 + j1) / 2;
+		return 1 + visitCells(i0, j0, i1, middle, originX, originZ, cellSize, yMin, yMax, visit)
+		         + visitCells(i0, middle, i1, j1, originX, originZ, cellSize, yMin, yMax, visit);
+	}
+
+private:
+
+	//! Planes as (normal, distance), points p with dot(normal, p) + distance >= 0 are inside
+	float planes[6][4];
+
+};
+
+#endif
@@ -0,0 +1,326 @@
+#include "GameSim.h"
+
+#include <math.h>
+
+// Converting degrees to radians
+float degreesToRadians(float angle)
+{
+	return angle * (float)M_PI / 180;
+}
+
+// Converting radians to degrees
+float radiansToDegrees(float angle)
+{
+	return angle * 180 / (float)M_PI;
+}
+
+//! Constructor
+GameSim::GameSim() : tiledMaze(NULL)
+{
+	world.turretHeight = defaultTurretHeight;
+	world.mazeRevision = 0;
+	world.balls.setCapacity(ballCapacity);
+	restart();
+}
+
+//! Destructor
+GameSim::~GameSim()
+{
+	delete tiledMaze;
+}
+
+// Loading maze from file
+bool GameSim::loadMaze(std::string filename)
+{
+	delete tiledMaze;
+	tiledMaze = NULL;
+
+	// Dimensions are taken from the file, malformed rows are reported
+	return initialMaze.loadFromFile(filename);
+}
+
+// Streaming maze from a tile file
+bool GameSim::loadTiledMaze(std::string filename, int budget)
+{
+	TiledMaze * maze = new TiledMaze;
+	if(!maze->open(filename, budget))
+	{
+		delete maze;
+		return false;
+	}
+
+	delete tiledMaze;
+	tiledMaze = maze;
+	initialMaze.resize(0, 0);
+	return true;
+}
+
+// Streamed maze
+TiledMaze * GameSim::getTiledMaze()
+{
+	return tiledMaze;
+}
+
+// Reset world to the start of a game
+void GameSim::restart()
+{
+	// Reset maze
+	world.maze = initialMaze;
+	world.mazeRevision++;
+	removedTargets.clear();
+	world.totalCoins = initialMaze.countTargets();
+	int cols = world.maze.getCols();
+	if(tiledMaze)
+	{
+		tiledMaze->resetTargets();
+		world.totalCoins = (int)tiledMaze->getTotalTargets();
+		cols = tiledMaze->getCols();
+	}
+
+	// Reset tank
+	world.tankPosition = Vector3f(cubeSize * (cols - 1), -0.5f, cubeSize * 0);
+	world.tankDistanceTravelled = 0;
+	world.tankAngle = -90;
+	world.tankVelocity = 0;
+	world.tankFallVelocity = 0;
+	world.tankFallingTime = 0;
+	world.tankAccelerating = false;
+	world.tankDecelerating = false;
+	world.tankTurningLeft = false;
+	world.tankTurningRight = false;
+	world.tankFalling = false;
+
+	// Reset game
+	world.timeRemaining = gameDuration;
+	world.collectedCoins = 0;
+	world.balls.clear();
+	world.gameOver = false;
+	world.gameOverMessage = "";
+
+	// Tiles around the start are loaded before the first step, ones that cannot be read are reported and stay open cells
+	if(tiledMaze) tiledMaze->preload(world.tankPosition, cubeSize, tileFollowRadius);
+}
+
+// Advance world by one step
+void GameSim::step(const Inputs & inputs, float timeStep)
+{
+	// Stream tiles around the tank
+	if(tiledMaze) tiledMaze->follow(world.tankPosition, cubeSize, tileFollowRadius);
+
+	// Tank acceleration, deceleration and turning
+	world.tankAccelerating = inputs.accelerate;
+	world.tankDecelerating = inputs.decelerate;
+	world.tankTurningLeft = inputs.turnLeft;
+	world.tankTurningRight = inputs.turnRight;
+
+	// Shoot ball
+	if(inputs.shoot && !world.gameOver) shootBall(inputs.turretPan);
+
+	// Update tank and balls
+	if(!world.gameOver) updateTank(timeStep);
+	updateBalls(timeStep);
+
+	if(!world.gameOver)
+	{
+		// Update timer
+		world.timeRemaining -= timeStep;
+
+		// Losing condition
+		if(world.timeRemaining < 0)
+		{
+			world.timeRemaining = 0;
+			endGame("YOU LOSE!");
+		}
+	}
+}
+
+// Turret height used for muzzle and coin pickup
+void GameSim::setTurretHeight(float height)
+{
+	world.turretHeight = height;
+}
+
+// Current world state
+World & GameSim::getWorld()
+{
+	return world;
+}
+
+// Maze as loaded
+const MazeGrid & GameSim::getInitialMaze() const
+{
+	return initialMaze;
+}
+
+// Targets removed since last restart
+const std::vector<int64_t> & GameSim::getRemovedTargets() const
+{
+	return removedTargets;
+}
+
+// Checking for blocks
+bool GameSim::isBlock(int i, int j) const
+{
+	if(tiledMaze) return tiledMaze->isBlock(i, j);
+	return world.maze.isBlock(i, j);
+}
+
+// Checking for targets
+bool GameSim::isTarget(int i, int j) const
+{
+	if(tiledMaze) return tiledMaze->isTarget(i, j);
+	return world.maze.isTarget(i, j);
+}
+
+// Removing targets
+void GameSim::removeTarget(int i, int j)
+{
+	if(tiledMaze) tiledMaze->removeTarget(i, j);
+	else if(world.maze.removeTarget(i, j)) removedTargets.push_back((int64_t)i * world.maze.getCols() + j);
+	world.mazeRevision++;
+}
+
+// Colliding coins
+void GameSim::collideCoins(Vector3f position)
+{
+	// Coins close to position, only cells around it are visited
+	int hitRows[coinQueryMax], hitCols[coinQueryMax];
+	int found;
+	if(tiledMaze)
+		found = queryGridTargets(*tiledMaze, position, coinPickupRadius, cubeSize, coinHeight, hitRows, hitCols, coinQueryMax);
+	else
+		found = world.maze.queryTargets(position, coinPickupRadius, cubeSize, coinHeight, hitRows, hitCols, coinQueryMax);
+
+	collectCoins(hitRows, hitCols, found);
+}
+
+// Colliding coins along a path
+void GameSim::sweepCoins(Vector3f start, Vector3f end)
+{
+	// Collected coins are gone from the maze, so repeat until a sweep comes back short
+	int hitRows[coinQueryMax], hitCols[coinQueryMax];
+	int found;
+	do
+	{
+		if(tiledMaze)
+			found = sweepGridTargets(*tiledMaze, start, end, coinPickupRadius, cubeSize, coinHeight, hitRows, hitCols, coinQueryMax);
+		else
+			found = world.maze.sweepTargets(start, end, coinPickupRadius, cubeSize, coinHeight, hitRows, hitCols, coinQueryMax);
+
+		collectCoins(hitRows, hitCols, found);
+	}
+	while(found == coinQueryMax);
+}
+
+// Collecting found coins
+void GameSim::collectCoins(const int * hitRows, const int * hitCols, int found)
+{
+	for(int k = 0; k < found; k++)
+	{
+		// Remove target
+		removeTarget(hitRows[k], hitCols[k]);
+		world.collectedCoins++;
+
+		// Winning condition
+		if(world.collectedCoins == world.totalCoins) endGame("YOU WIN!");
+	}
+}
+
+// Updating tank variables
+void GameSim::updateTank(float timeStep)
+{
+	// Tank direction
+	Vector3f TankDirection(sinf(degreesToRadians(world.tankAngle)), 0, cosf(degreesToRadians(world.tankAngle)));
+
+	// Total tank acceleration according to driving, braking, and friction
+	float totalAcceleration = 0;
+	if(world.tankAccelerating) totalAcceleration += tankAcceleration;
+	if(world.tankDecelerating) totalAcceleration -= tankDeceleration;
+	if(world.tankVelocity < 0) totalAcceleration += tankFriction;
+	if(world.tankVelocity > 0) totalAcceleration -= tankFriction;
+
+	// Update tank velocity according to total acceleration
+	world.tankVelocity += totalAcceleration * timeStep;
+
+	// Limit maximum and minimum velocity
+	if(world.tankVelocity > tankMaxVelocity) world.tankVelocity = tankMaxVelocity;
+	if(world.tankVelocity < -tankMaxVelocity) world.tankVelocity = -tankMaxVelocity;
+	if(fabsf(world.tankVelocity) < 1) world.tankVelocity = 0;
+
+	// Tank angular velocity according to left/right turning
+	float tankOmega = 0;
+	if(world.tankTurningLeft) tankOmega += tankTurningRate;
+	if(world.tankTurningRight) tankOmega -= tankTurningRate;
+
+	// Update tank angle according to forward/backward motion
+	if(world.tankVelocity < 0) world.tankAngle -= tankOmega * timeStep;
+	if(world.tankVelocity > 0) world.tankAngle += tankOmega * timeStep;
+
+	// Update tank falling velocity
+	if(world.tankFalling)
+	{
+		world.tankFallVelocity += gravity * timeStep;
+		world.tankFallingTime += timeStep;
+
+		// Losing condition
+		if(world.tankFallingTime > 0.6f) endGame("YOU LOSE!");
+	}
+
+	// Update tank position according to movement and falling
+	world.tankPosition = world.tankPosition + TankDirection * world.tankVelocity * timeStep;
+	world.tankPosition.y = world.tankPosition.y + world.tankFallVelocity * timeStep;
+
+	// Update distance travelled
+	world.tankDistanceTravelled += world.tankVelocity * timeStep;
+
+	// Collision detection between coins and tank top
+	Vector3f tankTop = world.tankPosition;
+	tankTop.y += world.turretHeight;
+	collideCoins(tankTop);
+
+	// Convert tank position to maze coordinates
+	int i = (int)floorf(world.tankPosition.z / cubeSize + 0.5f);
+	int j = (int)floorf(world.tankPosition.x / cubeSize + 0.5f);
+
+	// If tank position is not over block, it should fall
+	if(!isBlock(i, j)) world.tankFalling = true;
+}
+
+// Updating balls in flight
+void GameSim::updateBalls(float timeStep)
+{
+	// Falling under gravity, all balls at once
+	ProjectilePool & balls = world.balls;
+	balls.integrate(gravity, timeStep);
+
+	for(int k = 0; k < balls.getCount(); )
+	{
+		// Collision detection between coins and the path of the ball this step, so fast balls cannot pass through coins
+		sweepCoins(balls.getPreviousPosition(k), balls.getPosition(k));
+
+		// End of falling, the last ball moves into this slot
+		if(balls.positionY[k] < 0) balls.remove(k);
+		else k++;
+	}
+}
+
+// Shooting ball
+void GameSim::shootBall(float turretPan)
+{
+	// Initial ball velocity in turret direction
+	float turretAngle = radiansToDegrees(turretPan) + 90;
+	float ballAngle = world.tankAngle + turretAngle;
+	Vector3f ballDirection(sinf(degreesToRadians(ballAngle)), 0, cosf(degreesToRadians(ballAngle)));
+
+	// Initial ball position at turret muzzle, ignored when the pool is full
+	Vector3f ballPosition = world.tankPosition + ballDirection * 4;
+	ballPosition.y += world.turretHeight;
+	world.balls.spawn(ballPosition, ballDirection * ballSpeed);
+}
+
+// Finish game with message
+void GameSim::endGame(const char * message)
+{
+	world.gameOver = true;
+	world.gameOverMessage = message;
+}
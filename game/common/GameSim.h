@@ -0,0 +1,204 @@
+#ifndef GAMESIM_H_
+#define GAMESIM_H_
+
+#include <Vector.h>
+#include <MazeGrid.h>
+#include <ProjectilePool.h>
+#include <TiledMaze.h>
+#include <string>
+#include <vector>
+
+// Tank properties
+const float tankAcceleration = 100;
+const float tankDeceleration = 100;
+const float tankMaxVelocity = 25;
+const float tankFriction = 30;
+const float tankTurningRate = 100;
+
+// Cube properties
+const float cubeSize = 15;
+
+// Coin properties
+const float coinSize = 1;
+const float coinHeight = 2;
+const float coinPickupRadius = 2;
+const int coinQueryMax = 9;  // Coins one pickup query can return
+
+// Tiled maze streaming
+const int tileFollowRadius = 1;  // Tiles kept loaded around the tank tile
+
+// Ball properties
+const float ballSize = 0.4f;
+const float ballSpeed = 50;
+const int ballCapacity = 4096;  // Balls in flight at once, shots beyond it are ignored
+
+// Game properties
+const float gravity = -30;
+const float gameDuration = 60;
+
+// Default turret height, centroid of turret.obj
+const float defaultTurretHeight = 2.832239f;
+
+/**
+ * Player inputs sampled for a single simulation step
+ */
+struct Inputs
+{
+	//! Constructor
+	Inputs()
+	: accelerate(false), decelerate(false), turnLeft(false), turnRight(false), shoot(false), turretPan(0){};
+
+	//! Driving and turning keys
+	bool accelerate, decelerate, turnLeft, turnRight;
+
+	//! Fire a ball this step
+	bool shoot;
+
+	//! Turret pan relative to the camera in radians
+	float turretPan;
+};
+
+/**
+ * Game state besides the maze, small enough to copy every step
+ */
+struct WorldState
+{
+	//! Changes whenever maze does, never repeats within a run
+	unsigned int mazeRevision;
+
+	//! Tank variables
+	Vector3f tankPosition;
+	float tankDistanceTravelled;
+	float tankAngle;
+	float tankVelocity;
+	float tankFallVelocity;
+	float tankFallingTime;
+	bool tankAccelerating;
+	bool tankDecelerating;
+	bool tankTurningLeft;
+	bool tankTurningRight;
+	bool tankFalling;
+	float turretHeight;
+
+	//! Coin variables
+	int totalCoins;
+	int collectedCoins;
+
+	//! Balls in flight
+	ProjectilePool balls;
+
+	//! Game variables
+	float timeRemaining;
+	bool gameOver;
+	const char * gameOverMessage;
+};
+
+/**
+ * Complete game state advanced by GameSim
+ */
+struct World : public WorldState
+{
+	//! Maze, targets are the coins left
+	MazeGrid maze;
+};
+
+/**
+ * Fixed-step game simulation independent of windowing and rendering
+ */
+class GameSim
+{
+
+public:
+
+	//! Constructor
+	GameSim();
+
+	//! Destructor
+	~GameSim();
+
+	//! Load maze from file, kept as the layout used by restart
+	bool loadMaze(std::string filename);
+
+	//! Stream maze from a tile file instead, keeping at most budget tiles resident
+	bool loadTiledMaze(std::string filename, int budget);
+
+	//! Streamed maze, NULL when the maze was loaded whole
+	TiledMaze * getTiledMaze();
+
+	//! Reset world to the start of a game
+	void restart();
+
+	//! Advance world by one step
+	void step(const Inputs & inputs, float timeStep);
+
+	//! Turret height used for muzzle and coin pickup, defaults to defaultTurretHeight
+	void setTurretHeight(float height);
+
+	//! Current world state
+	World & getWorld();
+
+	//! Maze as loaded, the one restart starts from, only changed by loading so other threads may read it while the game runs
+	const MazeGrid & getInitialMaze() const;
+
+	//! Cells whose targets were removed since the last restart in order, as i * cols + j
+	const std::vector<int64_t> & getRemovedTargets() const;
+
+	//! Checking for blocks
+	bool isBlock(int i, int j) const;
+
+	//! Checking for targets
+	bool isTarget(int i, int j) const;
+
+private:
+
+	//! Not copyable
+	GameSim(const GameSim &);
+	void operator=(const GameSim &);
+
+	//! Removing targets
+	void removeTarget(int i, int j);
+
+	//! Colliding coins
+	void collideCoins(Vector3f position);
+
+	//! Colliding coins along the path from start to end
+	void sweepCoins(Vector3f start, Vector3f end);
+
+	//! Collecting found coins
+	void collectCoins(const int * hitRows, const int * hitCols, int found);
+
+	//! Updating tank variables
+	void updateTank(float timeStep);
+
+	//! Updating balls in flight
+	void updateBalls(float timeStep);
+
+	//! Shooting ball
+	void shootBall(float turretPan);
+
+	//! Finish game with message
+	void endGame(const char * message);
+
+private:
+
+	//! Maze as loaded from file
+	MazeGrid initialMaze;
+
+	//! Targets removed from world.maze since the last restart
+	std::vector<int64_t> removedTargets;
+
+	//! Streamed maze, replaces world.maze when set
+	TiledMaze * tiledMaze;
+
+	//! Game state
+	World world;
+
+};
+
+//! Converting degrees to radians
+float degreesToRadians(float angle);
+
+//! Converting radians to degrees
+float radiansToDegrees(float angle);
+
+#endif
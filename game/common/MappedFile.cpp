@@ -0,0 +1,100 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//! Constructor
+MappedFile::MappedFile() : data(NULL), size(0), file(NULL), mapping(NULL)
+{
+}
+
+//! Destructor
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+// Map file
+bool MappedFile::open(std::string filename, bool populate)
+{
+	close();
+
+#ifdef _WIN32
+	HANDLE handle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if(handle == INVALID_HANDLE_VALUE) return false;
+	file = handle;
+
+	LARGE_INTEGER fileSize;
+	if(!GetFileSizeEx(handle, &fileSize)) { close(); return false; }
+	size = (size_t)fileSize.QuadPart;
+	if(size == 0) return true;
+
+	HANDLE map = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if(map == NULL) { close(); return false; }
+	mapping = map;
+
+	data = (const char *)MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0);
+	if(data == NULL) { close(); return false; }
+#else
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if(fd < 0) return false;
+
+	struct stat info;
+	if(fstat(fd, &info) != 0) { ::close(fd); return false; }
+	size = (size_t)info.st_size;
+
+	// Mapping stays valid after the descriptor is closed
+	if(size > 0)
+	{
+		// Pages read ahead in one go rather than faulted in one by one, only when asked so
+		// files walked in parts, like mazes converted a band at a time, are not read twice
+		int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+		if(populate) flags |= MAP_POPULATE;
+#endif
+		void * view = mmap(NULL, size, PROT_READ, flags, fd, 0);
+		if(view == MAP_FAILED) { ::close(fd); size = 0; return false; }
+		madvise(view, size, MADV_SEQUENTIAL);
+		data = (const char *)view;
+	}
+	::close(fd);
+#endif
+
+	return true;
+}
+
+// Unmap file
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if(data) UnmapViewOfFile(data);
+	if(mapping) CloseHandle((HANDLE)mapping);
+	if(file) CloseHandle((HANDLE)file);
+#else
+	if(data) munmap((void *)data, size);
+#endif
+
+	data = NULL;
+	size = 0;
+	file = NULL;
+	mapping = NULL;
+}
+
+// File contents
+const char * MappedFile::getData() const
+{
+	return data;
+}
+
+// File size in bytes
+size_t MappedFile::getSize() const
+{
+	return size;
+}
@@ -0,0 +1,51 @@
+#ifndef MAPPEDFILE_H_
+#define MAPPEDFILE_H_
+
+#include <stddef.h>
+#include <string>
+
+/**
+ * Read-only memory mapping of a whole file
+ */
+class MappedFile
+{
+
+public:
+
+	//! Constructor
+	MappedFile();
+
+	//! Destructor, unmaps file
+	~MappedFile();
+
+	//! Map file, returns false when it cannot be opened, populate reads all pages in up front for files read whole at once
+	bool open(std::string filename, bool populate = false);
+
+	//! Unmap file
+	void close();
+
+	//! File contents, NULL for empty or closed files
+	const char * getData() const;
+
+	//! File size in bytes
+	size_t getSize() const;
+
+private:
+
+	//! Not copyable
+	MappedFile(const MappedFile &);
+	void operator=(const MappedFile &);
+
+private:
+
+	//! Mapped contents
+	const char * data;
+	size_t size;
+
+	//! Platform handles
+	void * file;
+	void * mapping;
+
+};
+
+#endif
@@ -0,0 +1,195 @@
+#include "MazeChunkBuffer.h"
+
+#include <algorithm>
+
+//! Constructor
+MazeChunkBuffer::MazeChunkBuffer() : vertexBuffer(0), indexBuffer(0), indirectBuffer(0), chunkCount(0)
+{
+}
+
+// Upload rebuilt chunks
+int MazeChunkBuffer::update(const MazeMesher & mesher)
+{
+	size_t count = mesher.getChunkRows() * mesher.getChunkCols();
+	if(vertexBuffer == 0)
+	{
+		glGenBuffers(1, &vertexBuffer);
+		glGenBuffers(1, &indexBuffer);
+		if(usesIndirect()) glGenBuffers(1, &indirectBuffer);
+	}
+
+	// New chunk grid
+	if(slots.size() != count)
+	{
+		repack(mesher);
+		return chunkCount;
+	}
+
+	// Rebuilt chunks that outgrew their slot need all slots moved
+	for(size_t k = 0; k < count; k++)
+	{
+		const MazeMesher::Chunk & chunk = mesher.getChunk(k);
+		if(chunk.revision != slots[k].revision &&
+		   (chunk.vertices.size() / MazeMesher::vertexFloats > slots[k].vertexCapacity || chunk.indices.size() > slots[k].indexCapacity))
+		{
+			repack(mesher);
+			return chunkCount;
+		}
+	}
+
+	// Element bindings belong to the bound vertex array object, keep them off the meshes
+	if(GLEW_VERSION_3_0 || GLEW_ARB_vertex_array_object) glBindVertexArray(0);
+
+	// Everything fits, only the rebuilt chunks are sent
+	int uploaded = 0;
+	chunkCount = 0;
+	for(size_t k = 0; k < count; k++)
+	{
+		const MazeMesher::Chunk & chunk = mesher.getChunk(k);
+		Slot & slot = slots[k];
+		if(!chunk.indices.empty()) chunkCount++;
+		if(chunk.revision == slot.revision) continue;
+
+		slot.revision = chunk.revision;
+		slot.indexCount = chunk.indices.size();
+		uploaded++;
+		if(chunk.indices.empty()) continue;
+
+		glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+		glBufferSubData(GL_ARRAY_BUFFER, slot.vertexOffset * MazeMesher::vertexFloats * sizeof(GLfloat),
+			chunk.vertices.size() * sizeof(GLfloat), &chunk.vertices[0]);
+
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, slot.indexOffset * sizeof(GLushort), chunk.indices.size() * sizeof(GLushort), &chunk.indices[0]);
+	}
+	return uploaded;
+}
+
+// Pack all chunks
+void MazeChunkBuffer::repack(const MazeMesher & mesher)
+{
+	size_t count = mesher.getChunkRows() * mesher.getChunkCols();
+	slots.resize(count);
+
+	// Slots with a quarter extra so most edits are uploaded in place
+	GLuint vertexTotal = 0, indexTotal = 0;
+	chunkCount = 0;
+	for(size_t k = 0; k < count; k++)
+	{
+		const MazeMesher::Chunk & chunk = mesher.getChunk(k);
+		GLuint vertices = chunk.vertices.size() / MazeMesher::vertexFloats;
+		GLuint indices = chunk.indices.size();
+		Slot & slot = slots[k];
+		slot.vertexOffset = vertexTotal;
+		slot.vertexCapacity = vertices ? vertices + vertices / 4 + 16 : 0;
+		slot.indexOffset = indexTotal;
+		slot.indexCapacity = indices ? indices + indices / 4 + 24 : 0;
+		slot.indexCount = indices;
+		slot.revision = chunk.revision;
+		vertexTotal += slot.vertexCapacity;
+		indexTotal += slot.indexCapacity;
+		if(indices) chunkCount++;
+	}
+
+	// Whole buffers assembled once, slack left as zeros
+	std::vector<GLfloat> vertexData(vertexTotal * MazeMesher::vertexFloats);
+	std::vector<GLushort> indexData(indexTotal);
+	for(size_t k = 0; k < count; k++)
+	{
+		const MazeMesher::Chunk & chunk = mesher.getChunk(k);
+		if(chunk.indices.empty()) continue;
+		std::copy(chunk.vertices.begin(), chunk.vertices.end(), vertexData.begin() + slots[k].vertexOffset * MazeMesher::vertexFloats);
+		std::copy(chunk.indices.begin(), chunk.indices.end(), indexData.begin() + slots[k].indexOffset);
+	}
+
+	if(GLEW_VERSION_3_0 || GLEW_ARB_vertex_array_object) glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertexData.size() * sizeof(GLfloat), vertexData.empty() ? NULL : &vertexData[0], GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexData.size() * sizeof(GLushort), indexData.empty() ? NULL : &indexData[0], GL_DYNAMIC_DRAW);
+}
+
+// Queue chunk
+void MazeChunkBuffer::add(int k)
+{
+	const Slot & slot = slots[k];
+	if(slot.indexCount == 0) return;
+
+	// Chunk indices count from the chunk's first vertex, which is its slot's base vertex
+	if(usesIndirect())
+	{
+		Command command = { slot.indexCount, 1, slot.indexOffset, (GLint)slot.vertexOffset, 0 };
+		commands.push_back(command);
+	}
+	else
+	{
+		counts.push_back(slot.indexCount);
+		offsets.push_back((GLvoid *)(slot.indexOffset * sizeof(GLushort)));
+		baseVertices.push_back(slot.vertexOffset);
+	}
+}
+
+// Draw queued chunks
+int MazeChunkBuffer::draw(GLuint vertexPositionAttribute, GLint vertexNormalAttribute, GLint vertexTexcoordAttribute)
+{
+	int drawn = commands.size() + counts.size();
+	if(drawn == 0) return 0;
+
+	setAttributes(vertexPositionAttribute, vertexNormalAttribute, vertexTexcoordAttribute, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+
+	// One submission for all chunks in view
+	if(usesIndirect())
+	{
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(Command), &commands[0], GL_STREAM_DRAW);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, (void*)0, commands.size(), sizeof(Command));
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		commands.clear();
+	}
+	else if(usesBaseVertex())
+		glMultiDrawElementsBaseVertex(GL_TRIANGLES, &counts[0], GL_UNSIGNED_SHORT, &offsets[0], counts.size(), &baseVertices[0]);
+	else
+	{
+		// A draw per chunk with the attributes moved to its slot
+		for(size_t k = 0; k < counts.size(); k++)
+		{
+			setAttributes(vertexPositionAttribute, vertexNormalAttribute, vertexTexcoordAttribute, baseVertices[k]);
+			glDrawElements(GL_TRIANGLES, counts[k], GL_UNSIGNED_SHORT, offsets[k]);
+		}
+	}
+	counts.clear();
+	offsets.clear();
+	baseVertices.clear();
+	return drawn;
+}
+
+// Attributes from a first vertex on
+void MazeChunkBuffer::setAttributes(GLuint vertexPositionAttribute, GLint vertexNormalAttribute, GLint vertexTexcoordAttribute, GLuint firstVertex)
+{
+	// Position, normal and tex coord interleaved like Mesh
+	const GLsizei stride = MazeMesher::vertexFloats * sizeof(GLfloat);
+	size_t first = (size_t)firstVertex * stride;
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glVertexAttribPointer(vertexPositionAttribute, 3, GL_FLOAT, GL_FALSE, stride, (void*)first);
+	if(vertexNormalAttribute != -1) glVertexAttribPointer(vertexNormalAttribute, 3, GL_FLOAT, GL_FALSE, stride, (void*)(first + 3 * sizeof(GLfloat)));
+	if(vertexTexcoordAttribute != -1) glVertexAttribPointer(vertexTexcoordAttribute, 2, GL_FLOAT, GL_FALSE, stride, (void*)(first + 6 * sizeof(GLfloat)));
+}
+
+// Chunks with geometry
+int MazeChunkBuffer::getChunkCount() const
+{
+	return chunkCount;
+}
+
+// Whether draws go through an indirect buffer
+bool MazeChunkBuffer::usesIndirect() const
+{
+	return GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect;
+}
+
+// Whether draws can start at a base vertex
+bool MazeChunkBuffer::usesBaseVertex() const
+{
+	return GLEW_VERSION_3_2 || GLEW_ARB_draw_elements_base_vertex;
+}
@@ -0,0 +1,86 @@
+#ifndef MAZECHUNKBUFFER_H_
+#define MAZECHUNKBUFFER_H_
+
+#include <GL/glew.h>
+#include <MazeMesher.h>
+#include <vector>
+
+/**
+ * Baked maze chunks packed into one vertex buffer and one index buffer, so any set of chunks draws in one submission,
+ * glMultiDrawElementsIndirect where available and glMultiDrawElementsBaseVertex otherwise.
+ * Indices stay the chunks' own 16-bit ones and every draw starts at its slot's base vertex,
+ * without base vertex support chunks are drawn one by one from offset attribute pointers.
+ * Every chunk owns a slot with some room to grow, a rebuilt chunk that still fits is uploaded into its slot alone,
+ * one that outgrew it has everything packed again.
+ */
+class MazeChunkBuffer
+{
+
+public:
+
+	//! Constructor
+	MazeChunkBuffer();
+
+	//! Upload the chunks rebuilt since the last update, returns the number of chunks uploaded
+	int update(const MazeMesher & mesher);
+
+	//! Queue chunk k for the next draw, empty chunks are skipped
+	void add(int k);
+
+	//! Draw the chunks added since the last draw, returns the number of chunks drawn
+	int draw(GLuint vertexPositionAttribute, GLint vertexNormalAttribute, GLint vertexTexcoordAttribute);
+
+	//! Chunks with geometry
+	int getChunkCount() const;
+
+	//! Whether draws go through an indirect buffer
+	bool usesIndirect() const;
+
+private:
+
+	//! Pack every chunk again with fresh slots
+	void repack(const MazeMesher & mesher);
+
+	//! Point the attributes at the vertex buffer from a first vertex on
+	void setAttributes(GLuint vertexPositionAttribute, GLint vertexNormalAttribute, GLint vertexTexcoordAttribute, GLuint firstVertex);
+
+	//! Whether draws can start at a base vertex without an indirect buffer
+	bool usesBaseVertex() const;
+
+	//! Chunk storage in the buffers, offsets and capacities in vertices and indices
+	struct Slot
+	{
+		GLuint vertexOffset, vertexCapacity;
+		GLuint indexOffset, indexCapacity;
+		GLuint indexCount;
+		unsigned int revision;
+	};
+
+	//! Layout of one glMultiDrawElementsIndirect command
+	struct Command
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+private:
+
+	//! Buffers
+	GLuint vertexBuffer, indexBuffer, indirectBuffer;
+
+	//! Slot of every chunk
+	std::vector<Slot> slots;
+	int chunkCount;
+
+	//! Chunks queued for the next draw, as commands or as counts, offsets and base vertices
+	std::vector<Command> commands;
+	std::vector<GLsizei> counts;
+	std::vector<GLvoid *> offsets;
+	std::vector<GLint> baseVertices;
+
+};
+
+#endif
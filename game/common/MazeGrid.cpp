@@ -0,0 +1,415 @@
+#include "MazeGrid.h"
+#include "MappedFile.h"
+
+#include <iostream>
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MAZEGRID_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Number of set bits
+static inline int popcount64(uint64_t x)
+{
+#if defined(__GNUC__)
+	return __builtin_popcountll(x);
+#else
+	x = x - ((x >> 1) & 0x5555555555555555ull);
+	x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+	x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0full;
+	return (int)((x * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+// Index of lowest set bit, x must not be zero
+static inline int lowestBit64(uint64_t x)
+{
+#if defined(__GNUC__)
+	return __builtin_ctzll(x);
+#elif defined(_MSC_VER) && defined(_M_X64)
+	unsigned long index;
+	_BitScanForward64(&index, x);
+	return (int)index;
+#else
+	int index = 0;
+	while(!(x & 1)) { x >>= 1; index++; }
+	return index;
+#endif
+}
+
+// First word in [begin, end) that is not equal to skip, skip is all zeros or all ones
+static inline int skipWords(const uint64_t * words, int begin, int end, uint64_t skip)
+{
+	int k = begin;
+
+#ifdef MAZEGRID_SSE2
+	// Compare two words at a time
+	__m128i pattern = _mm_set1_epi32((int)(uint32_t)skip);
+	for(; k + 2 <= end; k += 2)
+	{
+		__m128i value = _mm_loadu_si128((const __m128i *)(words + k));
+		if(_mm_movemask_epi8(_mm_cmpeq_epi8(value, pattern)) != 0xffff) break;
+	}
+#endif
+
+	for(; k < end; k++)
+	{
+		if(words[k] != skip) return k;
+	}
+	return end;
+}
+
+//! Constructor
+MazeGrid::MazeGrid() : rows(0), cols(0), stride(0), targetCount(0)
+{
+}
+
+//! Constructor with dimensions
+MazeGrid::MazeGrid(int rows, int cols) : rows(0), cols(0), stride(0), targetCount(0)
+{
+	resize(rows, cols);
+}
+
+// Set dimensions, all cells empty
+void MazeGrid::resize(int rows, int cols)
+{
+	this->rows = rows;
+	this->cols = cols;
+	stride = (cols + 63) / 64;
+	blocks.assign((size_t)rows * stride, 0);
+	targets.assign((size_t)rows * stride, 0);
+	targetCount = 0;
+}
+
+// Load maze file through a memory mapping
+bool MazeGrid::loadFromFile(std::string filename)
+{
+	MappedFile file;
+	if(!file.open(filename))
+	{
+		std::cout << "Error opening " << filename << std::endl;
+		return false;
+	}
+
+	return parse(file.getData(), file.getSize(), filename);
+}
+
+// Parse maze text
+bool MazeGrid::parse(const char * text, size_t size, std::string name)
+{
+	// Find lines, trailing whitespace and carriage returns are not part of a row
+	std::vector<size_t> lineStart, lineLength;
+	size_t lastRow = 0;
+	const char * end = text + size;
+	for(const char * line = text; line && line < end; )
+	{
+		const char * newline = (const char *)memchr(line, '\n', end - line);
+		const char * lineEnd = newline ? newline : end;
+		while(lineEnd > line && (lineEnd[-1] == '\r' || lineEnd[-1] == ' ' || lineEnd[-1] == '\t')) lineEnd--;
+
+		lineStart.push_back(line - text);
+		lineLength.push_back(lineEnd - line);
+		if(lineEnd > line) lastRow = lineStart.size();
+		line = newline ? newline + 1 : NULL;
+	}
+
+	// Blank lines at the end of file are ignored
+	int rowCount = (int)lastRow;
+	int colCount = rowCount > 0 ? (int)lineLength[0] : 0;
+	if(rowCount == 0 || colCount == 0)
+	{
+		std::cout << "Error in " << name << ": maze is empty" << std::endl;
+		resize(0, 0);
+		return false;
+	}
+	resize(rowCount, colCount);
+
+	// Decode rows, reporting the first malformed ones
+	const int maxReports = 10;
+	int errors = 0;
+	for(int i = 0; i < rows; i++)
+	{
+		int column = -1;
+		if((int)lineLength[i] == cols)
+			column = decodeRow(text + lineStart[i], cols, &blocks[(size_t)i * stride], &targets[(size_t)i * stride]);
+
+		if((int)lineLength[i] == cols && column < 0)
+			continue;
+
+		if(errors++ >= maxReports)
+			continue;
+		if((int)lineLength[i] != cols)
+			std::cout << "Error in " << name << " row " << i + 1 << ": " << lineLength[i] << " cells, expected " << cols << std::endl;
+		else
+			std::cout << "Error in " << name << " row " << i + 1 << " column " << column + 1 << ": '" << text[lineStart[i] + column] << "' is not 0, 1 or 2" << std::endl;
+	}
+
+	if(errors > 0)
+	{
+		if(errors > maxReports) std::cout << "Error in " << name << ": " << errors << " malformed rows" << std::endl;
+		resize(0, 0);
+		return false;
+	}
+
+	// Count targets
+	targetCount = 0;
+	for(size_t k = 0; k < targets.size(); k++)
+		targetCount += popcount64(targets[k]);
+
+	return true;
+}
+
+// Decode a row of characters into plane words
+int MazeGrid::decodeRow(const char * chars, int count, uint64_t * blockWords, uint64_t * targetWords)
+{
+	for(int j = 0; j < count; j += 64)
+	{
+		const char * c = chars + j;
+		int n = count - j < 64 ? count - j : 64;
+		uint64_t block = 0, target = 0, valid = 0;
+
+#ifdef MAZEGRID_SSE2
+		if(n == 64)
+		{
+			// Sixteen characters per compare
+			const __m128i zero = _mm_set1_epi8('0'), one = _mm_set1_epi8('1'), two = _mm_set1_epi8('2');
+			for(int q = 0; q < 4; q++)
+			{
+				__m128i v = _mm_loadu_si128((const __m128i *)(c + 16 * q));
+				uint64_t is0 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero));
+				uint64_t is1 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, one));
+				uint64_t is2 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, two));
+				block |= (is1 | is2) << (16 * q);
+				target |= is2 << (16 * q);
+				valid |= (is0 | is1 | is2) << (16 * q);
+			}
+		}
+		else
+#endif
+		{
+			for(int k = 0; k < n; k++)
+			{
+				uint64_t bit = (uint64_t)1 << k;
+				if(c[k] == '1' || c[k] == '2') block |= bit;
+				if(c[k] == '2') target |= bit;
+				if(c[k] >= '0' && c[k] <= '2') valid |= bit;
+			}
+		}
+
+		// Characters other than 0, 1 and 2
+		uint64_t expected = n == 64 ? ~(uint64_t)0 : (((uint64_t)1 << n) - 1);
+		if(valid != expected) return j + lowestBit64(~valid & expected);
+
+		blockWords[j >> 6] = block;
+		targetWords[j >> 6] = target;
+	}
+
+	return -1;
+}
+
+// Number of rows
+int MazeGrid::getRows() const
+{
+	return rows;
+}
+
+// Number of columns
+int MazeGrid::getCols() const
+{
+	return cols;
+}
+
+// Word holding cell
+size_t MazeGrid::wordIndex(int i, int j) const
+{
+	return (size_t)i * stride + (j >> 6);
+}
+
+// Set cell type
+void MazeGrid::setCell(int i, int j, int type)
+{
+	// Bound checking
+	if(i < 0 || i > rows - 1) return;
+	if(j < 0 || j > cols - 1) return;
+
+	size_t index = wordIndex(i, j);
+	uint64_t bit = (uint64_t)1 << (j & 63);
+	if(targets[index] & bit) targetCount--;
+
+	// 1 or 2 indicates blocks, 2 indicates targets
+	blocks[index] = (type == 1 || type == 2) ? (blocks[index] | bit) : (blocks[index] & ~bit);
+	targets[index] = type == 2 ? (targets[index] | bit) : (targets[index] & ~bit);
+	if(type == 2) targetCount++;
+}
+
+// Checking for blocks
+bool MazeGrid::isBlock(int i, int j) const
+{
+	// Bound checking
+	if(i < 0 || i > rows - 1) return false;
+	if(j < 0 || j > cols - 1) return false;
+
+	return (blocks[wordIndex(i, j)] >> (j & 63)) & 1;
+}
+
+// Checking for targets
+bool MazeGrid::isTarget(int i, int j) const
+{
+	// Bound checking
+	if(i < 0 || i > rows - 1) return false;
+	if(j < 0 || j > cols - 1) return false;
+
+	return (targets[wordIndex(i, j)] >> (j & 63)) & 1;
+}
+
+// Removing target
+bool MazeGrid::removeTarget(int i, int j)
+{
+	if(!isTarget(i, j)) return false;
+
+	targets[wordIndex(i, j)] &= ~((uint64_t)1 << (j & 63));
+	targetCount--;
+	return true;
+}
+
+// Number of targets left
+int MazeGrid::countTargets() const
+{
+	return targetCount;
+}
+
+// Number of targets left in a row
+int MazeGrid::countTargets(int row) const
+{
+	return countRow(targets, row, 0, cols);
+}
+
+// Number of targets left in tile
+int MazeGrid::countTargets(int i0, int j0, int i1, int j1) const
+{
+	if(i0 < 0) i0 = 0;
+	if(i1 > rows) i1 = rows;
+
+	int count = 0;
+	for(int i = i0; i < i1; i++)
+		count += countRow(targets, i, j0, j1);
+	return count;
+}
+
+// Count set bits of plane in row between columns [j0, j1)
+int MazeGrid::countRow(const std::vector<uint64_t> & plane, int row, int j0, int j1) const
+{
+	// Bound checking
+	if(row < 0 || row > rows - 1) return 0;
+	if(j0 < 0) j0 = 0;
+	if(j1 > cols) j1 = cols;
+	if(j0 >= j1) return 0;
+
+	const uint64_t * words = &plane[(size_t)row * stride];
+	int k0 = j0 >> 6, k1 = (j1 - 1) >> 6;
+	uint64_t first = ~(uint64_t)0 << (j0 & 63);
+	uint64_t last = ~(uint64_t)0 >> (63 - ((j1 - 1) & 63));
+
+	// Partial words at both ends, whole words between
+	if(k0 == k1) return popcount64(words[k0] & first & last);
+	int count = popcount64(words[k0] & first) + popcount64(words[k1] & last);
+	for(int k = k0 + 1; k < k1; k++)
+		count += popcount64(words[k]);
+	return count;
+}
+
+// First column at or after start in row whose block bit equals value
+int MazeGrid::scanRow(int row, int start, bool value) const
+{
+	if(start >= cols) return cols;
+	if(start < 0) start = 0;
+
+	// Looking for zeros is looking for ones in the complement
+	const uint64_t * words = &blocks[(size_t)row * stride];
+	uint64_t invert = value ? 0 : ~(uint64_t)0;
+	int k = start >> 6;
+	uint64_t word = (words[k] ^ invert) & (~(uint64_t)0 << (start & 63));
+
+	// Skip words without a match
+	while(word == 0)
+	{
+		k = skipWords(words, k + 1, stride, invert);
+		if(k >= stride) return cols;
+		word = words[k] ^ invert;
+	}
+
+	// Padding bits past cols are zero, clamp matches found there
+	int col = (k << 6) + lowestBit64(word);
+	return col < cols ? col : cols;
+}
+
+// Next run of blocks in row
+bool MazeGrid::findWalkableSpan(int row, int start, int & begin, int & end) const
+{
+	// Bound checking
+	if(row < 0 || row > rows - 1) return false;
+
+	begin = scanRow(row, start, true);
+	if(begin >= cols) return false;
+	end = scanRow(row, begin, false);
+	return true;
+}
+
+// Next block that differs between two mazes
+int MazeGrid::findBlockChange(const MazeGrid & other, int row, int start) const
+{
+	if(start >= cols) return cols;
+	if(start < 0) start = 0;
+
+	// Differences are the set bits of the exclusive or, padding bits are zero in both
+	const uint64_t * words = &blocks[(size_t)row * stride];
+	const uint64_t * otherWords = &other.blocks[(size_t)row * stride];
+	int k = start >> 6;
+	uint64_t word = (words[k] ^ otherWords[k]) & (~(uint64_t)0 << (start & 63));
+	while(word == 0)
+	{
+		if(++k >= stride) return cols;
+		word = words[k] ^ otherWords[k];
+	}
+
+	return (k << 6) + lowestBit64(word);
+}
+
+// Find targets closer than radius to position
+int MazeGrid::queryTargets(Vector3f position, float radius, float cellSize, float height, int * hitRows, int * hitCols, int maxHits) const
+{
+	return queryGridTargets(*this, position, radius, cellSize, height, hitRows, hitCols, maxHits);
+}
+
+// Find targets along segment
+int MazeGrid::sweepTargets(Vector3f start, Vector3f end, float radius, float cellSize, float height, int * hitRows, int * hitCols, int maxHits) const
+{
+	return sweepGridTargets(*this, start, end, radius, cellSize, height, hitRows, hitCols, maxHits);
+}
+
+// Bytes used by both bitplanes
+size_t MazeGrid::getMemoryBytes() const
+{
+	return (blocks.size() + targets.size()) * sizeof(uint64_t);
+}
+
+// Hash of dimensions and both bitplanes
+uint64_t MazeGrid::hash() const
+{
+	// FNV-1a over whole words, padding bits are always clear
+	const uint64_t prime = 1099511628211ULL;
+	uint64_t h = 14695981039346656037ULL;
+	h = (h ^ (uint64_t)rows) * prime;
+	h = (h ^ (uint64_t)cols) * prime;
+	for(size_t k = 0; k < blocks.size(); k++)
+		h = (h ^ blocks[k]) * prime;
+	for(size_t k = 0; k < targets.size(); k++)
+		h = (h ^ targets[k]) * prime;
+	return h;
+}
@@ -0,0 +1,231 @@
+#ifndef MAZEGRID_H_
+#define MAZEGRID_H_
+
+#include <Vector.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+/**
+ * Maze cells packed as block and target bitplanes, one bit per cell, rows padded to 64-bit words
+ */
+class MazeGrid
+{
+
+public:
+
+	//! Constructor
+	MazeGrid();
+
+	//! Constructor with dimensions, all cells empty
+	MazeGrid(int rows, int cols);
+
+	//! Set dimensions, all cells empty
+	void resize(int rows, int cols);
+
+	//! Load maze file through a memory mapping, one line of 0, 1 and 2 per row, dimensions taken from the file
+	bool loadFromFile(std::string filename);
+
+	//! Parse maze text, reports malformed rows and returns false for them
+	bool parse(const char * text, size_t size, std::string name);
+
+	//! Number of rows
+	int getRows() const;
+
+	//! Number of columns
+	int getCols() const;
+
+	//! Set cell type, 0 empty, 1 block, 2 block with target
+	void setCell(int i, int j, int type);
+
+	//! Checking for blocks, out of range is not a block
+	bool isBlock(int i, int j) const;
+
+	//! Checking for targets, out of range is not a target
+	bool isTarget(int i, int j) const;
+
+	//! Removing target, the block stays, returns whether there was one
+	bool removeTarget(int i, int j);
+
+	//! Number of targets left
+	int countTargets() const;
+
+	//! Number of targets left in a row
+	int countTargets(int row) const;
+
+	//! Number of targets left in tile of rows [i0, i1) and columns [j0, j1)
+	int countTargets(int i0, int j0, int i1, int j1) const;
+
+	//! Next run of blocks in row starting at or after column start, as columns [begin, end)
+	bool findWalkableSpan(int row, int start, int & begin, int & end) const;
+
+	//! First column at or after start in row whose block differs from other of the same dimensions, cols when none
+	int findBlockChange(const MazeGrid & other, int row, int start) const;
+
+	//! Find targets closer than radius to position, cells spaced cellSize apart at height, returns count
+	int queryTargets(Vector3f position, float radius, float cellSize, float height, int * hitRows, int * hitCols, int maxHits) const;
+
+	//! Find targets closer than radius to the segment from start to end, same cells as queryTargets, returns count
+	int sweepTargets(Vector3f start, Vector3f end, float radius, float cellSize, float height, int * hitRows, int * hitCols, int maxHits) const;
+
+	//! Bytes used by both bitplanes
+	size_t getMemoryBytes() const;
+
+	//! Hash of dimensions and both bitplanes, equal mazes hash equal
+	uint64_t hash() const;
+
+	//! Decode a row of characters into plane words, returns first invalid column or -1
+	static int decodeRow(const char * chars, int count, uint64_t * blockWords, uint64_t * targetWords);
+
+private:
+
+	//! Word holding cell and bit within it
+	size_t wordIndex(int i, int j) const;
+
+	//! Count set bits of plane in row between columns [j0, j1)
+	int countRow(const std::vector<uint64_t> & plane, int row, int j0, int j1) const;
+
+	//! First column at or after start in row whose bit equals value, cols when none
+	int scanRow(int row, int start, bool value) const;
+
+private:
+
+	//! Grid dimensions
+	int rows, cols;
+
+	//! Words per row
+	int stride;
+
+	//! Bitplanes, bit j % 64 of word i * stride + j / 64
+	std::vector<uint64_t> blocks;
+	std::vector<uint64_t> targets;
+
+	//! Number of targets left
+	int targetCount;
+
+};
+
+/**
+ * Find targets of any grid with getRows, getCols and isTarget closer than radius to position,
+ * visiting only the cells overlapped by the radius
+ */
+template<class Grid>
+int queryGridTargets(Grid & grid, Vector3f position, float radius, float cellSize, float height, int * hitRows, int * hitCols, int maxHits)
+{
+	int rows = grid.getRows(), cols = grid.getCols();
+
+	// Range of cells whose target can be within radius
+	float iMin = floorf((position.z - radius) / cellSize);
+	float iMax = ceilf((position.z + radius) / cellSize);
+	float jMin = floorf((position.x - radius) / cellSize);
+	float jMax = ceilf((position.x + radius) / cellSize);
+	if(!(iMax >= 0 && jMax >= 0 && iMin <= rows - 1 && jMin <= cols - 1)) return 0;
+
+	int i0 = iMin < 0 ? 0 : (int)iMin;
+	int i1 = iMax > rows - 1 ? rows - 1 : (int)iMax;
+	int j0 = jMin < 0 ? 0 : (int)jMin;
+	int j1 = jMax > cols - 1 ? cols - 1 : (int)jMax;
+
+	// Test targets in range
+	int found = 0;
+	for(int i = i0; i <= i1; i++)
+	for(int j = j0; j <= j1; j++)
+	{
+		if(!grid.isTarget(i, j)) continue;
+
+		Vector3f targetPosition(cellSize * j, height, cellSize * i);
+		if((position - targetPosition).length() < radius && found < maxHits)
+		{
+			hitRows[found] = i;
+			hitCols[found] = j;
+			found++;
+		}
+	}
+
+	return found;
+}
+
+/**
+ * Find targets of any grid closer than radius to the segment from start to end.
+ * Walks the cells the segment crosses in the ground plane with a grid DDA, widened by the cells radius can reach,
+ * so a step of any length finds every target it passes. Traversal stops once maxHits targets are found.
+ */
+template<class Grid>
+int sweepGridTargets(Grid & grid, Vector3f start, Vector3f end, float radius, float cellSize, float height, int * hitRows, int * hitCols, int maxHits)
+{
+	int rows = grid.getRows(), cols = grid.getCols();
+
+	// Segment in cell units, cell (i, j) is centred on (j, i)
+	float u0 = start.x / cellSize + 0.5f, v0 = start.z / cellSize + 0.5f;
+	float u1 = end.x / cellSize + 0.5f, v1 = end.z / cellSize + 0.5f;
+	float du = u1 - u0, dv = v1 - v0;
+
+	// Bounding box of the swept sphere, nothing to do outside the grid
+	float reach = ceilf(radius / cellSize - 0.5f);
+	if(reach < 0) reach = 0;
+	if(fmaxf(u0, u1) + reach < 0 || fmaxf(v0, v1) + reach < 0) return 0;
+	if(fminf(u0, u1) - reach >= cols || fminf(v0, v1) - reach >= rows) return 0;
+	int extra = (int)reach;
+
+	// DDA set up
+	int i = (int)floorf(v0), j = (int)floorf(u0);
+	int iEnd = (int)floorf(v1), jEnd = (int)floorf(u1);
+	int stepI = dv < 0 ? -1 : 1, stepJ = du < 0 ? -1 : 1;
+	float tDeltaI = dv != 0 ? 1 / fabsf(dv) : INFINITY;
+	float tDeltaJ = du != 0 ? 1 / fabsf(du) : INFINITY;
+	float tMaxI = dv != 0 ? (dv > 0 ? floorf(v0) + 1 - v0 : v0 - floorf(v0)) * tDeltaI : INFINITY;
+	float tMaxJ = du != 0 ? (du > 0 ? floorf(u0) + 1 - u0 : u0 - floorf(u0)) * tDeltaJ : INFINITY;
+	int steps = abs(iEnd - i) + abs(jEnd - j);
+
+	Vector3f segment = end - start;
+	float segmentLength2 = Vector3f::dot(segment, segment);
+
+	int found = 0;
+	for(int n = 0; n <= steps; n++)
+	{
+		// Crossed cell and the cells radius reaches from it
+		for(int ci = i - extra; ci <= i + extra; ci++)
+		for(int cj = j - extra; cj <= j + extra; cj++)
+		{
+			if(!grid.isTarget(ci, cj)) continue;
+
+			// Neighbours of consecutive cells overlap
+			bool seen = false;
+			for(int k = 0; k < found && extra > 0 && !seen; k++)
+				seen = hitRows[k] == ci && hitCols[k] == cj;
+			if(seen) continue;
+
+			// Closest point of segment to target
+			Vector3f targetPosition(cellSize * cj, height, cellSize * ci);
+			float t = segmentLength2 > 0 ? Vector3f::dot(targetPosition - start, segment) / segmentLength2 : 0;
+			if(t < 0) t = 0;
+			if(t > 1) t = 1;
+			Vector3f closest = start + segment * t;
+			if((closest - targetPosition).length() < radius)
+			{
+				hitRows[found] = ci;
+				hitCols[found] = cj;
+				if(++found == maxHits) return found;
+			}
+		}
+
+		// Next cell boundary crossed
+		if(tMaxJ < tMaxI)
+		{
+			j += stepJ;
+			tMaxJ += tDeltaJ;
+		}
+		else
+		{
+			i += stepI;
+			tMaxI += tDeltaI;
+		}
+	}
+
+	return found;
+}
+
+#endif
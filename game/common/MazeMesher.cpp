@@ -0,0 +1,205 @@
+#include "MazeMesher.h"
+
+#include <algorithm>
+
+//! Constructor
+MazeMesher::MazeMesher(float cellSize)
+: cellSize(cellSize), built(false), chunkRows(0), chunkCols(0), revision(0), triangleCount(0)
+{
+}
+
+// Mesh maze, rebuilding changed chunks
+int MazeMesher::update(const MazeGrid & maze)
+{
+	int rows = maze.getRows(), cols = maze.getCols();
+
+	if(!built || rows != meshed.getRows() || cols != meshed.getCols())
+	{
+		// New maze, everything is rebuilt
+		chunkRows = (rows + chunkSize - 1) / chunkSize;
+		chunkCols = (cols + chunkSize - 1) / chunkSize;
+		chunks.assign(chunkRows * chunkCols, Chunk());
+		dirty.assign(chunkRows * chunkCols, 1);
+		triangleCount = 0;
+		built = true;
+	}
+	else
+	{
+		// Blocks that appeared or disappeared since the last update, a whole word at a time
+		bool changed = false;
+		for(int i = 0; i < rows; i++)
+		{
+			for(int j = maze.findBlockChange(meshed, i, 0); j < cols; j = maze.findBlockChange(meshed, i, j + 1))
+			{
+				markCell(i, j);
+				changed = true;
+			}
+		}
+
+		// Target changes leave the blocks as they are
+		if(!changed) return 0;
+	}
+
+	meshed = maze;
+
+	// Rebuild marked chunks
+	int rebuilt = 0;
+	for(int ci = 0; ci < chunkRows; ci++)
+	for(int cj = 0; cj < chunkCols; cj++)
+	{
+		int k = ci * chunkCols + cj;
+		if(!dirty[k]) continue;
+
+		triangleCount -= chunks[k].indices.size() / 3;
+		buildChunk(ci, cj);
+		triangleCount += chunks[k].indices.size() / 3;
+		dirty[k] = 0;
+		rebuilt++;
+	}
+
+	return rebuilt;
+}
+
+// Chunk rows
+int MazeMesher::getChunkRows() const
+{
+	return chunkRows;
+}
+
+// Chunk columns
+int MazeMesher::getChunkCols() const
+{
+	return chunkCols;
+}
+
+// Chunk k
+const MazeMesher::Chunk & MazeMesher::getChunk(int k) const
+{
+	return chunks[k];
+}
+
+// Triangles in all chunks
+int MazeMesher::getTriangleCount() const
+{
+	return triangleCount;
+}
+
+// Mark chunks depending on a cell
+void MazeMesher::markCell(int i, int j)
+{
+	// The cell's own faces and the side faces its neighbours show towards it
+	const int di[5] = { 0, -1, 1, 0, 0 };
+	const int dj[5] = { 0, 0, 0, -1, 1 };
+	for(int n = 0; n < 5; n++)
+	{
+		int ni = i + di[n], nj = j + dj[n];
+		if(ni < 0 || nj < 0 || ni >= meshed.getRows() || nj >= meshed.getCols()) continue;
+		dirty[(ni / chunkSize) * chunkCols + nj / chunkSize] = 1;
+	}
+}
+
+// Rebuild chunk
+void MazeMesher::buildChunk(int ci, int cj)
+{
+	Chunk & chunk = chunks[ci * chunkCols + cj];
+	chunk.vertices.clear();
+	chunk.indices.clear();
+	chunk.revision = ++revision;
+
+	int i0 = ci * chunkSize, i1 = std::min(i0 + chunkSize, meshed.getRows());
+	int j0 = cj * chunkSize, j1 = std::min(j0 + chunkSize, meshed.getCols());
+	int width = j1 - j0;
+	float half = cellSize * 0.5f;
+
+	Vector3f alongX(cellSize, 0, 0), alongY(0, cellSize, 0), alongZ(0, 0, cellSize);
+
+	// Tops and bottoms, grown along the row as far as possible and then down while whole rows fit
+	covered.assign((i1 - i0) * width, 0);
+	for(int i = i0; i < i1; i++)
+	for(int j = j0; j < j1; j++)
+	{
+		if(!meshed.isBlock(i, j) || covered[(i - i0) * width + j - j0]) continue;
+
+		int jEnd = j + 1;
+		while(jEnd < j1 && meshed.isBlock(i, jEnd) && !covered[(i - i0) * width + jEnd - j0]) jEnd++;
+
+		int iEnd = i + 1;
+		while(iEnd < i1)
+		{
+			bool fits = true;
+			for(int k = j; k < jEnd && fits; k++)
+				fits = meshed.isBlock(iEnd, k) && !covered[(iEnd - i0) * width + k - j0];
+			if(!fits) break;
+			iEnd++;
+		}
+
+		for(int a = i; a < iEnd; a++)
+			for(int b = j; b < jEnd; b++)
+				covered[(a - i0) * width + b - j0] = 1;
+
+		float w = (float)(jEnd - j), h = (float)(iEnd - i);
+		Vector3f corner(cellSize * j - half, 0, cellSize * i - half);
+		addQuad(chunk, corner, alongZ * h, alongX * w, Vector3f(0, 1, 0), h, w);
+		addQuad(chunk, corner - alongY, alongX * w, alongZ * h, Vector3f(0, -1, 0), w, h);
+	}
+
+	// Faces towards -z and +z, runs along each row
+	for(int i = i0; i < i1; i++)
+	for(int side = -1; side <= 1; side += 2)
+	{
+		for(int j = j0; j < j1; j++)
+		{
+			if(!meshed.isBlock(i, j) || meshed.isBlock(i + side, j)) continue;
+
+			int jEnd = j + 1;
+			while(jEnd < j1 && meshed.isBlock(i, jEnd) && !meshed.isBlock(i + side, jEnd)) jEnd++;
+
+			float w = (float)(jEnd - j);
+			Vector3f corner(cellSize * j - half, -cellSize, cellSize * i + half * side);
+			if(side < 0)
+				addQuad(chunk, corner, alongY, alongX * w, Vector3f(0, 0, -1), 1, w);
+			else
+				addQuad(chunk, corner, alongX * w, alongY, Vector3f(0, 0, 1), w, 1);
+			j = jEnd;
+		}
+	}
+
+	// Faces towards -x and +x, runs along each column
+	for(int j = j0; j < j1; j++)
+	for(int side = -1; side <= 1; side += 2)
+	{
+		for(int i = i0; i < i1; i++)
+		{
+			if(!meshed.isBlock(i, j) || meshed.isBlock(i, j + side)) continue;
+
+			int iEnd = i + 1;
+			while(iEnd < i1 && meshed.isBlock(iEnd, j) && !meshed.isBlock(iEnd, j + side)) iEnd++;
+
+			float h = (float)(iEnd - i);
+			Vector3f corner(cellSize * j + half * side, -cellSize, cellSize * i - half);
+			if(side < 0)
+				addQuad(chunk, corner, alongZ * h, alongY, Vector3f(-1, 0, 0), h, 1);
+			else
+				addQuad(chunk, corner, alongY, alongZ * h, Vector3f(1, 0, 0), 1, h);
+			i = iEnd;
+		}
+	}
+}
+
+// Append quad
+void MazeMesher::addQuad(Chunk & chunk, Vector3f corner, Vector3f edgeU, Vector3f edgeV, Vector3f normal, float u, float v)
+{
+	unsigned short base = (unsigned short)(chunk.vertices.size() / vertexFloats);
+	Vector3f positions[4] = { corner, corner + edgeU, corner + edgeU + edgeV, corner + edgeV };
+	float texcoords[4][2] = { { 0, 0 }, { u, 0 }, { u, v }, { 0, v } };
+
+	for(int k = 0; k < 4; k++)
+	{
+		float vertex[vertexFloats] = { positions[k].x, positions[k].y, positions[k].z, normal.x, normal.y, normal.z, texcoords[k][0], texcoords[k][1] };
+		chunk.vertices.insert(chunk.vertices.end(), vertex, vertex + vertexFloats);
+	}
+
+	const unsigned short quad[6] = { 0, 1, 2, 0, 2, 3 };
+	for(int k = 0; k < 6; k++)
+		chunk.indices.push_back(base + quad[k]);
+}
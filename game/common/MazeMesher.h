@@ -0,0 +1,88 @@
+#ifndef MAZEMESHER_H_
+#define MAZEMESHER_H_
+
+#include <MazeGrid.h>
+#include <Vector.h>
+#include <vector>
+
+/**
+ * Static mesh of all maze blocks, split into chunks of chunkSize x chunkSize cells.
+ * Only faces not buried against a neighbouring block are kept, and coplanar faces are merged
+ * into rectangles, tops and bottoms greedily in two dimensions and sides along rows and columns.
+ * Vertices are in world space, interleaved like Mesh, with tex coords counted in cells for a repeating texture.
+ * update compares the maze against the one last meshed and rebuilds only the chunks whose faces changed.
+ */
+class MazeMesher
+{
+
+public:
+
+	//! Cells per chunk side, small enough for 16-bit indices with every cell exposed on all sides
+	static const int chunkSize = 32;
+
+	//! Floats per vertex, position, normal and tex coord
+	enum { vertexFloats = 8 };
+
+	//! Geometry of one chunk
+	struct Chunk
+	{
+		std::vector<float> vertices;
+		std::vector<unsigned short> indices;
+
+		//! Changes whenever the chunk is rebuilt, never zero once built
+		unsigned int revision;
+	};
+
+	//! Constructor, blocks are cellSize cubes centred on their cell with the top at height zero
+	MazeMesher(float cellSize);
+
+	//! Mesh maze, rebuilding the changed chunks only, returns the number of chunks rebuilt
+	int update(const MazeGrid & maze);
+
+	//! Chunk grid dimensions
+	int getChunkRows() const;
+	int getChunkCols() const;
+
+	//! Chunk k, row-major in the chunk grid
+	const Chunk & getChunk(int k) const;
+
+	//! Triangles in all chunks
+	int getTriangleCount() const;
+
+private:
+
+	//! Mark the chunks whose faces depend on cell (i, j)
+	void markCell(int i, int j);
+
+	//! Rebuild chunk at chunk row ci and chunk column cj
+	void buildChunk(int ci, int cj);
+
+	//! Append quad from corner spanning edgeU and edgeV, counter-clockwise seen from the side normal points to
+	void addQuad(Chunk & chunk, Vector3f corner, Vector3f edgeU, Vector3f edgeV, Vector3f normal, float u, float v);
+
+private:
+
+	//! Block size
+	float cellSize;
+
+	//! Maze as last meshed
+	MazeGrid meshed;
+	bool built;
+
+	//! Chunks and which of them need rebuilding
+	int chunkRows, chunkCols;
+	std::vector<Chunk> chunks;
+	std::vector<char> dirty;
+
+	//! Last revision given to a chunk
+	unsigned int revision;
+
+	//! Triangles in all chunks
+	int triangleCount;
+
+	//! Cells of the chunk being built already covered by a merged top
+	std::vector<char> covered;
+
+};
+
+#endif
@@ -1,7 +1,33 @@
 #include "Mesh.h"
 
+#include <MeshOptimizer.h>
+#include <ObjParser.h>
+#include <math.h>
+#include <string.h>
+
+//Meshes constructed so far
+unsigned int Mesh::meshCount = 0;
+
+//Levels of detail, triangle ratios and the screen sizes they are drawn below
+const float Mesh::levelTriangleRatio[Mesh::maxLevels] = { 1.0f, 0.5f, 0.25f, 0.1f };
+const float Mesh::levelScreenSize[Mesh::maxLevels] = { 0, 160, 80, 32 };
+const float Mesh::levelHysteresis = 0.15f;
+
+//Caches hold as many levels as meshes build
+static_assert((int)Mesh::maxLevels == (int)MeshCache::maxLevels, "mesh cache level count");
+
 //
-bool Mesh::loadOBJ(std::string filename)
+bool Mesh::loadOBJ(std::string filename, bool levelsOfDetail)
+{
+	if(!prepareOBJ(filename, levelsOfDetail))
+		return false;
+
+	upload();
+	return true;
+}
+
+//Read OBJ file or its cache without OpenGL
+bool Mesh::prepareOBJ(std::string filename, bool levelsOfDetail)
 {
 	/**
 	 * OBJ file format:
@@ -11,203 +37,505 @@ bool Mesh::loadOBJ(std::string filename)
 	 * 'vn' = vertex normals: 3 floats x-y-z
 	 * 'f'  = faces are represented by a set of id numbers separated by a "/" and space :vertex_id/texture_id/normal_id
 	 *  For example: f v1/vt1/vn1 v2/vt2/vn2 v3/vt3/vn3
+	 *  Faces may have more than three corners, leave out texture_id or normal_id (f v1//vn1 ..., f v1 ...),
+	 *  and negative ids count back from the last one read
 	 */
 
-	std::ifstream filestream;
-	filestream.open(filename.c_str());
-	
-	std::string line_stream;
-	while(std::getline(filestream, line_stream))
+	//Buffers straight from the binary cache while it was built from this OBJ file
+	std::string cacheName = MeshCache::getCacheName(filename);
+	if(!MeshCache::isStale(filename, cacheName) && openCache(cacheName, levelsOfDetail))
+		return true;
+
+	//Source stamped before it is read, so a change while parsing leaves the cache stale
+	MeshCache::Source source;
+	MeshCache::getSource(filename, source);
+
+	//Single pass over the mapped file, faces come back as triangles
+	ObjParser parser;
+	if(!parser.load(filename))
+		return false;
+
+	const std::vector<float> & p = parser.getPositions();
+	const std::vector<float> & t = parser.getTexcoords();
+	const std::vector<float> & n = parser.getNormals();
+	const std::vector<ObjParser::Corner> & corners = parser.getCorners();
+	positions.reserve(p.size() / 3);
+	for(size_t i = 0; i < p.size(); i += 3) positions.push_back(Vector3f(p[i], p[i + 1], p[i + 2]));
+	texcoords.reserve(t.size() / 2);
+	for(size_t i = 0; i < t.size(); i += 2) texcoords.push_back(Vector2f(t[i], t[i + 1]));
+	normals.reserve(n.size() / 3);
+	for(size_t i = 0; i < n.size(); i += 3) normals.push_back(Vector3f(n[i], n[i + 1], n[i + 2]));
+
+	//Corners without a tex coord share one at the origin, those without a normal get their face's normal
+	int missingTexcoord = -1;
+	faces.reserve(corners.size() / 3);
+	for(size_t corner_i = 0; corner_i < corners.size(); corner_i += 3)
 	{
-		std::stringstream str_stream(line_stream);
-		std::string type_str;
-		str_stream >> type_str;
-	
-		if(type_str == "v")
+		const ObjParser::Corner * corner = &corners[corner_i];
+		int faceNormal = -1;
+		Face face;
+		for(int i = 0; i < 3; ++i)
 		{
-			Vector3f position;
-			str_stream >> position.x >> position.y >> position.z;
-			positions.push_back(position);
-		}
-		else if(type_str == "vt")
-		{
-			Vector2f texture;
-			str_stream >> texture.x >> texture.y;
-			texcoords.push_back(texture);
-		}
-		else if(type_str == "vn")
-		{
-			Vector3f normal;
-			str_stream >> normal.x >> normal.y >> normal.z;
-			normals.push_back(normal);
-		}
-		else if(type_str == "f")
-		{
-			char temp;
-			Face face;
-			unsigned int v1,v2,v3;
-			for(int i = 0; i < 3; ++i)
+			if(corner[i].texcoord < 0 && missingTexcoord < 0)
 			{
-				str_stream >> v1 >> temp >> v2  >> temp >> v3;
-				face.position_index.push_back(v1-1);
-				face.texturecoord_index.push_back(v2-1);
-				face.normal_index.push_back(v3-1);
+				missingTexcoord = texcoords.size();
+				texcoords.push_back(Vector2f(0, 0));
 			}
-			faces.push_back(face);
+			if(corner[i].normal < 0 && faceNormal < 0)
+			{
+				Vector3f a = positions[corner[1].position] - positions[corner[0].position];
+				Vector3f b = positions[corner[2].position] - positions[corner[0].position];
+				Vector3f normal = Vector3f::cross(a, b);
+				float length = normal.length();
+				faceNormal = normals.size();
+				normals.push_back(length > 0 ? normal * (1 / length) : Vector3f(0, 1, 0));
+			}
+			face.position_index[i] = corner[i].position;
+			face.texturecoord_index[i] = corner[i].texcoord >= 0 ? corner[i].texcoord : missingTexcoord;
+			face.normal_index[i] = corner[i].normal >= 0 ? corner[i].normal : faceNormal;
 		}
+		faces.push_back(face);
 	}
-	
-	// Explicit closing of the file
-	filestream.close();
 
-	//Report Input
-	std::cout 	<< "Loaded " 			<< filename 		<< "\n" 
+	buildBuffers(levelsOfDetail);
+	writeCache(cacheName, source, levelsOfDetail);
+
+	//Report Input, written at once as loads may run in parallel
+	std::ostringstream report;
+	report 		<< "Loaded " 			<< filename 		<< "\n" 
 				<< "\t Positions: " 	<< positions.size() << "\n" 
 				<< "\t Normals: " 		<< normals.size() 	<< "\n" 
 				<< "\t Tex Coords: " 	<< texcoords.size() << "\n" 
-				<< "\t Faces: " 		<< faces.size() 	<< "\n" << std::endl;
-				
+				<< "\t Faces: " 		<< faces.size() 	<< "\n" 
+				<< "\t Vertices: " 	<< vertexCount 		<< "\n" 
+				<< "\t ACMR: " 		<< fileOrderACMR 	<< " file order, " << optimizedACMR << " optimized\n";
+	for(int level = 1; level < levelCount; level++)
+		report << "\t LOD " << level << ": " << levelIndexCount[level] / 3 << " triangles, error " << levelError[level] << "\n";
+	std::cout << report.str() << std::endl;
 				
-	initBuffers();
 	return true;
 }
 
 //! Init Vertex array Buffers
-void Mesh::initBuffers()
+void Mesh::initBuffers(bool levelsOfDetail)
 {
-	//std::cout << "Start Init Mesh Buffers" << std::endl;
-	
-	// init buffers
-	glGenBuffers(1, &positionBuffer);
-	glGenBuffers(1, &normalBuffer);
-	glGenBuffers(1, &texcoordBuffer);
-	
-	//Data
-	std::vector<GLfloat> vertexPositionData;
-	std::vector<GLfloat> vertexNormalData;
-	std::vector<GLfloat> vertexTexcoordData;
+	buildBuffers(levelsOfDetail);
+	upload();
+}
+
+//Build buffer data from faces
+void Mesh::buildBuffers(bool levelsOfDetail)
+{
+	computeBounds();
+	attributes = (positions.size() > 0 ? MeshCache::hasPositions : 0) | (normals.size() > 0 ? MeshCache::hasNormals : 0) |
+		(texcoords.size() > 0 ? MeshCache::hasTexcoords : 0);
 
-	//Go through each face and add to to lists
+	//Position, normal and tex coord index of every face corner
+	std::vector<unsigned int> triplets;
+	triplets.reserve(faces.size() * 9);
 	for(int face_i = 0 ; face_i < faces.size(); face_i++)
 	{
-		Face face = faces[face_i];
-		
+		const Face & face = faces[face_i];
 		for(int vertex_i = 0 ; vertex_i < 3; vertex_i++)
 		{
-			if(positions.size() > 0)
-			{
-				Vector3f v = positions[face.position_index[vertex_i]];
-				vertexPositionData.push_back(v.x);
-				vertexPositionData.push_back(v.y);
-				vertexPositionData.push_back(v.z);
-			}
-			
-			//Add Normals
-			if(normals.size() > 0)
-			{
-				Vector3f n = normals[face.normal_index[vertex_i]];
-				vertexNormalData.push_back(n.x);
-				vertexNormalData.push_back(n.y);
-				vertexNormalData.push_back(n.z);
-			}
-			
-			//Add texture Coords
-			if(texcoords.size() > 0)
-			{
-				Vector2f t = texcoords[face.texturecoord_index[vertex_i]];
-				vertexTexcoordData.push_back(t.x);
-				vertexTexcoordData.push_back(t.y);
-			}
+			triplets.push_back(positions.size() > 0 ? face.position_index[vertex_i] : 0);
+			triplets.push_back(normals.size() > 0 ? face.normal_index[vertex_i] : 0);
+			triplets.push_back(texcoords.size() > 0 ? face.texturecoord_index[vertex_i] : 0);
 		}
 	}
-	
-	//Set Data for Position buffer
-	if(positions.size() > 0)
+
+	//Corners sharing all three indices become one vertex, then triangles are reordered for the post-transform cache
+	std::vector<unsigned int> indices;
+	std::vector<unsigned int> unique = MeshOptimizer::deduplicate(triplets, indices);
+	vertexCount = unique.size() / 3;
+	indexCount = indices.size();
+	fileOrderACMR = MeshOptimizer::computeACMR(indices, vertexCount);
+	std::vector<unsigned int> reordered(indices);
+	MeshOptimizer::optimizeVertexCache(reordered, vertexCount);
+	optimizedACMR = MeshOptimizer::computeACMR(reordered, vertexCount);
+
+	//Exported orders that are already as good are kept
+	if(optimizedACMR < fileOrderACMR) indices.swap(reordered);
+	else optimizedACMR = fileOrderACMR;
+	levelCount = 1;
+	levelFirst[0] = 0;
+	levelIndexCount[0] = indexCount;
+	levelError[0] = 0;
+
+	//Interleaved data, position, normal and tex coord of each vertex together
+	vertexData.clear();
+	vertexData.reserve(vertexCount * vertexFloats);
+	for(int vertex_i = 0 ; vertex_i < vertexCount; vertex_i++)
 	{
-		glBindBuffer(GL_ARRAY_BUFFER, positionBuffer);
-		glBufferData(GL_ARRAY_BUFFER, vertexPositionData.size() * sizeof(GLfloat), &vertexPositionData[0], GL_STATIC_DRAW);
+		Vector3f v, n;
+		Vector2f t;
+		if(positions.size() > 0) v = positions[unique[3 * vertex_i]];
+		if(normals.size() > 0) n = normals[unique[3 * vertex_i + 1]];
+		if(texcoords.size() > 0) t = texcoords[unique[3 * vertex_i + 2]];
+
+		GLfloat vertex[vertexFloats] = { v.x, v.y, v.z, n.x, n.y, n.z, t.x, t.y };
+		vertexData.insert(vertexData.end(), vertex, vertex + vertexFloats);
+	}
+
+	//Simplified levels each from the one before, appended to the indices and sharing the vertices
+	if(levelsOfDetail && vertexCount > 0)
+	{
+		std::vector<unsigned int> level(indices);
+		for(int level_i = 1; level_i < maxLevels; level_i++)
+		{
+			unsigned int target = 3 * (unsigned int)(indexCount / 3 * levelTriangleRatio[level_i] + 0.5f);
+			float error = MeshOptimizer::simplify(level, &vertexData[0], vertexFloats, vertexCount, target);
+			if(level.size() >= (size_t)levelIndexCount[levelCount - 1]) break;
+			MeshOptimizer::optimizeVertexCache(level, vertexCount);
+			levelFirst[levelCount] = indices.size();
+			levelIndexCount[levelCount] = level.size();
+			levelError[levelCount] = error;
+			levelCount++;
+			indices.insert(indices.end(), level.begin(), level.end());
+		}
 	}
 	
-	//Set Data for Normal buffer
-	if(normals.size() > 0)
+	//16 bit indices whenever they fit
+	indexData.clear();
+	shortIndexData.clear();
+	if(vertexCount <= 65536)
+	{
+		shortIndexData.assign(indices.begin(), indices.end());
+		indexType = GL_UNSIGNED_SHORT;
+	}
+	else
 	{
-		glBindBuffer(GL_ARRAY_BUFFER, normalBuffer);
-		glBufferData(GL_ARRAY_BUFFER, vertexNormalData.size() * sizeof(GLfloat), &vertexNormalData[0], GL_STATIC_DRAW);
+		indexData.swap(indices);
+		indexType = GL_UNSIGNED_INT;
 	}
+}
 
-	//set data for texcoord buffer
-	if(texcoords.size() > 0)
+//Map cache and take its mesh values
+bool Mesh::openCache(std::string cacheName, bool levelsOfDetail)
+{
+	if(!cache.open(cacheName)) return false;
+
+	//Built with other options or another vertex layout, rebuilt from the OBJ file instead
+	const MeshCache::Header & header = cache.getHeader();
+	if(header.levelsOfDetail != (levelsOfDetail ? 1u : 0u) || header.vertexFloats != vertexFloats)
 	{
-		glBindBuffer(GL_ARRAY_BUFFER, texcoordBuffer);
-		glBufferData(GL_ARRAY_BUFFER, vertexTexcoordData.size() * sizeof(GLfloat), &vertexTexcoordData[0], GL_STATIC_DRAW);
+		cache.close();
+		return false;
 	}
-	//std::cout << "End Init Mesh Buffers" << std::endl;
 
+	attributes = header.attributes;
+	vertexCount = header.vertexCount;
+	indexType = header.indexSize == sizeof(GLushort) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	levelCount = header.levelCount;
+	for(int level = 0; level < levelCount; level++)
+	{
+		levelFirst[level] = header.levelFirst[level];
+		levelIndexCount[level] = header.levelIndexCount[level];
+		levelError[level] = header.levelError[level];
+	}
+	indexCount = levelIndexCount[0];
+	fileOrderACMR = header.fileOrderACMR;
+	optimizedACMR = header.optimizedACMR;
+	boundsMin = Vector3f(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+	boundsMax = Vector3f(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+	boundingCenter = Vector3f(header.boundingCenter[0], header.boundingCenter[1], header.boundingCenter[2]);
+	boundingRadius = header.boundingRadius;
+	centroid = Vector3f(header.centroid[0], header.centroid[1], header.centroid[2]);
+
+	//Report Input
+	std::ostringstream report;
+	report 		<< "Loaded " 			<< cacheName 		<< "\n"
+				<< "\t Vertices: " 	<< vertexCount 		<< "\n"
+				<< "\t Triangles: " 	<< indexCount / 3 	<< "\n";
+	for(int level = 1; level < levelCount; level++)
+		report << "\t LOD " << level << ": " << levelIndexCount[level] / 3 << " triangles, error " << levelError[level] << "\n";
+	std::cout << report.str() << std::endl;
+
+	return true;
+}
+
+//Create OpenGL buffers from prepared data
+void Mesh::upload()
+{
+	//Buffer data read by the driver from the cache mapping, never copied to the heap
+	if(cache.isOpen())
+	{
+		uploadBuffers(cache.getVertices(), cache.getVertexBytes(), cache.getIndices(), cache.getIndexBytes());
+		cache.close();
+		return;
+	}
+
+	size_t indexBytes = shortIndexData.size() * sizeof(GLushort) + indexData.size() * sizeof(GLuint);
+	uploadBuffers(vertexData.empty() ? NULL : &vertexData[0], vertexData.size() * sizeof(GLfloat), getBuiltIndices(), indexBytes);
+
+	//Data now lives in the buffers
+	std::vector<GLfloat>().swap(vertexData);
+	std::vector<GLuint>().swap(indexData);
+	std::vector<GLushort>().swap(shortIndexData);
+}
+
+//Save built buffers to a binary cache
+void Mesh::writeCache(std::string cacheName, const MeshCache::Source & source, bool levelsOfDetail)
+{
+	MeshCache::Header header;
+	memset(&header, 0, sizeof(header));
+	header.source = source;
+	header.levelsOfDetail = levelsOfDetail ? 1 : 0;
+	header.attributes = attributes;
+	header.vertexCount = vertexCount;
+	header.vertexFloats = vertexFloats;
+	header.indexCount = shortIndexData.size() + indexData.size();
+	header.indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+	header.levelCount = levelCount;
+	for(int level = 0; level < levelCount; level++)
+	{
+		header.levelFirst[level] = levelFirst[level];
+		header.levelIndexCount[level] = levelIndexCount[level];
+		header.levelError[level] = levelError[level];
+	}
+	const Vector3f * vectors[4] = { &boundsMin, &boundsMax, &boundingCenter, &centroid };
+	float * fields[4] = { header.boundsMin, header.boundsMax, header.boundingCenter, header.centroid };
+	for(int i = 0; i < 4; i++)
+	{
+		fields[i][0] = vectors[i]->x;
+		fields[i][1] = vectors[i]->y;
+		fields[i][2] = vectors[i]->z;
+	}
+	header.boundingRadius = boundingRadius;
+	header.fileOrderACMR = fileOrderACMR;
+	header.optimizedACMR = optimizedACMR;
+
+	//A cache that cannot be written only costs the next load a rebuild
+	MeshCache::write(cacheName, header, vertexData.empty() ? NULL : &vertexData[0], getBuiltIndices());
+}
+
+//Built indices in the index type
+const void * Mesh::getBuiltIndices() const
+{
+	if(indexType == GL_UNSIGNED_SHORT) return shortIndexData.empty() ? NULL : &shortIndexData[0];
+	return indexData.empty() ? NULL : &indexData[0];
+}
+
+//Create buffers and set their data
+void Mesh::uploadBuffers(const void * vertices, size_t vertexBytes, const void * indices, size_t indexBytes)
+{
+	// init buffers
+	glGenBuffers(1, &vertexBuffer);
+	glGenBuffers(1, &indexBuffer);
+
+	//Set Data for vertex buffer
+	if(vertexBytes > 0)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+		glBufferData(GL_ARRAY_BUFFER, vertexBytes, vertices, GL_STATIC_DRAW);
+	}
+
+	//Set Data for index buffer
+	if(indexBytes > 0)
+	{
+		// The element binding belongs to the bound vertex array object, keep it off whichever mesh was drawn last
+		if(GLEW_VERSION_3_0 || GLEW_ARB_vertex_array_object) glBindVertexArray(0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, indices, GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+}
+
+//Compute bounding box and sphere and the centroid of positions
+void Mesh::computeBounds()
+{
+	if(positions.size() == 0) return;
+
+	//Box of all positions
+	boundsMin = boundsMax = positions[0];
+	for(size_t i = 1; i < positions.size(); i++)
+	{
+		const Vector3f & v = positions[i];
+		boundsMin = Vector3f(fminf(boundsMin.x, v.x), fminf(boundsMin.y, v.y), fminf(boundsMin.z, v.z));
+		boundsMax = Vector3f(fmaxf(boundsMax.x, v.x), fmaxf(boundsMax.y, v.y), fmaxf(boundsMax.z, v.z));
+	}
+
+	//Sphere around the box centre reaching the furthest position
+	boundingCenter = (boundsMin + boundsMax) * 0.5f;
+	boundingRadius = 0;
+	for(size_t i = 0; i < positions.size(); i++)
+	{
+		float distance = (positions[i] - boundingCenter).length();
+		if(distance > boundingRadius) boundingRadius = distance;
+	}
+
+	//Average position
+	float x = 0.f, y = 0.f, z = 0.f;
+	for(size_t i = 0; i < positions.size(); i++)
+	{
+		x += positions[i].x;
+		y += positions[i].y;
+		z += positions[i].z;
+	}
+	centroid = Vector3f(x / positions.size(), y / positions.size(), z / positions.size());
+}
+
+//Bind attribute state, captured once in a vertex array object when available
+void Mesh::bindVertexArray(GLuint vertexPositionAttribute, GLuint vertexNormalAttribute, GLuint vertexTexcordAttribute)
+{
+	bool vertexArrays = GLEW_VERSION_3_0 || GLEW_ARB_vertex_array_object;
+	if(!vertexArrays)
+	{
+		enableAttributes(vertexPositionAttribute, vertexNormalAttribute, vertexTexcordAttribute);
+		return;
+	}
+
+	// Rebuilt only when drawn with other attribute locations
+	if(vertexArray == 0 || arrayAttributes[0] != vertexPositionAttribute || arrayAttributes[1] != vertexNormalAttribute || arrayAttributes[2] != vertexTexcordAttribute)
+	{
+		if(vertexArray == 0) glGenVertexArrays(1, &vertexArray);
+		glBindVertexArray(vertexArray);
+		if(arrayAttributes[0] != (GLuint)-1) disableAttributes(arrayAttributes[0], arrayAttributes[1], arrayAttributes[2]);
+		enableAttributes(vertexPositionAttribute, vertexNormalAttribute, vertexTexcordAttribute);
+		arrayAttributes[0] = vertexPositionAttribute;
+		arrayAttributes[1] = vertexNormalAttribute;
+		arrayAttributes[2] = vertexTexcordAttribute;
+		return;
+	}
+
+	glBindVertexArray(vertexArray);
+}
+
+//Unbind attribute state
+void Mesh::unbindVertexArray(GLuint vertexPositionAttribute, GLuint vertexNormalAttribute, GLuint vertexTexcordAttribute)
+{
+	// A vertex array object keeps its state, the next draw binds another one
+	bool vertexArrays = GLEW_VERSION_3_0 || GLEW_ARB_vertex_array_object;
+	if(!vertexArrays) disableAttributes(vertexPositionAttribute, vertexNormalAttribute, vertexTexcordAttribute);
 }
 
 //Function to draw a mesh 
 void Mesh::Draw(GLuint vertexPositionAttribute, GLuint vertexNormalAttribute, GLuint vertexTexcordAttribute)
 {
-	// Vertex Position attribute and buffer
-	if(positions.size() > 0)
+	Bind(vertexPositionAttribute, vertexNormalAttribute, vertexTexcordAttribute);
+	DrawBound();
+	Unbind(vertexPositionAttribute, vertexNormalAttribute, vertexTexcordAttribute);
+}
+
+//Bind vertex state for several draws
+void Mesh::Bind(GLuint vertexPositionAttribute, GLuint vertexNormalAttribute, GLuint vertexTexcordAttribute)
+{
+	bindVertexArray(vertexPositionAttribute, vertexNormalAttribute, vertexTexcordAttribute);
+}
+
+//Draw with bound state
+void Mesh::DrawBound(int level)
+{
+	//Draw Elements of the level's index range
+	size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+	glDrawElements(GL_TRIANGLES, levelIndexCount[level], indexType, (void*)(levelFirst[level] * indexSize));
+}
+
+//Level to draw at a projected size
+int Mesh::selectLevel(float screenSize, int level) const
+{
+	if(level >= levelCount) level = levelCount - 1;
+	if(level < 0) level = 0;
+
+	//Coarser once well below the switch size, finer once well above it
+	while(level + 1 < levelCount && screenSize < levelScreenSize[level + 1] * (1 - levelHysteresis)) level++;
+	while(level > 0 && screenSize > levelScreenSize[level] * (1 + levelHysteresis)) level--;
+	return level;
+}
+
+//Undo Bind
+void Mesh::Unbind(GLuint vertexPositionAttribute, GLuint vertexNormalAttribute, GLuint vertexTexcordAttribute)
+{
+	unbindVertexArray(vertexPositionAttribute, vertexNormalAttribute, vertexTexcordAttribute);
+}
+
+//Function to draw many copies of a mesh in one call
+void Mesh::DrawInstanced(GLsizei instanceCount, GLuint instanceBuffer, GLuint vertexInstanceAttribute, GLuint vertexPositionAttribute, GLuint vertexNormalAttribute, GLuint vertexTexcordAttribute)
+{
+	bindVertexArray(vertexPositionAttribute, vertexNormalAttribute, vertexTexcordAttribute);
+
+	// One vec4 per instance, enabled only for this draw so single draws see the constant value
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	glEnableVertexAttribArray(vertexInstanceAttribute);
+	glVertexAttribPointer(vertexInstanceAttribute, 4, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	glVertexAttribDivisor(vertexInstanceAttribute, 1);
+
+	//Draw Elements once per instance
+	glDrawElementsInstanced(GL_TRIANGLES, indexCount, indexType, (void*)0, instanceCount);
+
+	glVertexAttribDivisor(vertexInstanceAttribute, 0);
+	glDisableVertexAttribArray(vertexInstanceAttribute);
+
+	unbindVertexArray(vertexPositionAttribute, vertexNormalAttribute, vertexTexcordAttribute);
+}
+
+//Enable and point vertex attributes into the interleaved buffer
+void Mesh::enableAttributes(GLuint vertexPositionAttribute, GLuint vertexNormalAttribute, GLuint vertexTexcordAttribute)
+{
+	const GLsizei stride = vertexFloats * sizeof(GLfloat);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+
+	// Index buffer binding is part of the vertex array object state
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+
+	// Vertex Position attribute
+	if(attributes & MeshCache::hasPositions)
 	{
 		glEnableVertexAttribArray(vertexPositionAttribute);
-		glBindBuffer(GL_ARRAY_BUFFER, positionBuffer);
 		glVertexAttribPointer(
 			vertexPositionAttribute, 		// The attribute we want to configure
 			3,                  			// size
 			GL_FLOAT,        			    // type
 			GL_FALSE,           			// normalized?
-			0,                  			// stride
+			stride,            			// stride
 			(void*)0            			// array buffer offset
 		);
 	}
 
-	if(normals.size() > 0 && vertexNormalAttribute != -1)
+	if((attributes & MeshCache::hasNormals) && vertexNormalAttribute != -1)
 	{
 		glEnableVertexAttribArray(vertexNormalAttribute);
-		glBindBuffer(GL_ARRAY_BUFFER, normalBuffer);
 		glVertexAttribPointer(
 			vertexNormalAttribute, 		// The attribute we want to configure
 			3,                 		 	// size
 			GL_FLOAT,           		// type
 			GL_FALSE,           		// normalized?
-			0,                  		// stride
-			(void*)0           			// array buffer offset
+			stride,            		// stride
+			(void*)(3 * sizeof(GLfloat)) // array buffer offset
 		);
 	}
 
-	if(texcoords.size() > 0 && vertexTexcordAttribute != -1)
+	if((attributes & MeshCache::hasTexcoords) && vertexTexcordAttribute != -1)
 	{
 		glEnableVertexAttribArray(vertexTexcordAttribute);
-		glBindBuffer(GL_ARRAY_BUFFER, texcoordBuffer);
 		glVertexAttribPointer(
 			vertexTexcordAttribute, 	// The attribute we want to configure
 			2,                  		// size
 			GL_FLOAT,           		// type
 			GL_FALSE,          			// normalized?
-			0,                 			// stride
-			(void*)0           			// array buffer offset
+			stride,            			// stride
+			(void*)(6 * sizeof(GLfloat)) // array buffer offset
 		);
 	}
+}
 
-	//Draw Arrays
-	glDrawArrays(GL_TRIANGLES, 0, faces.size() * 3); 
-	
+//Disable vertex attributes
+void Mesh::disableAttributes(GLuint vertexPositionAttribute, GLuint vertexNormalAttribute, GLuint vertexTexcordAttribute)
+{
 	//Disable Vertex Position Array
-	if(positions.size() > 0)
+	if(attributes & MeshCache::hasPositions)
 	{
 		glDisableVertexAttribArray(vertexPositionAttribute);
 	}
 	
 	//Disable Vertex Normal Array
-	if(normals.size() > 0  && vertexNormalAttribute != -1)
+	if((attributes & MeshCache::hasNormals) && vertexNormalAttribute != -1)
 	{
 		glDisableVertexAttribArray(vertexNormalAttribute);
 	}
 
 	//Disable Vertex TexCoord Array
-	if(texcoords.size() > 0 && vertexTexcordAttribute != -1)
+	if((attributes & MeshCache::hasTexcoords) && vertexTexcordAttribute != -1)
 	{
 		glDisableVertexAttribArray(vertexTexcordAttribute);
 	}
@@ -216,27 +544,8 @@ void Mesh::Draw(GLuint vertexPositionAttribute, GLuint vertexNormalAttribute, GL
 //! Returns Mesh Centroid
 Vector3f Mesh::getMeshCentroid()
 {
-	//Variables for average positions
-	float x = 0.f;
-	float y = 0.f;
-	float z = 0.f;
-
-	//Accumulate values of all position
-	for(int i = 0 ; i < positions.size(); i++)
-	{
-		Vector3f v = positions[i];
-		x += v.x;
-		y += v.y;
-		z += v.z;
-	}
-
-	//Average each positon
-	x/= positions.size();
-	y/= positions.size();
-	z/= positions.size();
-	
-	// return result
-	return	Vector3f(x,y,z);
+	//Average of the positions, computed at load time so it is also known for cached meshes
+	return centroid;
 }
 
 //! Function to create a triangle geometry
@@ -252,10 +561,7 @@ void Mesh::initTriangle()
 	texcoords.push_back(Vector2f(0.0,0.0));
 	texcoords.push_back(Vector2f(0.0,1.0));
 	
-	Face face;
-	face.position_index.push_back(0);		face.position_index.push_back(1);		face.position_index.push_back(2);
-	face.normal_index.push_back(0);			face.normal_index.push_back(0);			face.normal_index.push_back(0);
-	face.texturecoord_index.push_back(0);	face.texturecoord_index.push_back(1);	face.texturecoord_index.push_back(2);
+	Face face = { { 0, 1, 2 }, { 0, 0, 0 }, { 0, 1, 2 } };
 	faces.push_back(face);
 
 	initBuffers();
@@ -277,16 +583,10 @@ void Mesh::initQuad()
 	texcoords.push_back(Vector2f(1.0,1.0));
 
 	//
-	Face face1;
-	face1.position_index.push_back(0);		face1.position_index.push_back(1);		face1.position_index.push_back(2);
-	face1.normal_index.push_back(0);		face1.normal_index.push_back(0);		face1.normal_index.push_back(0);
-	face1.texturecoord_index.push_back(0);	face1.texturecoord_index.push_back(1);	face1.texturecoord_index.push_back(2);
+	Face face1 = { { 0, 1, 2 }, { 0, 0, 0 }, { 0, 1, 2 } };
 	faces.push_back(face1);
 
-	Face face2;
-	face2.position_index.push_back(0);		face2.position_index.push_back(2);		face2.position_index.push_back(3);
-	face2.normal_index.push_back(0);		face2.normal_index.push_back(0);		face2.normal_index.push_back(0);
-	face2.texturecoord_index.push_back(0);	face2.texturecoord_index.push_back(2);	face2.texturecoord_index.push_back(3);
+	Face face2 = { { 0, 2, 3 }, { 0, 0, 0 }, { 0, 2, 3 } };
 	faces.push_back(face2);
 
 	initBuffers();
@@ -320,81 +620,45 @@ void Mesh::initCube()
 	texcoords.push_back(Vector2f( 1.0, 1.0));
 
 	//
-	Face face1a;
-	face1a.position_index.push_back(0);		face1a.position_index.push_back(1);		face1a.position_index.push_back(2);
-	face1a.normal_index.push_back(0);		face1a.normal_index.push_back(0);		face1a.normal_index.push_back(0);
-	face1a.texturecoord_index.push_back(0);	face1a.texturecoord_index.push_back(1);	face1a.texturecoord_index.push_back(2);
+	Face face1a = { { 0, 1, 2 }, { 0, 0, 0 }, { 0, 1, 2 } };
 	faces.push_back(face1a);
 
-	Face face1b;
-	face1b.position_index.push_back(0);		face1b.position_index.push_back(2);		face1b.position_index.push_back(3);
-	face1b.normal_index.push_back(0);		face1b.normal_index.push_back(0);		face1b.normal_index.push_back(0);
-	face1b.texturecoord_index.push_back(0);	face1b.texturecoord_index.push_back(2);	face1b.texturecoord_index.push_back(3);
+	Face face1b = { { 0, 2, 3 }, { 0, 0, 0 }, { 0, 2, 3 } };
 	faces.push_back(face1b);
 	
 	//
-	Face face2a;
-	face2a.position_index.push_back(3);		face2a.position_index.push_back(2);		face2a.position_index.push_back(7);
-	face2a.normal_index.push_back(1);		face2a.normal_index.push_back(1);		face2a.normal_index.push_back(1);
-	face2a.texturecoord_index.push_back(0);	face2a.texturecoord_index.push_back(1);	face2a.texturecoord_index.push_back(2);
+	Face face2a = { { 3, 2, 7 }, { 1, 1, 1 }, { 0, 1, 2 } };
 	faces.push_back(face2a);
 
-	Face face2b;
-	face2b.position_index.push_back(3);		face2b.position_index.push_back(7);		face2b.position_index.push_back(5);
-	face2b.normal_index.push_back(1);		face2b.normal_index.push_back(1);		face2b.normal_index.push_back(1);
-	face2b.texturecoord_index.push_back(0);	face2b.texturecoord_index.push_back(2);	face2b.texturecoord_index.push_back(3);
+	Face face2b = { { 3, 7, 5 }, { 1, 1, 1 }, { 0, 2, 3 } };
 	faces.push_back(face2b);
 	
 	//
-	Face face3a;
-	face3a.position_index.push_back(5);		face3a.position_index.push_back(7);		face3a.position_index.push_back(6);
-	face3a.normal_index.push_back(2);		face3a.normal_index.push_back(2);		face3a.normal_index.push_back(2);
-	face3a.texturecoord_index.push_back(0);	face3a.texturecoord_index.push_back(1);	face3a.texturecoord_index.push_back(2);
+	Face face3a = { { 5, 7, 6 }, { 2, 2, 2 }, { 0, 1, 2 } };
 	faces.push_back(face3a);
 
-	Face face3b;
-	face3b.position_index.push_back(5);		face3b.position_index.push_back(6);		face3b.position_index.push_back(4);
-	face3b.normal_index.push_back(2);		face3b.normal_index.push_back(2);		face3b.normal_index.push_back(2);
-	face3b.texturecoord_index.push_back(0);	face3b.texturecoord_index.push_back(2);	face3b.texturecoord_index.push_back(3);
+	Face face3b = { { 5, 6, 4 }, { 2, 2, 2 }, { 0, 2, 3 } };
 	faces.push_back(face3b);
 	
 	//
-	Face face4a;
-	face4a.position_index.push_back(4);		face4a.position_index.push_back(6);		face4a.position_index.push_back(1);
-	face4a.normal_index.push_back(3);		face4a.normal_index.push_back(3);		face4a.normal_index.push_back(3);
-	face4a.texturecoord_index.push_back(0);	face4a.texturecoord_index.push_back(1);	face4a.texturecoord_index.push_back(2);
+	Face face4a = { { 4, 6, 1 }, { 3, 3, 3 }, { 0, 1, 2 } };
 	faces.push_back(face4a);
 
-	Face face4b;
-	face4b.position_index.push_back(4);		face4b.position_index.push_back(1);		face4b.position_index.push_back(0);
-	face4b.normal_index.push_back(3);		face4b.normal_index.push_back(3);		face4b.normal_index.push_back(3);
-	face4b.texturecoord_index.push_back(0);	face4b.texturecoord_index.push_back(2);	face4b.texturecoord_index.push_back(3);
+	Face face4b = { { 4, 1, 0 }, { 3, 3, 3 }, { 0, 2, 3 } };
 	faces.push_back(face4b);
 	
 	//
-	Face face5a;
-	face5a.position_index.push_back(5);		face5a.position_index.push_back(4);		face5a.position_index.push_back(0);
-	face5a.normal_index.push_back(4);		face5a.normal_index.push_back(4);		face5a.normal_index.push_back(4);
-	face5a.texturecoord_index.push_back(0);	face5a.texturecoord_index.push_back(1);	face5a.texturecoord_index.push_back(2);
+	Face face5a = { { 5, 4, 0 }, { 4, 4, 4 }, { 0, 1, 2 } };
 	faces.push_back(face5a);
 
-	Face face5b;
-	face5b.position_index.push_back(5);		face5b.position_index.push_back(0);		face5b.position_index.push_back(3);
-	face5b.normal_index.push_back(4);		face5b.normal_index.push_back(4);		face5b.normal_index.push_back(4);
-	face5b.texturecoord_index.push_back(0);	face5b.texturecoord_index.push_back(2);	face5b.texturecoord_index.push_back(3);
+	Face face5b = { { 5, 0, 3 }, { 4, 4, 4 }, { 0, 2, 3 } };
 	faces.push_back(face5b);
 	
 	//
-	Face face6a;
-	face6a.position_index.push_back(2);		face6a.position_index.push_back(1);		face6a.position_index.push_back(6);
-	face6a.normal_index.push_back(5);		face6a.normal_index.push_back(5);		face6a.normal_index.push_back(5);
-	face6a.texturecoord_index.push_back(0);	face6a.texturecoord_index.push_back(1);	face6a.texturecoord_index.push_back(2);
+	Face face6a = { { 2, 1, 6 }, { 5, 5, 5 }, { 0, 1, 2 } };
 	faces.push_back(face6a);
 
-	Face face6b;
-	face6b.position_index.push_back(2);		face6b.position_index.push_back(6);		face6b.position_index.push_back(7);
-	face6b.normal_index.push_back(5);		face6b.normal_index.push_back(5);		face6b.normal_index.push_back(5);
-	face6b.texturecoord_index.push_back(0);	face6b.texturecoord_index.push_back(2);	face6b.texturecoord_index.push_back(3);
+	Face face6b = { { 2, 6, 7 }, { 5, 5, 5 }, { 0, 2, 3 } };
 	faces.push_back(face6b);
 
     //Init buffers
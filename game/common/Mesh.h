@@ -3,6 +3,7 @@
 
 #include <GL/glew.h>
 #include <GL/gl.h>
+#include <MeshCache.h>
 #include <Vector.h>
 #include <iostream>
 #include <string>
@@ -18,13 +19,27 @@ class Mesh
 public:
 
     //! Constructor
-    Mesh() : positionBuffer(0), normalBuffer(0), texcoordBuffer(0){};
+    Mesh() : id(++meshCount), vertexBuffer(0), indexBuffer(0), vertexArray(0), vertexCount(0), indexCount(0), levelCount(1), indexType(GL_UNSIGNED_SHORT), attributes(0),
+        fileOrderACMR(0), optimizedACMR(0), boundingRadius(0)
+    {
+        arrayAttributes[0] = arrayAttributes[1] = arrayAttributes[2] = -1;
+        levelFirst[0] = levelIndexCount[0] = 0;
+        levelError[0] = 0;
+    };
 
     //! Destructor
     ~Mesh(){};
 
-	//! Load and OBJ mesh from File
-    bool loadOBJ(std::string filename);
+	//! Load and OBJ mesh from File, optionally with simplified levels of detail,
+	//! through a binary .mesh cache next to it that is rebuilt whenever the OBJ file's size or time changes
+    bool loadOBJ(std::string filename, bool levelsOfDetail = false);
+
+	//! First half of loadOBJ, reads the OBJ file or its cache and builds the buffer data without OpenGL,
+	//! so it can run on a loader thread
+	bool prepareOBJ(std::string filename, bool levelsOfDetail = false);
+
+	//! Second half of loadOBJ, creates the OpenGL buffers from the prepared data on the context thread
+	void upload();
 
 	//! Creates geometry for a cube 
 	void initCube();
@@ -38,21 +53,96 @@ public:
 	//!Draw Function for Mesh
     void Draw(GLuint vertexPositionAttribute, GLuint vertexNormalAttribute = -1, GLuint vertexTexcordAttribute = -1 );
 
+	//! Bind vertex state once for several DrawBound calls
+	void Bind(GLuint vertexPositionAttribute, GLuint vertexNormalAttribute = -1, GLuint vertexTexcordAttribute = -1);
+
+	//! Draw with the state set by Bind, at a level of detail
+	void DrawBound(int level = 0);
+
+	//! Undo Bind
+	void Unbind(GLuint vertexPositionAttribute, GLuint vertexNormalAttribute = -1, GLuint vertexTexcordAttribute = -1);
+
+	//! Draw instanceCount copies with one call, each taking one vec4 of instanceBuffer as vertexInstanceAttribute
+	void DrawInstanced(GLsizei instanceCount, GLuint instanceBuffer, GLuint vertexInstanceAttribute, GLuint vertexPositionAttribute, GLuint vertexNormalAttribute = -1, GLuint vertexTexcordAttribute = -1);
+
   	//! Returns Mesh Centroid
 	Vector3f getMeshCentroid();
+
+	//! Axis-aligned bounds of the positions, computed at load time
+	Vector3f getBoundsMin() const { return boundsMin; }
+	Vector3f getBoundsMax() const { return boundsMax; }
+
+	//! Bounding sphere around the bounds centre, computed at load time
+	Vector3f getBoundingCenter() const { return boundingCenter; }
+	float getBoundingRadius() const { return boundingRadius; }
+
+	//! Unique number of this mesh, for sorting draws
+	unsigned int getId() const { return id; }
+
+	//! Levels of detail, the full mesh and those simplified to levelTriangleRatio of its triangles
+	enum { maxLevels = 4 };
+	static const float levelTriangleRatio[maxLevels];
+
+	//! Projected diameter in pixels below which each level is drawn, and the fraction a size must pass it by to switch
+	static const float levelScreenSize[maxLevels];
+	static const float levelHysteresis;
+
+	//! Number of levels built
+	int getLevelCount() const { return levelCount; }
+
+	//! Triangles of level and its largest simplification error as a distance
+	int getLevelTriangles(int level) const { return levelIndexCount[level] / 3; }
+	float getLevelError(int level) const { return levelError[level]; }
+
+	//! Level to draw at a projected diameter of screenSize pixels, moving from the level drawn before only past the hysteresis
+	int selectLevel(float screenSize, int level) const;
+
+	//! Vertex cache misses per triangle in file order and after reordering
+	float getFileOrderACMR() const { return fileOrderACMR; }
+	float getOptimizedACMR() const { return optimizedACMR; }
 	
 //!
 private:
 
 	//! Init
-	void initBuffers();
+	void initBuffers(bool levelsOfDetail = false);
+
+	//! Build the interleaved vertices and indices from the faces, kept until upload
+	void buildBuffers(bool levelsOfDetail);
+
+	//! Map a binary cache and take everything but the buffers from it, returns false when it is missing or was built differently
+	bool openCache(std::string cacheName, bool levelsOfDetail);
+
+	//! Save the built buffers and everything computed with them to a binary cache, stamped with the source they came from
+	void writeCache(std::string cacheName, const MeshCache::Source & source, bool levelsOfDetail);
 
-	//Face structure
+	//! Built index data in the index type, NULL when there is none
+	const void * getBuiltIndices() const;
+
+	//! Create the OpenGL buffers and set their data
+	void uploadBuffers(const void * vertices, size_t vertexBytes, const void * indices, size_t indexBytes);
+
+	//! Compute bounding box and sphere and the centroid of positions
+	void computeBounds();
+
+	//! Bind attribute state, captured once in a vertex array object when available
+	void bindVertexArray(GLuint vertexPositionAttribute, GLuint vertexNormalAttribute, GLuint vertexTexcordAttribute);
+
+	//! Undo attribute state after drawing when there is no vertex array object
+	void unbindVertexArray(GLuint vertexPositionAttribute, GLuint vertexNormalAttribute, GLuint vertexTexcordAttribute);
+
+	//! Enable and point vertex attributes into the interleaved buffer
+	void enableAttributes(GLuint vertexPositionAttribute, GLuint vertexNormalAttribute, GLuint vertexTexcordAttribute);
+
+	//! Disable vertex attributes
+	void disableAttributes(GLuint vertexPositionAttribute, GLuint vertexNormalAttribute, GLuint vertexTexcordAttribute);
+
+	//Face structure, a triangle
 	struct Face
 	{
-		std::vector<unsigned int> position_index;
-		std::vector<unsigned int> normal_index;
-		std::vector<unsigned int> texturecoord_index;
+		unsigned int position_index[3];
+		unsigned int normal_index[3];
+		unsigned int texturecoord_index[3];
 	};
 
 	//! Mesh Positions
@@ -67,16 +157,56 @@ private:
 	//! Mesh Faces
 	std::vector<Face> faces;
 
+	//! Buffer data from buildBuffers, or the cache it is mapped from, until upload
+	std::vector<GLfloat> vertexData;
+	std::vector<GLuint> indexData;
+	std::vector<GLushort> shortIndexData;
+	MeshCache cache;
+
 private:
 
-    //! OpenGL Vertex Positon Buffer
-    GLuint positionBuffer;
- 
-    //! OpenGL Vertex Normal Buffer
-    GLuint normalBuffer;
-     
-    //! OpenGL Vertex Tex Coord Buffer
-    GLuint texcoordBuffer;
+    //! Floats per interleaved vertex, position, normal and tex coord
+    enum { vertexFloats = 8 };
+
+    //! Meshes constructed so far, and the number of this one
+    static unsigned int meshCount;
+    unsigned int id;
+
+    //! OpenGL interleaved vertex buffer, one entry per unique vertex
+    GLuint vertexBuffer;
+
+    //! OpenGL index buffer, triangles in vertex cache order
+    GLuint indexBuffer;
+
+    //! OpenGL vertex array object and the attribute locations it was set up for
+    GLuint vertexArray;
+    GLuint arrayAttributes[3];
+
+    //! Unique vertices and indices drawn
+    GLsizei vertexCount;
+    GLsizei indexCount;
+
+    //! Levels of detail, ranges of the index buffer sharing the vertex buffer
+    int levelCount;
+    GLsizei levelFirst[maxLevels];
+    GLsizei levelIndexCount[maxLevels];
+    float levelError[maxLevels];
+
+    //! GL_UNSIGNED_SHORT when every vertex fits, GL_UNSIGNED_INT otherwise
+    GLenum indexType;
+
+    //! MeshCache attribute flags of the vertices, also set when the source arrays were never loaded
+    unsigned int attributes;
+
+    //! Vertex cache misses per triangle
+    float fileOrderACMR;
+    float optimizedACMR;
+
+    //! Bounding box and sphere, and the average position
+    Vector3f boundsMin, boundsMax;
+    Vector3f boundingCenter;
+    float boundingRadius;
+    Vector3f centroid;
 
 };
 
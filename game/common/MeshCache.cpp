@@ -0,0 +1,162 @@
+#include "MeshCache.h"
+
+#include <fstream>
+#include <iostream>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+// File signature
+static const char cacheMagic[4] = { 'M', 'E', 'S', 'H' };
+
+//! Constructor
+MeshCache::MeshCache()
+{
+	memset(&header, 0, sizeof(header));
+}
+
+// Cache file for a source file
+std::string MeshCache::getCacheName(std::string source)
+{
+	size_t dot = source.find_last_of('.');
+	size_t slash = source.find_last_of("/\\");
+	if(dot == std::string::npos || (slash != std::string::npos && dot < slash)) return source + ".mesh";
+	return source.substr(0, dot) + ".mesh";
+}
+
+// Size and modification time of a file
+bool MeshCache::getSource(std::string filename, Source & source)
+{
+	memset(&source, 0, sizeof(source));
+	struct stat info;
+	if(stat(filename.c_str(), &info) != 0) return false;
+
+#ifdef __APPLE__
+	long nanoseconds = info.st_mtimespec.tv_nsec;
+#else
+	long nanoseconds = info.st_mtim.tv_nsec;
+#endif
+	unsigned long long size = info.st_size, seconds = info.st_mtime;
+	source.size[0] = (unsigned int)size;
+	source.size[1] = (unsigned int)(size >> 32);
+	source.seconds[0] = (unsigned int)seconds;
+	source.seconds[1] = (unsigned int)(seconds >> 32);
+	source.nanoseconds = (unsigned int)nanoseconds;
+	return true;
+}
+
+// Whether cache is missing or built from another source
+bool MeshCache::isStale(std::string source, std::string cache)
+{
+	// Only the header is read, open checks the rest
+	Header header;
+	std::ifstream in(cache.c_str(), std::ios::binary);
+	if(!in.read((char *)&header, sizeof(header))) return true;
+	if(memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0 || header.version != version) return true;
+
+	// A cache without its source is all there is
+	Source current;
+	if(!getSource(source, current)) return false;
+
+	// Equal rather than older, a source copied or restored with an earlier time is still another source
+	return memcmp(&header.source, &current, sizeof(Source)) != 0;
+}
+
+// Write cache file
+bool MeshCache::write(std::string filename, const Header & header, const void * vertices, const void * indices)
+{
+	Header written = header;
+	memcpy(written.magic, cacheMagic, sizeof(cacheMagic));
+	written.version = version;
+
+	std::ofstream out(filename.c_str(), std::ios::binary | std::ios::trunc);
+	if(!out)
+	{
+		std::cout << "Error writing " << filename << std::endl;
+		return false;
+	}
+
+	out.write((const char *)&written, sizeof(written));
+	if(header.vertexCount > 0) out.write((const char *)vertices, (size_t)header.vertexCount * header.vertexFloats * sizeof(float));
+	if(header.indexCount > 0) out.write((const char *)indices, (size_t)header.indexCount * header.indexSize);
+	out.close();
+
+	// A partial file would only be rejected on the next load
+	if(!out)
+	{
+		std::cout << "Error writing " << filename << std::endl;
+		remove(filename.c_str());
+		return false;
+	}
+	return true;
+}
+
+// Map cache file
+bool MeshCache::open(std::string filename)
+{
+	if(!file.open(filename, true) || file.getSize() < sizeof(Header)) return false;
+	memcpy(&header, file.getData(), sizeof(Header));
+
+	// Another version or byte order
+	if(memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0 || header.version != version)
+	{
+		file.close();
+		return false;
+	}
+
+	// Sizes that add up to the file and level ranges inside the indices
+	bool valid = (header.indexSize == 2 || header.indexSize == 4) && header.levelCount >= 1 && header.levelCount <= maxLevels &&
+		sizeof(Header) + getVertexBytes() + getIndexBytes() == file.getSize();
+	for(unsigned int level = 0; valid && level < header.levelCount; level++)
+		valid = header.levelFirst[level] <= header.indexCount && header.levelIndexCount[level] <= header.indexCount - header.levelFirst[level];
+	if(!valid)
+	{
+		std::cout << "Error in " << filename << ": malformed mesh cache" << std::endl;
+		file.close();
+		return false;
+	}
+	return true;
+}
+
+// Unmap cache file
+void MeshCache::close()
+{
+	file.close();
+}
+
+// Whether a cache file is mapped
+bool MeshCache::isOpen() const
+{
+	return file.getData() != NULL;
+}
+
+// Header of open cache
+const MeshCache::Header & MeshCache::getHeader() const
+{
+	return header;
+}
+
+// Vertex data in mapping
+const void * MeshCache::getVertices() const
+{
+	return file.getData() + sizeof(Header);
+}
+
+// Index data in mapping
+const void * MeshCache::getIndices() const
+{
+	return file.getData() + sizeof(Header) + getVertexBytes();
+}
+
+// Bytes of vertex data
+size_t MeshCache::getVertexBytes() const
+{
+	return (size_t)header.vertexCount * header.vertexFloats * sizeof(float);
+}
+
+// Bytes of index data
+size_t MeshCache::getIndexBytes() const
+{
+	return (size_t)header.indexCount * header.indexSize;
+}
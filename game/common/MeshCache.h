@@ -0,0 +1,100 @@
+#ifndef MESHCACHE_H_
+#define MESHCACHE_H_
+
+#include <MappedFile.h>
+#include <stddef.h>
+#include <string>
+
+/**
+ * Binary cache of a mesh's final buffers, written next to its source file and memory-mapped back so the
+ * vertex and index data can be handed to the GPU straight from the mapping.
+ * A file is a Header followed by the interleaved vertices and then the indices, in native byte order,
+ * and is rejected when its version, byte order or size do not match. The header records the size and modification
+ * time of the source it was built from, and the cache is stale as soon as either differs.
+ */
+class MeshCache
+{
+
+public:
+
+	//! Format version, bumped whenever the layout or the way meshes are built changes
+	enum { version = 2 };
+
+	//! Levels of detail a cache can hold
+	enum { maxLevels = 4 };
+
+	//! Attributes present in the vertices
+	enum { hasPositions = 1, hasNormals = 2, hasTexcoords = 4 };
+
+	//! Size and modification time of a source file, 64-bit values as low and high halves so there is no padding
+	struct Source
+	{
+		unsigned int size[2];
+		unsigned int seconds[2];
+		unsigned int nanoseconds;
+	};
+
+	//! Everything a mesh needs besides its buffers, 4-byte fields only so there is no padding
+	struct Header
+	{
+		char magic[4];
+		unsigned int version;
+		Source source;
+		unsigned int levelsOfDetail;
+		unsigned int attributes;
+		unsigned int vertexCount, vertexFloats;
+		unsigned int indexCount, indexSize;
+		unsigned int levelCount;
+		unsigned int levelFirst[maxLevels];
+		unsigned int levelIndexCount[maxLevels];
+		float levelError[maxLevels];
+		float boundsMin[3], boundsMax[3];
+		float boundingCenter[3], boundingRadius;
+		float centroid[3];
+		float fileOrderACMR, optimizedACMR;
+	};
+
+	//! Constructor
+	MeshCache();
+
+	//! Cache file for a source file, its name with the extension replaced by .mesh
+	static std::string getCacheName(std::string source);
+
+	//! Size and modification time of a file, to the nanosecond where the system keeps it, zero when it cannot be read
+	static bool getSource(std::string filename, Source & source);
+
+	//! Whether the cache is missing or was built from a source of another size or modification time
+	static bool isStale(std::string source, std::string cache);
+
+	//! Write header, vertexCount * vertexFloats floats and indexCount indices of indexSize bytes, returns false on failure
+	static bool write(std::string filename, const Header & header, const void * vertices, const void * indices);
+
+	//! Map a cache file, returns false when it is missing, of another version or malformed
+	bool open(std::string filename);
+
+	//! Unmap the cache file
+	void close();
+
+	//! Whether a cache file is mapped
+	bool isOpen() const;
+
+	//! Header of the open cache
+	const Header & getHeader() const;
+
+	//! Vertex and index data inside the mapping, valid while the cache is open
+	const void * getVertices() const;
+	const void * getIndices() const;
+	size_t getVertexBytes() const;
+	size_t getIndexBytes() const;
+
+private:
+
+	//! Mapped file
+	MappedFile file;
+
+	//! Copy of the header
+	Header header;
+
+};
+
+#endif
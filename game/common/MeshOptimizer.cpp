@@ -0,0 +1,446 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <math.h>
+
+// Forsyth's scoring constants
+static const float cacheDecayPower = 1.5f;
+static const float lastTriangleScore = 0.75f;
+static const float valenceBoostScale = 2.0f;
+static const float valenceBoostPower = 0.5f;
+
+// Score of a vertex from its cache position, -1 when not cached, and its triangles not drawn yet
+static float vertexScore(int cachePosition, unsigned int remaining)
+{
+	// Vertices with nothing left to draw are of no use
+	if(remaining == 0) return -1;
+
+	float score = 0;
+	if(cachePosition >= 0)
+	{
+		// Vertices of the last triangle get a fixed score so it is not simply repeated
+		if(cachePosition < 3)
+			score = lastTriangleScore;
+		else
+			score = powf(1 - (float)(cachePosition - 3) / (MeshOptimizer::cacheSize - 3), cacheDecayPower);
+	}
+
+	// Boost vertices with few triangles left so they are finished off
+	return score + valenceBoostScale * powf((float)remaining, -valenceBoostPower);
+}
+
+// Compare triplets of corners, ties keep corner order
+struct TripletLess
+{
+	const unsigned int * triplets;
+	bool operator()(unsigned int a, unsigned int b) const
+	{
+		const unsigned int * x = triplets + 3 * a, * y = triplets + 3 * b;
+		if(x[0] != y[0]) return x[0] < y[0];
+		if(x[1] != y[1]) return x[1] < y[1];
+		if(x[2] != y[2]) return x[2] < y[2];
+		return a < b;
+	}
+};
+
+// Merge equal triplets into one vertex
+std::vector<unsigned int> MeshOptimizer::deduplicate(const std::vector<unsigned int> & triplets, std::vector<unsigned int> & indices)
+{
+	unsigned int corners = triplets.size() / 3;
+	std::vector<unsigned int> unique;
+	indices.resize(corners);
+	if(corners == 0) return unique;
+
+	// Sort corners so equal triplets are adjacent
+	std::vector<unsigned int> order(corners);
+	for(unsigned int c = 0; c < corners; c++) order[c] = c;
+	TripletLess less = { &triplets[0] };
+	std::sort(order.begin(), order.end(), less);
+
+	// Runs of equal triplets
+	std::vector<unsigned int> run(corners);
+	unsigned int runs = 0;
+	for(unsigned int k = 0; k < corners; k++)
+	{
+		if(k > 0 && !std::equal(&triplets[3 * order[k]], &triplets[3 * order[k]] + 3, &triplets[3 * order[k - 1]])) runs++;
+		run[order[k]] = runs;
+	}
+
+	// Number vertices in order of first use
+	std::vector<unsigned int> vertexOfRun(runs + 1, (unsigned int)-1);
+	for(unsigned int c = 0; c < corners; c++)
+	{
+		unsigned int & vertex = vertexOfRun[run[c]];
+		if(vertex == (unsigned int)-1)
+		{
+			vertex = unique.size() / 3;
+			unique.insert(unique.end(), &triplets[3 * c], &triplets[3 * c] + 3);
+		}
+		indices[c] = vertex;
+	}
+
+	return unique;
+}
+
+// Reorder triangles for vertex cache reuse
+void MeshOptimizer::optimizeVertexCache(std::vector<unsigned int> & indices, unsigned int vertexCount)
+{
+	unsigned int triangleCount = indices.size() / 3;
+	if(triangleCount == 0) return;
+
+	// Triangles of each vertex, the first remaining[v] of them are not drawn yet
+	std::vector<unsigned int> remaining(vertexCount, 0), offsets(vertexCount + 1, 0), triangles(indices.size());
+	for(size_t k = 0; k < indices.size(); k++) remaining[indices[k]]++;
+	for(unsigned int v = 0; v < vertexCount; v++) offsets[v + 1] = offsets[v] + remaining[v];
+	std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+	for(size_t k = 0; k < indices.size(); k++) triangles[fill[indices[k]]++] = k / 3;
+
+	// Initial scores
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> score(vertexCount), triangleScore(triangleCount, 0);
+	std::vector<char> drawn(triangleCount, 0);
+	for(unsigned int v = 0; v < vertexCount; v++) score[v] = vertexScore(-1, remaining[v]);
+	for(size_t k = 0; k < indices.size(); k++) triangleScore[k / 3] += score[indices[k]];
+
+	int best = std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin();
+	unsigned int cursor = 0;
+	std::vector<unsigned int> cache, next, output;
+	cache.reserve(cacheSize + 3);
+	next.reserve(cacheSize + 3);
+	output.reserve(indices.size());
+
+	for(unsigned int n = 0; n < triangleCount; n++)
+	{
+		// Nothing useful in the cache, take the next triangle not drawn yet
+		if(best < 0)
+		{
+			while(drawn[cursor]) cursor++;
+			best = cursor;
+		}
+
+		// Draw triangle
+		const unsigned int * corners = &indices[3 * best];
+		drawn[best] = 1;
+		output.insert(output.end(), corners, corners + 3);
+		for(int c = 0; c < 3; c++)
+		{
+			unsigned int v = corners[c];
+			unsigned int * list = &triangles[offsets[v]];
+			unsigned int * end = list + remaining[v];
+			std::swap(*std::find(list, end, (unsigned int)best), end[-1]);
+			remaining[v]--;
+		}
+
+		// Triangle vertices move to the front of the cache
+		next.clear();
+		for(int c = 0; c < 3; c++)
+			if(std::find(next.begin(), next.end(), corners[c]) == next.end()) next.push_back(corners[c]);
+		for(size_t k = 0; k < cache.size(); k++)
+			if(std::find(next.begin(), next.end(), cache[k]) == next.end()) next.push_back(cache[k]);
+
+		// Rescore vertices that moved or fell out, passing the change on to their triangles
+		for(size_t k = 0; k < next.size(); k++)
+		{
+			unsigned int v = next[k];
+			cachePosition[v] = k < (size_t)cacheSize ? (int)k : -1;
+			float updated = vertexScore(cachePosition[v], remaining[v]);
+			float delta = updated - score[v];
+			score[v] = updated;
+			for(unsigned int t = 0; t < remaining[v]; t++) triangleScore[triangles[offsets[v] + t]] += delta;
+		}
+		if(next.size() > (size_t)cacheSize) next.resize(cacheSize);
+		cache.swap(next);
+
+		// Best triangle using a cached vertex
+		best = -1;
+		float bestScore = -1;
+		for(size_t k = 0; k < cache.size(); k++)
+		{
+			unsigned int v = cache[k];
+			for(unsigned int t = 0; t < remaining[v]; t++)
+			{
+				unsigned int triangle = triangles[offsets[v] + t];
+				if(triangleScore[triangle] > bestScore)
+				{
+					bestScore = triangleScore[triangle];
+					best = triangle;
+				}
+			}
+		}
+	}
+
+	indices.swap(output);
+}
+
+// Average cache miss ratio through a FIFO cache
+float MeshOptimizer::computeACMR(const std::vector<unsigned int> & indices, unsigned int vertexCount)
+{
+	unsigned int triangleCount = indices.size() / 3;
+	if(triangleCount == 0) return 0;
+
+	// A vertex is cached while fewer than cacheSize misses happened since it was loaded
+	std::vector<int> loadedAt(vertexCount, -1);
+	int misses = 0;
+	for(size_t k = 0; k < indices.size(); k++)
+	{
+		int & stamp = loadedAt[indices[k]];
+		if(stamp < 0 || misses - stamp >= cacheSize)
+		{
+			stamp = misses;
+			misses++;
+		}
+	}
+
+	return (float)misses / triangleCount;
+}
+
+// Sum of squared distances to planes, the upper triangle of a symmetric 4x4 matrix
+struct Quadric
+{
+	double a00, a01, a02, a03, a11, a12, a13, a22, a23, a33;
+};
+
+// Add plane n.p + d = 0 with weight
+static void addPlane(Quadric & q, double nx, double ny, double nz, double d, double weight)
+{
+	q.a00 += weight * nx * nx; q.a01 += weight * nx * ny; q.a02 += weight * nx * nz; q.a03 += weight * nx * d;
+	q.a11 += weight * ny * ny; q.a12 += weight * ny * nz; q.a13 += weight * ny * d;
+	q.a22 += weight * nz * nz; q.a23 += weight * nz * d;
+	q.a33 += weight * d * d;
+}
+
+// Add quadric
+static void addQuadric(Quadric & q, const Quadric & other)
+{
+	q.a00 += other.a00; q.a01 += other.a01; q.a02 += other.a02; q.a03 += other.a03;
+	q.a11 += other.a11; q.a12 += other.a12; q.a13 += other.a13;
+	q.a22 += other.a22; q.a23 += other.a23;
+	q.a33 += other.a33;
+}
+
+// Error of quadric at point
+static double evaluate(const Quadric & q, const float * p)
+{
+	double x = p[0], y = p[1], z = p[2];
+	double error = q.a00 * x * x + 2 * q.a01 * x * y + 2 * q.a02 * x * z + 2 * q.a03 * x
+	             + q.a11 * y * y + 2 * q.a12 * y * z + 2 * q.a13 * y
+	             + q.a22 * z * z + 2 * q.a23 * z
+	             + q.a33;
+	return error > 0 ? error : 0;
+}
+
+// Unnormalized normal of triangle
+static void triangleNormal(const float * p0, const float * p1, const float * p2, double * normal)
+{
+	double u[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+	double v[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+	normal[0] = u[1] * v[2] - u[2] * v[1];
+	normal[1] = u[2] * v[0] - u[0] * v[2];
+	normal[2] = u[0] * v[1] - u[1] * v[0];
+}
+
+// Edge collapse candidate, vertex from merged into vertex to
+struct Collapse
+{
+	double cost;
+	unsigned int from, to;
+	bool operator<(const Collapse & other) const { return cost < other.cost || (cost == other.cost && (from < other.from || (from == other.from && to < other.to))); }
+};
+
+// Compare vertex positions, ties by index
+struct PositionLess
+{
+	const float * positions;
+	unsigned int stride;
+	bool operator()(unsigned int a, unsigned int b) const
+	{
+		const float * x = positions + a * stride, * y = positions + b * stride;
+		if(x[0] != y[0]) return x[0] < y[0];
+		if(x[1] != y[1]) return x[1] < y[1];
+		if(x[2] != y[2]) return x[2] < y[2];
+		return a < b;
+	}
+};
+
+// Simplify by edge collapses
+float MeshOptimizer::simplify(std::vector<unsigned int> & indices, const float * vertices, unsigned int stride, unsigned int vertexCount, unsigned int targetIndexCount)
+{
+	if(indices.size() <= targetIndexCount || vertexCount == 0) return 0;
+
+	// Vertices at the same position, split by normals or tex coords, collapse together as one welded vertex
+	std::vector<unsigned int> order(vertexCount), welded(vertexCount), groupStart(vertexCount);
+	for(unsigned int v = 0; v < vertexCount; v++) order[v] = v;
+	PositionLess less = { vertices, stride };
+	std::sort(order.begin(), order.end(), less);
+	for(unsigned int k = 0; k < vertexCount; k++)
+	{
+		const float * p = vertices + order[k] * stride, * q = vertices + order[k > 0 ? k - 1 : 0] * stride;
+		bool same = k > 0 && p[0] == q[0] && p[1] == q[1] && p[2] == q[2];
+		welded[order[k]] = same ? welded[order[k - 1]] : order[k];
+		groupStart[welded[order[k]]] = same ? groupStart[welded[order[k - 1]]] : k;
+	}
+
+	// Triangles on welded vertices, with the vertices they started with
+	std::vector<unsigned int> original(indices);
+	for(size_t k = 0; k < indices.size(); k++) indices[k] = welded[indices[k]];
+
+	// Open borders and edges shared by more than two triangles stay put, collapsing them would shift the outline
+	std::vector<char> locked(vertexCount, 0);
+	std::vector<unsigned long long> edges;
+	edges.reserve(indices.size());
+	for(size_t t = 0; t < indices.size(); t += 3)
+		for(int c = 0; c < 3; c++)
+		{
+			unsigned long long a = indices[t + c], b = indices[t + (c + 1) % 3];
+			edges.push_back(a < b ? (a << 32) | b : (b << 32) | a);
+		}
+	std::sort(edges.begin(), edges.end());
+	for(size_t k = 0; k < edges.size(); )
+	{
+		size_t end = k + 1;
+		while(end < edges.size() && edges[end] == edges[k]) end++;
+		if(end - k != 2)
+		{
+			locked[edges[k] >> 32] = 1;
+			locked[edges[k] & 0xffffffffu] = 1;
+		}
+		k = end;
+	}
+
+	// Planes of the triangles around each vertex
+	Quadric zero = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+	std::vector<Quadric> quadrics(vertexCount, zero);
+	for(size_t t = 0; t < indices.size(); t += 3)
+	{
+		const float * p0 = vertices + indices[t] * stride;
+		double n[3];
+		triangleNormal(p0, vertices + indices[t + 1] * stride, vertices + indices[t + 2] * stride, n);
+		double length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		if(length == 0) continue;
+		n[0] /= length; n[1] /= length; n[2] /= length;
+		double d = -(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2]);
+		for(int c = 0; c < 3; c++) addPlane(quadrics[indices[t + c]], n[0], n[1], n[2], d, 1);
+	}
+
+	double maxCost = 0;
+	std::vector<unsigned int> offsets(vertexCount + 1), triangles, remap(vertexCount);
+	std::vector<char> touched(vertexCount);
+	std::vector<Collapse> collapses;
+
+	// Passes of independent collapses, cheapest first, until the target is reached or nothing can go
+	while(indices.size() > targetIndexCount)
+	{
+		// Triangles of each vertex
+		std::fill(offsets.begin(), offsets.end(), 0);
+		for(size_t k = 0; k < indices.size(); k++) offsets[indices[k] + 1]++;
+		for(unsigned int v = 0; v < vertexCount; v++) offsets[v + 1] += offsets[v];
+		triangles.resize(indices.size());
+		std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+		for(size_t k = 0; k < indices.size(); k++) triangles[fill[indices[k]]++] = k / 3;
+
+		// Every edge in both directions, costed at the surviving vertex
+		collapses.clear();
+		for(size_t t = 0; t < indices.size(); t += 3)
+			for(int c = 0; c < 3; c++)
+			{
+				unsigned int a = indices[t + c], b = indices[t + (c + 1) % 3];
+				for(int direction = 0; direction < 2; direction++, std::swap(a, b))
+				{
+					if(locked[a]) continue;
+					Quadric q = quadrics[a];
+					addQuadric(q, quadrics[b]);
+					Collapse collapse = { evaluate(q, vertices + b * stride), a, b };
+					collapses.push_back(collapse);
+				}
+			}
+		std::sort(collapses.begin(), collapses.end());
+
+		for(unsigned int v = 0; v < vertexCount; v++) remap[v] = v;
+		std::fill(touched.begin(), touched.end(), 0);
+		size_t removed = 0, needed = (indices.size() - targetIndexCount) / 3;
+		int accepted = 0;
+
+		for(size_t k = 0; k < collapses.size() && removed < needed; k++)
+		{
+			const Collapse & collapse = collapses[k];
+			unsigned int a = collapse.from, b = collapse.to;
+			if(touched[a] || touched[b]) continue;
+
+			// Triangles around a that stay must not flip over
+			bool flips = false;
+			size_t lost = 0;
+			for(unsigned int k2 = offsets[a]; k2 < offsets[a + 1] && !flips; k2++)
+			{
+				const unsigned int * corners = &indices[3 * triangles[k2]];
+				if(corners[0] == b || corners[1] == b || corners[2] == b)
+				{
+					lost++;
+					continue;
+				}
+				const float * before[3], * after[3];
+				for(int c = 0; c < 3; c++)
+				{
+					before[c] = vertices + corners[c] * stride;
+					after[c] = vertices + (corners[c] == a ? b : corners[c]) * stride;
+				}
+				double n0[3], n1[3];
+				triangleNormal(before[0], before[1], before[2], n0);
+				triangleNormal(after[0], after[1], after[2], n1);
+				flips = n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2] <= 0;
+			}
+			if(flips) continue;
+
+			// Collapse, nothing around a changes again this pass so the triangle lists stay valid
+			remap[a] = b;
+			addQuadric(quadrics[b], quadrics[a]);
+			for(unsigned int k2 = offsets[a]; k2 < offsets[a + 1]; k2++)
+				for(int c = 0; c < 3; c++) touched[indices[3 * triangles[k2] + c]] = 1;
+			if(collapse.cost > maxCost) maxCost = collapse.cost;
+			removed += lost;
+			accepted++;
+		}
+		if(accepted == 0) break;
+
+		// Drop triangles that lost their area
+		size_t kept = 0;
+		for(size_t t = 0; t < indices.size(); t += 3)
+		{
+			unsigned int v0 = remap[indices[t]], v1 = remap[indices[t + 1]], v2 = remap[indices[t + 2]];
+			if(v0 == v1 || v1 == v2 || v0 == v2) continue;
+			for(int c = 0; c < 3; c++) original[kept + c] = original[t + c];
+			indices[kept++] = v0;
+			indices[kept++] = v1;
+			indices[kept++] = v2;
+		}
+		indices.resize(kept);
+		original.resize(kept);
+	}
+
+	// Corners that moved take the vertex at their new position whose normal and tex coord are closest to those they had
+	for(size_t k = 0; k < indices.size(); k++)
+	{
+		unsigned int from = original[k], position = indices[k];
+		if(welded[from] == position)
+		{
+			indices[k] = from;
+			continue;
+		}
+		double best = -1;
+		for(unsigned int g = groupStart[position]; g < vertexCount && welded[order[g]] == position; g++)
+		{
+			double distance = 0;
+			for(unsigned int f = 3; f < stride; f++)
+			{
+				double delta = vertices[order[g] * stride + f] - vertices[from * stride + f];
+				distance += delta * delta;
+			}
+			if(best < 0 || distance < best)
+			{
+				best = distance;
+				indices[k] = order[g];
+			}
+		}
+	}
+
+	return (float)sqrt(maxCost);
+}
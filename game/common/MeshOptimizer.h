@@ -0,0 +1,33 @@
+#ifndef MESHOPTIMIZER_H_
+#define MESHOPTIMIZER_H_
+
+#include <vector>
+
+/**
+ * Index buffer utilities for indexed triangle lists, independent of OpenGL
+ */
+class MeshOptimizer
+{
+
+public:
+
+	//! Post-transform cache size optimized for and measured with
+	static const int cacheSize = 32;
+
+	//! Replace every (position, normal, tex coord) index triplet by the index of its first occurrence, returns the unique triplets
+	static std::vector<unsigned int> deduplicate(const std::vector<unsigned int> & triplets, std::vector<unsigned int> & indices);
+
+	//! Reorder triangles for post-transform vertex cache reuse, Forsyth's linear-speed algorithm
+	static void optimizeVertexCache(std::vector<unsigned int> & indices, unsigned int vertexCount);
+
+	//! Average cache miss ratio, vertices transformed per triangle through a FIFO cache of cacheSize
+	static float computeACMR(const std::vector<unsigned int> & indices, unsigned int vertexCount);
+
+	//! Collapse edges by quadric error until at most targetIndexCount indices are left or no collapse keeps the surface intact.
+	//! Vertices are stride floats starting with xyz, moved corners take the existing vertex nearest in the remaining floats.
+	//! Open borders are kept, returns the largest error as a distance
+	static float simplify(std::vector<unsigned int> & indices, const float * vertices, unsigned int stride, unsigned int vertexCount, unsigned int targetIndexCount);
+
+};
+
+#endif
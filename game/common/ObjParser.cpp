@@ -0,0 +1,273 @@
+#include "ObjParser.h"
+
+#include <MappedFile.h>
+#include <iostream>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+// Powers of ten exactly representable as doubles
+static const double exactPowers[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+// Whether c is a decimal digit
+static inline bool isDigit(char c)
+{
+	return (unsigned char)(c - '0') < 10;
+}
+
+// Skip spaces and tabs
+static inline const char * skipBlanks(const char * p, const char * end)
+{
+	while(p < end && (*p == ' ' || *p == '\t')) p++;
+	return p;
+}
+
+// Whether c ends a token, a blank or the end of line
+static inline bool isSeparator(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+//! Constructor
+ObjParser::ObjParser()
+{
+}
+
+// Parse file through a memory mapping
+bool ObjParser::load(std::string filename)
+{
+	MappedFile file;
+	if(!file.open(filename, true))
+	{
+		std::cout << "Error opening " << filename << std::endl;
+		return false;
+	}
+
+	return parse(file.getData(), file.getSize(), filename);
+}
+
+// Parse OBJ text
+bool ObjParser::parse(const char * text, size_t size, std::string name)
+{
+	positions.clear();
+	texcoords.clear();
+	normals.clear();
+	corners.clear();
+
+	const int maxReports = 10;
+	int errors = 0, lineNumber = 0;
+	const char * end = text + size;
+	for(const char * p = text; p < end; )
+	{
+		p = skipBlanks(p, end);
+		const char * statement = p;
+		lineNumber++;
+
+		// Statement keyword followed by a blank, parsed straight through to the end of its numbers
+		const char * error = NULL;
+		if(end - p >= 2 && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t'))
+		{
+			p = parseVector(p + 2, end, 3, positions);
+			if(!p) error = "expected x y z";
+		}
+		else if(end - p >= 3 && p[0] == 'v' && p[1] == 't' && (p[2] == ' ' || p[2] == '\t'))
+		{
+			p = parseVector(p + 3, end, 2, texcoords);
+			if(!p) error = "expected u v";
+		}
+		else if(end - p >= 3 && p[0] == 'v' && p[1] == 'n' && (p[2] == ' ' || p[2] == '\t'))
+		{
+			p = parseVector(p + 3, end, 3, normals);
+			if(!p) error = "expected x y z";
+		}
+		else if(end - p >= 2 && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t'))
+		{
+			p += 2;
+			error = parseFace(p, end);
+		}
+
+		if(error && errors++ < maxReports)
+			std::cout << "Error in " << name << " line " << lineNumber << ": " << error << std::endl;
+
+		// Rest of the line, usually nothing but its end
+		if(error || !p) p = statement;
+		const char * newline = (const char *)memchr(p, '\n', end - p);
+		p = newline ? newline + 1 : end;
+	}
+
+	if(errors > 0)
+	{
+		if(errors > maxReports) std::cout << "Error in " << name << ": " << errors << " malformed lines" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+// Parse vector components
+const char * ObjParser::parseVector(const char * p, const char * end, int count, std::vector<float> & values)
+{
+	float value[3];
+	for(int k = 0; k < count; k++)
+	{
+		p = parseFloat(skipBlanks(p, end), end, value[k]);
+		if(!p || (p < end && !isSeparator(*p))) return NULL;
+	}
+
+	// Further components, w or a third tex coord, are not used
+	for(int k = 0; k < count; k++) values.push_back(value[k]);
+	return p;
+}
+
+// Parse face corners into triangles
+const char * ObjParser::parseFace(const char * & p, const char * end)
+{
+	size_t start = corners.size();
+	int positionCount = positions.size() / 3, texcoordCount = texcoords.size() / 2, normalCount = normals.size() / 3;
+	Corner first = { -1, -1, -1 }, previous = first;
+	int count = 0;
+	const char * error = NULL;
+
+	for(p = skipBlanks(p, end); p < end && *p != '\r' && *p != '\n' && !error; p = skipBlanks(p, end))
+	{
+		// v, v/vt, v//vn or v/vt/vn
+		Corner corner = { -1, -1, -1 };
+		int index;
+		p = parseInt(p, end, index);
+		if(!p) { error = "expected a position index"; break; }
+		corner.position = resolve(index, positionCount);
+		if(corner.position < 0) { error = "position index out of range"; break; }
+
+		if(p < end && *p == '/')
+		{
+			p++;
+			if(p < end && *p != '/')
+			{
+				p = parseInt(p, end, index);
+				if(!p) { error = "expected a tex coord index"; break; }
+				corner.texcoord = resolve(index, texcoordCount);
+				if(corner.texcoord < 0) { error = "tex coord index out of range"; break; }
+			}
+			if(p < end && *p == '/')
+			{
+				p = parseInt(p + 1, end, index);
+				if(!p) { error = "expected a normal index"; break; }
+				corner.normal = resolve(index, normalCount);
+				if(corner.normal < 0) { error = "normal index out of range"; break; }
+			}
+		}
+		if(p < end && !isSeparator(*p)) { error = "unexpected character in face"; break; }
+
+		// Fan around the first corner
+		if(count >= 2)
+		{
+			corners.push_back(first);
+			corners.push_back(previous);
+			corners.push_back(corner);
+		}
+		if(count == 0) first = corner;
+		previous = corner;
+		count++;
+	}
+
+	if(!error && count < 3) error = "face has fewer than three corners";
+	if(error) corners.resize(start);
+	return error;
+}
+
+// Resolve index
+int ObjParser::resolve(int index, size_t count)
+{
+	if(index > 0) return (size_t)index <= count ? index - 1 : -1;
+	if(index < 0) return (size_t)-index <= count ? (int)count + index : -1;
+	return -1;
+}
+
+// Parse decimal number
+const char * ObjParser::parseFloat(const char * first, const char * last, float & value)
+{
+	const char * p = first;
+	bool negative = p < last && *p == '-';
+	if(p < last && (*p == '-' || *p == '+')) p++;
+
+	// Integer and fraction digits, exact up to 19 significant digits, the rest only move the exponent
+	uint64_t mantissa = 0;
+	int exponent = 0;
+	const char * digits = p;
+	while(p < last && isDigit(*p)) mantissa = mantissa * 10 + (*p++ - '0');
+	const char * integerEnd = p;
+	if(p < last && *p == '.')
+	{
+		p++;
+		const char * fraction = p;
+		while(p < last && isDigit(*p)) mantissa = mantissa * 10 + (*p++ - '0');
+		exponent = -(int)(p - fraction);
+		if(p == fraction && integerEnd == digits) return NULL;
+	}
+	else if(integerEnd == digits) return NULL;
+
+	// Long numbers are rare, parse them again keeping only the significant digits
+	if(p - digits > 19)
+	{
+		mantissa = 0;
+		exponent = 0;
+		int significant = 0;
+		for(const char * q = digits; q < p; q++)
+		{
+			if(*q == '.') continue;
+			bool fraction = q > integerEnd;
+			if(significant < 19)
+			{
+				mantissa = mantissa * 10 + (*q - '0');
+				if(mantissa) significant++;
+				if(fraction) exponent--;
+			}
+			else if(!fraction) exponent++;
+		}
+	}
+
+	// Exponent only when digits follow the e
+	if(p < last && (*p == 'e' || *p == 'E'))
+	{
+		const char * q = p + 1;
+		bool negativeExponent = q < last && *q == '-';
+		if(q < last && (*q == '-' || *q == '+')) q++;
+		if(q < last && isDigit(*q))
+		{
+			int e = 0;
+			for(; q < last && isDigit(*q); q++)
+				if(e < 10000) e = e * 10 + (*q - '0');
+			exponent += negativeExponent ? -e : e;
+			p = q;
+		}
+	}
+
+	// One rounding when the mantissa and power of ten are exact doubles
+	double result = (double)mantissa;
+	if(mantissa != 0)
+	{
+		if(exponent < 0)
+			result = -exponent <= 22 ? result / exactPowers[-exponent] : result * pow(10.0, exponent);
+		else if(exponent > 0)
+			result = exponent <= 22 ? result * exactPowers[exponent] : result * pow(10.0, exponent);
+	}
+	value = (float)(negative ? -result : result);
+	return p;
+}
+
+// Parse decimal integer
+const char * ObjParser::parseInt(const char * first, const char * last, int & value)
+{
+	const char * p = first;
+	bool negative = p < last && *p == '-';
+	if(p < last && (*p == '-' || *p == '+')) p++;
+	if(p >= last || !isDigit(*p)) return NULL;
+
+	long long result = 0;
+	for(; p < last && isDigit(*p); p++)
+		if(result < 0x7fffffff) result = result * 10 + (*p - '0');
+	if(result > 0x7fffffff) result = 0x7fffffff;
+	value = (int)(negative ? -result : result);
+	return p;
+}
@@ -0,0 +1,64 @@
+#ifndef OBJPARSER_H_
+#define OBJPARSER_H_
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+/**
+ * Wavefront OBJ geometry read in one pass over a memory-mapped file, without allocating per line or face.
+ * Faces may have any number of corners and are fanned into triangles, corners may be v, v/vt, v//vn or v/vt/vn,
+ * and negative indices count back from the last element read. Other statements are skipped.
+ */
+class ObjParser
+{
+
+public:
+
+	//! Corner of a triangle, indices from zero, -1 for a missing tex coord or normal
+	struct Corner
+	{
+		int position, texcoord, normal;
+	};
+
+	//! Constructor
+	ObjParser();
+
+	//! Parse file through a memory mapping, returns false when it cannot be opened or is malformed
+	bool load(std::string filename);
+
+	//! Parse OBJ text, reports the first malformed lines and returns false for them
+	bool parse(const char * text, size_t size, std::string name);
+
+	//! Positions and normals as xyz, tex coords as uv
+	const std::vector<float> & getPositions() const { return positions; }
+	const std::vector<float> & getTexcoords() const { return texcoords; }
+	const std::vector<float> & getNormals() const { return normals; }
+
+	//! Three corners per triangle
+	const std::vector<Corner> & getCorners() const { return corners; }
+
+	//! Parse a decimal number like std::from_chars, returns the end of the number or NULL when there is none
+	static const char * parseFloat(const char * first, const char * last, float & value);
+	static const char * parseInt(const char * first, const char * last, int & value);
+
+private:
+
+	//! Parse the numbers of a v, vt or vn statement onto values, returns where they end or NULL when there are too few
+	static const char * parseVector(const char * p, const char * end, int count, std::vector<float> & values);
+
+	//! Parse the corners of an f statement into triangles, advancing p past them, returns an error message or NULL
+	const char * parseFace(const char * & p, const char * end);
+
+	//! Resolve a one-based or negative index into count elements, -1 when out of range
+	static int resolve(int index, size_t count);
+
+private:
+
+	//! Elements read so far
+	std::vector<float> positions, texcoords, normals;
+	std::vector<Corner> corners;
+
+};
+
+#endif
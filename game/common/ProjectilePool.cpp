@@ -0,0 +1,170 @@
+#include "ProjectilePool.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PROJECTILEPOOL_SSE2
+#include <emmintrin.h>
+#endif
+
+//! Constructor
+ProjectilePool::ProjectilePool() : count(0)
+{
+}
+
+//! Copy constructor
+ProjectilePool::ProjectilePool(const ProjectilePool & other) : count(0)
+{
+	*this = other;
+}
+
+// Copy live projectiles
+ProjectilePool & ProjectilePool::operator=(const ProjectilePool & other)
+{
+	if(this == &other) return *this;
+	if(getCapacity() != other.getCapacity()) setCapacity(other.getCapacity());
+
+	// Only the live part is copied, snapshots of a nearly empty pool stay cheap
+	count = other.count;
+	std::vector<float> ProjectilePool::* arrays[9] = {
+		&ProjectilePool::positionX, &ProjectilePool::positionY, &ProjectilePool::positionZ,
+		&ProjectilePool::previousX, &ProjectilePool::previousY, &ProjectilePool::previousZ,
+		&ProjectilePool::velocityX, &ProjectilePool::velocityY, &ProjectilePool::velocityZ };
+	for(int a = 0; a < 9; a++)
+		std::copy((other.*arrays[a]).begin(), (other.*arrays[a]).begin() + count, (this->*arrays[a]).begin());
+
+	return *this;
+}
+
+// Allocate storage
+void ProjectilePool::setCapacity(int capacity)
+{
+	positionX.assign(capacity, 0);
+	positionY.assign(capacity, 0);
+	positionZ.assign(capacity, 0);
+	previousX.assign(capacity, 0);
+	previousY.assign(capacity, 0);
+	previousZ.assign(capacity, 0);
+	velocityX.assign(capacity, 0);
+	velocityY.assign(capacity, 0);
+	velocityZ.assign(capacity, 0);
+	count = 0;
+}
+
+// Maximum number of projectiles
+int ProjectilePool::getCapacity() const
+{
+	return (int)positionX.size();
+}
+
+// Number of live projectiles
+int ProjectilePool::getCount() const
+{
+	return count;
+}
+
+// Add projectile
+bool ProjectilePool::spawn(Vector3f position, Vector3f velocity)
+{
+	if(count == getCapacity()) return false;
+
+	positionX[count] = previousX[count] = position.x;
+	positionY[count] = previousY[count] = position.y;
+	positionZ[count] = previousZ[count] = position.z;
+	velocityX[count] = velocity.x;
+	velocityY[count] = velocity.y;
+	velocityZ[count] = velocity.z;
+	count++;
+	return true;
+}
+
+// Remove projectile, the last one takes its index
+void ProjectilePool::remove(int k)
+{
+	int last = --count;
+	positionX[k] = positionX[last];
+	positionY[k] = positionY[last];
+	positionZ[k] = positionZ[last];
+	previousX[k] = previousX[last];
+	previousY[k] = previousY[last];
+	previousZ[k] = previousZ[last];
+	velocityX[k] = velocityX[last];
+	velocityY[k] = velocityY[last];
+	velocityZ[k] = velocityZ[last];
+}
+
+// Remove all projectiles
+void ProjectilePool::clear()
+{
+	count = 0;
+}
+
+// Move all projectiles by one step
+void ProjectilePool::integrate(float gravity, float timeStep)
+{
+	if(count == 0) return;
+
+	float * px = &positionX[0];
+	float * py = &positionY[0];
+	float * pz = &positionZ[0];
+	float * qx = &previousX[0];
+	float * qy = &previousY[0];
+	float * qz = &previousZ[0];
+	const float * vx = &velocityX[0];
+	float * vy = &velocityY[0];
+	const float * vz = &velocityZ[0];
+	float fall = gravity * timeStep;
+	int k = 0;
+
+#ifdef PROJECTILEPOOL_SSE2
+	// Four projectiles at a time, same operations in the same order as the scalar loop
+	__m128 fall4 = _mm_set1_ps(fall);
+	__m128 step4 = _mm_set1_ps(timeStep);
+	for(; k + 4 <= count; k += 4)
+	{
+		__m128 x = _mm_loadu_ps(px + k), y = _mm_loadu_ps(py + k), z = _mm_loadu_ps(pz + k);
+		__m128 velocity = _mm_add_ps(_mm_loadu_ps(vy + k), fall4);
+		_mm_storeu_ps(vy + k, velocity);
+
+		// Keep previous positions for swept collision and interpolation, then move
+		_mm_storeu_ps(qx + k, x);
+		_mm_storeu_ps(qy + k, y);
+		_mm_storeu_ps(qz + k, z);
+		_mm_storeu_ps(px + k, _mm_add_ps(x, _mm_mul_ps(_mm_loadu_ps(vx + k), step4)));
+		_mm_storeu_ps(py + k, _mm_add_ps(y, _mm_mul_ps(velocity, step4)));
+		_mm_storeu_ps(pz + k, _mm_add_ps(z, _mm_mul_ps(_mm_loadu_ps(vz + k), step4)));
+	}
+#endif
+
+	for(; k < count; k++)
+	{
+		// Falling under gravity
+		vy[k] += fall;
+
+		// Keep previous positions for swept collision and interpolation, then move
+		qx[k] = px[k];
+		qy[k] = py[k];
+		qz[k] = pz[k];
+		px[k] = px[k] + vx[k] * timeStep;
+		py[k] = py[k] + vy[k] * timeStep;
+		pz[k] = pz[k] + vz[k] * timeStep;
+	}
+}
+
+// Position of projectile
+Vector3f ProjectilePool::getPosition(int k) const
+{
+	return Vector3f(positionX[k], positionY[k], positionZ[k]);
+}
+
+// Position of projectile before the last integrate
+Vector3f ProjectilePool::getPreviousPosition(int k) const
+{
+	return Vector3f(previousX[k], previousY[k], previousZ[k]);
+}
+
+// Velocity of projectile
+Vector3f ProjectilePool::getVelocity(int k) const
+{
+	return Vector3f(velocityX[k], velocityY[k], velocityZ[k]);
+}
@@ -0,0 +1,68 @@
+#ifndef PROJECTILEPOOL_H_
+#define PROJECTILEPOOL_H_
+
+#include <Vector.h>
+#include <vector>
+
+/**
+ * Fixed-capacity pool of projectiles as structure of arrays.
+ * Storage is allocated once by setCapacity, live projectiles are the first getCount entries,
+ * and removing one moves the last into its place.
+ */
+class ProjectilePool
+{
+
+public:
+
+	//! Constructor, no capacity
+	ProjectilePool();
+
+	//! Copy live projectiles, storage is only allocated when capacities differ
+	ProjectilePool & operator=(const ProjectilePool & other);
+	ProjectilePool(const ProjectilePool & other);
+
+	//! Allocate storage for capacity projectiles and remove all
+	void setCapacity(int capacity);
+
+	//! Maximum number of projectiles
+	int getCapacity() const;
+
+	//! Number of live projectiles
+	int getCount() const;
+
+	//! Add projectile, returns false when the pool is full
+	bool spawn(Vector3f position, Vector3f velocity);
+
+	//! Remove projectile k, the last one takes its index
+	void remove(int k);
+
+	//! Remove all projectiles
+	void clear();
+
+	//! Fall under gravity and move all projectiles by one step, keeping the positions they moved from
+	void integrate(float gravity, float timeStep);
+
+	//! Position of projectile k
+	Vector3f getPosition(int k) const;
+
+	//! Position of projectile k before the last integrate
+	Vector3f getPreviousPosition(int k) const;
+
+	//! Velocity of projectile k
+	Vector3f getVelocity(int k) const;
+
+public:
+
+	//! Projectile arrays, valid up to getCount
+	std::vector<float> positionX, positionY, positionZ;
+	std::vector<float> previousX, previousY, previousZ;
+	std::vector<float> velocityX, velocityY, velocityZ;
+
+private:
+
+	//! Live projectiles
+	int count;
+
+};
+
+#endif
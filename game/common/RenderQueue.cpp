@@ -0,0 +1,150 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <string.h>
+
+//! Constructor
+RenderQueue::RenderQueue()
+: itemCount(0), vertexPositionAttribute(0), vertexNormalAttribute(-1), vertexTexcordAttribute(-1),
+  modelUniform(-1), specularUniform(-1), textureTarget(GL_TEXTURE_2D), layerAttribute(-1), specular(1, 1, 1)
+{
+	memset(&stats, 0, sizeof(stats));
+}
+
+// Attribute locations
+void RenderQueue::setAttributes(GLuint vertexPositionAttribute, GLuint vertexNormalAttribute, GLuint vertexTexcordAttribute)
+{
+	this->vertexPositionAttribute = vertexPositionAttribute;
+	this->vertexNormalAttribute = vertexNormalAttribute;
+	this->vertexTexcordAttribute = vertexTexcordAttribute;
+}
+
+// Uniform locations
+void RenderQueue::setUniforms(GLint modelUniform, GLint specularUniform)
+{
+	this->modelUniform = modelUniform;
+	this->specularUniform = specularUniform;
+}
+
+// Texture target and layer attribute
+void RenderQueue::setTextures(GLenum textureTarget, GLint layerAttribute)
+{
+	this->textureTarget = textureTarget;
+	this->layerAttribute = layerAttribute;
+}
+
+// Specular colour of shiny materials
+void RenderQueue::setSpecular(Vector3f specular)
+{
+	this->specular = specular;
+}
+
+// Queue a draw
+void RenderQueue::push(Mesh & mesh, const Material & material, Matrix4x4 & transform, int level)
+{
+	// Storage grows to the largest frame and is reused after that
+	if(itemCount == (int)items.size())
+	{
+		items.resize(items.size() * 2 + 16);
+		order.resize(items.size());
+	}
+
+	Item & item = items[itemCount];
+	item.mesh = &mesh;
+	item.material = material;
+	item.transform = transform;
+	item.level = level;
+	order[itemCount].key = makeKey(mesh, material);
+	order[itemCount].item = itemCount;
+	itemCount++;
+}
+
+// Sort and draw
+void RenderQueue::submit()
+{
+	memset(&stats, 0, sizeof(stats));
+	stats.items = itemCount;
+	if(itemCount == 0) return;
+
+	std::sort(order.begin(), order.begin() + itemCount);
+
+	// Nothing is assumed about the state before the first item
+	const Item & first = items[order[0].item];
+	GLuint program = first.material.program + 1, texture = first.material.texture + 1;
+	int layer = -1, shiny = -1;
+	Mesh * mesh = NULL;
+
+	for(int k = 0; k < itemCount; k++)
+	{
+		Item & item = items[order[k].item];
+
+		if(item.material.program != program)
+		{
+			program = item.material.program;
+			glUseProgram(program);
+			stats.programBinds++;
+		}
+
+		if(item.material.texture != texture)
+		{
+			texture = item.material.texture;
+			glBindTexture(textureTarget, texture);
+			stats.textureBinds++;
+		}
+
+		// A constant attribute value, so switching layers costs no binding
+		if(item.material.layer != layer && layerAttribute >= 0)
+		{
+			layer = item.material.layer;
+			glVertexAttrib1f(layerAttribute, (float)layer);
+			stats.layerSets++;
+		}
+
+		if((int)item.material.shiny != shiny)
+		{
+			shiny = item.material.shiny;
+			if(shiny)
+				glUniform4f(specularUniform, specular.x, specular.y, specular.z, 1);
+			else
+				glUniform4f(specularUniform, 0, 0, 0, 1);
+			stats.materialSets++;
+		}
+
+		if(item.mesh != mesh)
+		{
+			if(mesh) mesh->Unbind(vertexPositionAttribute, vertexNormalAttribute, vertexTexcordAttribute);
+			mesh = item.mesh;
+			mesh->Bind(vertexPositionAttribute, vertexNormalAttribute, vertexTexcordAttribute);
+			stats.meshBinds++;
+		}
+
+		// Only the model matrix is set for every item, the view comes from the frame uniforms
+		glUniformMatrix4fv(modelUniform, 1, false, item.transform.getPtr());
+		mesh->DrawBound(item.level);
+	}
+
+	mesh->Unbind(vertexPositionAttribute, vertexNormalAttribute, vertexTexcordAttribute);
+
+	stats.programBindsAvoided = itemCount - stats.programBinds;
+	stats.textureBindsAvoided = itemCount - stats.textureBinds;
+	stats.layerSetsAvoided = itemCount - stats.layerSets;
+	stats.materialSetsAvoided = itemCount - stats.materialSets;
+	stats.meshBindsAvoided = itemCount - stats.meshBinds;
+	itemCount = 0;
+}
+
+// Counts of the last submit
+const RenderQueue::Stats & RenderQueue::getStats() const
+{
+	return stats;
+}
+
+// Packed state key
+uint64_t RenderQueue::makeKey(const Mesh & mesh, const Material & material)
+{
+	return ((uint64_t)(material.program & 0xffff) << 48)
+	     | ((uint64_t)(material.texture & 0xffff) << 32)
+	     | ((uint64_t)(material.layer & 0xff) << 24)
+	     | ((uint64_t)(material.shiny ? 1 : 0) << 23)
+	     | (uint64_t)(mesh.getId() & 0x7fffff);
+}
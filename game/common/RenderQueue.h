@@ -0,0 +1,109 @@
+#ifndef RENDERQUEUE_H_
+#define RENDERQUEUE_H_
+
+#include <GL/glew.h>
+#include <Matrix.h>
+#include <Mesh.h>
+#include <Vector.h>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * Mesh draws collected over a frame and submitted sorted by a packed state key,
+ * program first, then texture and layer, then material, then mesh, so state is only set when it changes.
+ * All programs are expected to share the attribute and uniform locations given to the queue.
+ */
+class RenderQueue
+{
+
+public:
+
+	//! State shared by draws
+	struct Material
+	{
+		GLuint program;
+		GLuint texture;
+
+		//! Layer of an array texture, passed to the shader as the instance layer attribute
+		int layer;
+
+		//! Shiny materials use the specular colour, others none
+		bool shiny;
+	};
+
+	//! State changes of the last submit, and those avoided compared to setting everything for every item
+	struct Stats
+	{
+		int items;
+		int programBinds, textureBinds, layerSets, materialSets, meshBinds;
+		int programBindsAvoided, textureBindsAvoided, layerSetsAvoided, materialSetsAvoided, meshBindsAvoided;
+	};
+
+	//! Constructor
+	RenderQueue();
+
+	//! Vertex attribute locations items are drawn with
+	void setAttributes(GLuint vertexPositionAttribute, GLuint vertexNormalAttribute, GLuint vertexTexcordAttribute);
+
+	//! Uniform locations for the model matrix and specular colour
+	void setUniforms(GLint modelUniform, GLint specularUniform);
+
+	//! Texture target materials bind to and the layer attribute, GL_TEXTURE_2D_ARRAY when textures are array layers
+	void setTextures(GLenum textureTarget, GLint layerAttribute);
+
+	//! Specular colour of shiny materials
+	void setSpecular(Vector3f specular);
+
+	//! Queue a draw of mesh with material at transform, at a level of detail of the mesh
+	void push(Mesh & mesh, const Material & material, Matrix4x4 & transform, int level = 0);
+
+	//! Sort and draw all queued items, then empty the queue
+	void submit();
+
+	//! Counts of the last submit
+	const Stats & getStats() const;
+
+private:
+
+	//! Packed state key, program in the top 16 bits, texture in the next 16, layer in 8, then material and mesh
+	static uint64_t makeKey(const Mesh & mesh, const Material & material);
+
+	//! Queued draw
+	struct Item
+	{
+		Mesh * mesh;
+		Material material;
+		Matrix4x4 transform;
+		int level;
+	};
+
+	//! Sort entry, the key and the item it belongs to
+	struct Entry
+	{
+		uint64_t key;
+		int item;
+		bool operator<(const Entry & other) const { return key < other.key || (key == other.key && item < other.item); }
+	};
+
+private:
+
+	//! Queued draws and their order, kept between frames to reuse storage
+	std::vector<Item> items;
+	std::vector<Entry> order;
+	int itemCount;
+
+	//! Locations
+	GLuint vertexPositionAttribute, vertexNormalAttribute, vertexTexcordAttribute;
+	GLint modelUniform, specularUniform;
+	GLenum textureTarget;
+	GLint layerAttribute;
+
+	//! Specular colour of shiny materials
+	Vector3f specular;
+
+	//! Counts of the last submit
+	Stats stats;
+
+};
+
+#endif
@@ -0,0 +1,288 @@
+#include "Replay.h"
+
+#include <fstream>
+#include <iostream>
+#include <string.h>
+
+// Replay file header, followed by event bytes
+static const char replayMagic[4] = { 'T', 'R', 'P', '1' };
+
+// FNV-1a of bytes
+static uint64_t hashBytes(uint64_t h, const void * data, size_t size)
+{
+	const unsigned char * bytes = (const unsigned char *)data;
+	for(size_t k = 0; k < size; k++)
+		h = (h ^ bytes[k]) * 1099511628211ULL;
+	return h;
+}
+
+// FNV-1a of a value's bytes
+template<class T>
+static uint64_t hashValue(uint64_t h, const T & value)
+{
+	return hashBytes(h, &value, sizeof(value));
+}
+
+//! Constructor
+Replay::Replay()
+: mazeHash(0), timeStep(0), turretHeight(defaultTurretHeight), tickCount(0), finalHash(0), finished(false), lastPan(0)
+{
+}
+
+// Start recording
+void Replay::begin(GameSim & sim, float timeStep)
+{
+	mazeHash = hashMaze(sim);
+	this->timeStep = timeStep;
+	turretHeight = sim.getWorld().turretHeight;
+
+	events.clear();
+	tickCount = 0;
+	finalHash = 0;
+	finished = false;
+	lastPan = 0;
+}
+
+// Record a restart before the next step
+void Replay::recordRestart()
+{
+	events.push_back(Restart);
+}
+
+// Record the inputs of one step
+void Replay::recordStep(const Inputs & inputs)
+{
+	unsigned char event = 0;
+	if(inputs.accelerate) event |= Accelerate;
+	if(inputs.decelerate) event |= Decelerate;
+	if(inputs.turnLeft) event |= TurnLeft;
+	if(inputs.turnRight) event |= TurnRight;
+	if(inputs.shoot) event |= Shoot;
+
+	// Turret pan only when its bits changed
+	bool panChanged = memcmp(&inputs.turretPan, &lastPan, sizeof(float)) != 0;
+	if(panChanged) event |= Pan;
+	events.push_back(event);
+	if(panChanged)
+	{
+		const unsigned char * bytes = (const unsigned char *)&inputs.turretPan;
+		events.insert(events.end(), bytes, bytes + sizeof(float));
+		lastPan = inputs.turretPan;
+	}
+
+	tickCount++;
+}
+
+// Stop recording
+void Replay::finish(GameSim & sim)
+{
+	finalHash = hashState(sim);
+	finished = true;
+}
+
+// Save to file
+bool Replay::save(std::string filename) const
+{
+	std::ofstream out(filename.c_str(), std::ios::binary);
+	if(!out)
+	{
+		std::cout << "Error creating " << filename << std::endl;
+		return false;
+	}
+
+	uint32_t flags = finished ? 1 : 0;
+	uint64_t size = events.size();
+	out.write(replayMagic, 4);
+	out.write((const char *)&mazeHash, sizeof(mazeHash));
+	out.write((const char *)&timeStep, sizeof(timeStep));
+	out.write((const char *)&turretHeight, sizeof(turretHeight));
+	out.write((const char *)&tickCount, sizeof(tickCount));
+	out.write((const char *)&finalHash, sizeof(finalHash));
+	out.write((const char *)&flags, sizeof(flags));
+	out.write((const char *)&size, sizeof(size));
+	if(size > 0) out.write((const char *)&events[0], size);
+
+	return out.good();
+}
+
+// Load from file
+bool Replay::load(std::string filename)
+{
+	std::ifstream in(filename.c_str(), std::ios::binary);
+	if(!in)
+	{
+		std::cout << "Error opening " << filename << std::endl;
+		return false;
+	}
+
+	char magic[4];
+	uint32_t flags;
+	uint64_t size;
+	in.read(magic, 4);
+	in.read((char *)&mazeHash, sizeof(mazeHash));
+	in.read((char *)&timeStep, sizeof(timeStep));
+	in.read((char *)&turretHeight, sizeof(turretHeight));
+	in.read((char *)&tickCount, sizeof(tickCount));
+	in.read((char *)&finalHash, sizeof(finalHash));
+	in.read((char *)&flags, sizeof(flags));
+	in.read((char *)&size, sizeof(size));
+	if(!in || memcmp(magic, replayMagic, 4) != 0)
+	{
+		std::cout << "Error in " << filename << ": not a replay file" << std::endl;
+		return false;
+	}
+
+	// Event count checked against the rest of the file before anything is allocated for it
+	std::streamoff start = in.tellg();
+	in.seekg(0, std::ios::end);
+	uint64_t remaining = (uint64_t)(in.tellg() - start);
+	in.seekg(start);
+	if(size > remaining)
+	{
+		std::cout << "Error in " << filename << ": truncated after " << remaining << " of " << size << " event bytes" << std::endl;
+		return false;
+	}
+
+	events.resize((size_t)size);
+	if(size > 0) in.read((char *)&events[0], size);
+	if(!in)
+	{
+		std::cout << "Error in " << filename << ": truncated after " << in.gcount() << " of " << size << " event bytes" << std::endl;
+		return false;
+	}
+
+	finished = (flags & 1) != 0;
+	lastPan = 0;
+	return true;
+}
+
+// Play back as fast as possible
+bool Replay::play(GameSim & sim) const
+{
+	sim.setTurretHeight(turretHeight);
+	sim.restart();
+	if(hashMaze(sim) != mazeHash)
+	{
+		std::cout << "Error: replay was recorded on a different maze" << std::endl;
+		return false;
+	}
+
+	// Decode and step
+	Inputs inputs;
+	size_t k = 0, count = events.size();
+	while(k < count)
+	{
+		unsigned char event = events[k++];
+		if(event & Restart)
+		{
+			sim.restart();
+			continue;
+		}
+
+		inputs.accelerate = (event & Accelerate) != 0;
+		inputs.decelerate = (event & Decelerate) != 0;
+		inputs.turnLeft = (event & TurnLeft) != 0;
+		inputs.turnRight = (event & TurnRight) != 0;
+		inputs.shoot = (event & Shoot) != 0;
+		if(event & Pan)
+		{
+			if(k + sizeof(float) > count) break;
+			memcpy(&inputs.turretPan, &events[k], sizeof(float));
+			k += sizeof(float);
+		}
+
+		sim.step(inputs, timeStep);
+	}
+
+	// Sessions that were not finished have nothing to compare against
+	return !finished || hashState(sim) == finalHash;
+}
+
+// Number of recorded steps
+uint64_t Replay::getTickCount() const
+{
+	return tickCount;
+}
+
+// Time step used while recording
+float Replay::getTimeStep() const
+{
+	return timeStep;
+}
+
+// Hash of recorded final state
+uint64_t Replay::getFinalHash() const
+{
+	return finalHash;
+}
+
+// Hash of maze layout
+uint64_t Replay::hashMaze(GameSim & sim)
+{
+	// Streamed mazes are identified by the checksum of their tiles stored in the header
+	TiledMaze * tiled = sim.getTiledMaze();
+	if(tiled)
+	{
+		uint64_t h = 14695981039346656037ULL;
+		h = hashValue(h, tiled->getRows());
+		h = hashValue(h, tiled->getCols());
+		h = hashValue(h, tiled->getTotalTargets());
+		return hashValue(h, tiled->getChecksum());
+	}
+
+	return sim.getWorld().maze.hash();
+}
+
+// Hash of complete world state
+uint64_t Replay::hashState(GameSim & sim)
+{
+	World & world = sim.getWorld();
+
+	uint64_t h = world.maze.hash();
+
+	// Streamed mazes keep removed targets apart from their tiles, summed so the set's order does not matter
+	TiledMaze * tiled = sim.getTiledMaze();
+	if(tiled)
+	{
+		const std::unordered_set<int64_t> & removed = tiled->getRemovedTargets();
+		uint64_t sum = 0;
+		for(std::unordered_set<int64_t>::const_iterator it = removed.begin(); it != removed.end(); ++it)
+			sum += hashValue(14695981039346656037ULL, *it);
+		h = hashValue(h, removed.size());
+		h = hashValue(h, sum);
+	}
+	h = hashValue(h, world.tankPosition.x);
+	h = hashValue(h, world.tankPosition.y);
+	h = hashValue(h, world.tankPosition.z);
+	h = hashValue(h, world.tankDistanceTravelled);
+	h = hashValue(h, world.tankAngle);
+	h = hashValue(h, world.tankVelocity);
+	h = hashValue(h, world.tankFallVelocity);
+	h = hashValue(h, world.tankFallingTime);
+	h = hashValue(h, world.tankAccelerating);
+	h = hashValue(h, world.tankDecelerating);
+	h = hashValue(h, world.tankTurningLeft);
+	h = hashValue(h, world.tankTurningRight);
+	h = hashValue(h, world.tankFalling);
+	h = hashValue(h, world.turretHeight);
+	h = hashValue(h, world.totalCoins);
+	h = hashValue(h, world.collectedCoins);
+
+	// Balls in flight
+	const ProjectilePool & balls = world.balls;
+	int ballCount = balls.getCount();
+	h = hashValue(h, ballCount);
+	if(ballCount > 0)
+	{
+		h = hashBytes(h, &balls.positionX[0], ballCount * sizeof(float));
+		h = hashBytes(h, &balls.positionY[0], ballCount * sizeof(float));
+		h = hashBytes(h, &balls.positionZ[0], ballCount * sizeof(float));
+		h = hashBytes(h, &balls.velocityX[0], ballCount * sizeof(float));
+		h = hashBytes(h, &balls.velocityY[0], ballCount * sizeof(float));
+		h = hashBytes(h, &balls.velocityZ[0], ballCount * sizeof(float));
+	}
+
+	h = hashValue(h, world.timeRemaining);
+	h = hashValue(h, world.gameOver);
+	return hashBytes(h, world.gameOverMessage, strlen(world.gameOverMessage));
+}
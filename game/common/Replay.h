@@ -0,0 +1,87 @@
+#ifndef REPLAY_H_
+#define REPLAY_H_
+
+#include <GameSim.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * Recorded session, the inputs of every step and every restart in order.
+ * Each step is one byte of key and shoot flags, followed by the turret pan only when it changed.
+ * Playing it back on the same maze reproduces the final state bit for bit.
+ */
+class Replay
+{
+
+public:
+
+	//! Constructor
+	Replay();
+
+	//! Start recording on a simulation that has just been restarted
+	void begin(GameSim & sim, float timeStep);
+
+	//! Record a restart before the next step
+	void recordRestart();
+
+	//! Record the inputs of one step
+	void recordStep(const Inputs & inputs);
+
+	//! Stop recording, remembering the final state for playback to compare against
+	void finish(GameSim & sim);
+
+	//! Save to file
+	bool save(std::string filename) const;
+
+	//! Load from file
+	bool load(std::string filename);
+
+	//! Play back on a simulation with the recorded maze loaded, as fast as possible, returns whether the final state matches
+	bool play(GameSim & sim) const;
+
+	//! Number of recorded steps
+	uint64_t getTickCount() const;
+
+	//! Time step used while recording
+	float getTimeStep() const;
+
+	//! Hash of recorded final state
+	uint64_t getFinalHash() const;
+
+	//! Hash of maze layout a simulation starts from
+	static uint64_t hashMaze(GameSim & sim);
+
+	//! Hash of complete world state
+	static uint64_t hashState(GameSim & sim);
+
+private:
+
+	//! Event byte flags
+	enum
+	{
+		Accelerate = 1, Decelerate = 2, TurnLeft = 4, TurnRight = 8,
+		Shoot = 16, Pan = 32, Restart = 128
+	};
+
+private:
+
+	//! Recording conditions
+	uint64_t mazeHash;
+	float timeStep;
+	float turretHeight;
+
+	//! Event bytes and number of steps among them
+	std::vector<unsigned char> events;
+	uint64_t tickCount;
+
+	//! Final state, valid once finished
+	uint64_t finalHash;
+	bool finished;
+
+	//! Last recorded turret pan
+	float lastPan;
+
+};
+
+#endif
@@ -0,0 +1,224 @@
+#include "SimThread.h"
+
+// Longest real time caught up in one go, beyond it the game slows down instead of stalling
+static const double maxCatchUp = 0.25;
+
+// Linear interpolation
+static float lerp(float a, float b, float alpha)
+{
+	return a + (b - a) * alpha;
+}
+
+//! Constructor
+SimThread::SimThread(GameSim & sim, float timeStep)
+: sim(sim), timeStep(timeStep), replay(NULL), quit(false), startTime(std::chrono::steady_clock::now()),
+  shootRequested(false), restartRequested(false), removedGames(0), viewGames(-1), viewRemoved(0)
+{
+}
+
+//! Destructor
+SimThread::~SimThread()
+{
+	stop();
+}
+
+// Record steps and restarts
+void SimThread::setReplay(Replay * replay)
+{
+	this->replay = replay;
+}
+
+// Start stepping
+void SimThread::start()
+{
+	if(thread.joinable()) return;
+
+	// First snapshot is the world as it is now
+	startTime = std::chrono::steady_clock::now();
+	removedTargets = sim.getRemovedTargets();
+	removedGames = 0;
+	viewGames = -1;
+	publish(0, 0, getMotion());
+	snapshots.update();
+	current = snapshots.getReadBuffer();
+
+	quit = false;
+	thread = std::thread(&SimThread::run, this);
+}
+
+// Stop stepping
+void SimThread::stop()
+{
+	if(!thread.joinable()) return;
+
+	quit = true;
+	thread.join();
+}
+
+// Keys and turret pan for the next steps
+void SimThread::setInputs(const Inputs & inputs)
+{
+	// Shooting is an event taken from shoot()
+	std::lock_guard<std::mutex> lock(inputMutex);
+	this->inputs = inputs;
+}
+
+// Fire a ball at the next step
+void SimThread::shoot()
+{
+	std::lock_guard<std::mutex> lock(inputMutex);
+	shootRequested = true;
+}
+
+// Restart game before the next step
+void SimThread::restart()
+{
+	std::lock_guard<std::mutex> lock(inputMutex);
+	restartRequested = true;
+}
+
+// World interpolated across the latest step
+void SimThread::getView(World & view)
+{
+	if(snapshots.update()) current = snapshots.getReadBuffer();
+
+	// Time since the latest step as a fraction of a step, the view trails the simulation by one step
+	float alpha = (float)((now() - current.time) / timeStep);
+	if(alpha < 0) alpha = 0;
+	if(alpha > 1) alpha = 1;
+
+	// Maze copied once per game without the lock, the initial maze only changes before start
+	if(current.games != viewGames)
+	{
+		view.maze = sim.getInitialMaze();
+		viewGames = current.games;
+		viewRemoved = 0;
+	}
+
+	// Then only the targets removed since the last frame, unless the thread has restarted since the snapshot
+	if(viewRemoved < current.removedTargets)
+	{
+		std::lock_guard<std::mutex> lock(mazeMutex);
+		int cols = view.maze.getCols();
+		for(; removedGames == current.games && viewRemoved < current.removedTargets; viewRemoved++)
+			view.maze.removeTarget((int)(removedTargets[viewRemoved] / cols), (int)(removedTargets[viewRemoved] % cols));
+	}
+
+	// Interpolate moving parts over the one step the snapshot covers, however many steps the last frame missed
+	(WorldState &)view = current.state;
+	const Motion & from = current.before;
+	const WorldState & to = current.state;
+	view.tankPosition = Vector3f(lerp(from.tankPosition.x, to.tankPosition.x, alpha),
+	                             lerp(from.tankPosition.y, to.tankPosition.y, alpha),
+	                             lerp(from.tankPosition.z, to.tankPosition.z, alpha));
+	view.tankAngle = lerp(from.tankAngle, to.tankAngle, alpha);
+	view.tankDistanceTravelled = lerp(from.tankDistanceTravelled, to.tankDistanceTravelled, alpha);
+	view.timeRemaining = lerp(from.timeRemaining, to.timeRemaining, alpha);
+
+	// Balls move between the positions of their last step
+	ProjectilePool & balls = view.balls;
+	for(int k = 0; k < balls.getCount(); k++)
+	{
+		balls.positionX[k] = lerp(balls.previousX[k], balls.positionX[k], alpha);
+		balls.positionY[k] = lerp(balls.previousY[k], balls.positionY[k], alpha);
+		balls.positionZ[k] = lerp(balls.previousZ[k], balls.positionZ[k], alpha);
+	}
+}
+
+// Thread main loop
+void SimThread::run()
+{
+	long long tick = 0;
+	int games = 0;
+	size_t removedCount = sim.getRemovedTargets().size();
+	Motion before;
+	double accumulator = 0;
+	double last = now();
+
+	while(!quit)
+	{
+		// Real time since last pass
+		double time = now();
+		double elapsed = time - last;
+		last = time;
+		if(elapsed > maxCatchUp) elapsed = maxCatchUp;
+		accumulator += elapsed;
+
+		// Fixed steps for the time that passed
+		while(accumulator >= timeStep)
+		{
+			Inputs stepInputs;
+			bool restarting;
+			{
+				std::lock_guard<std::mutex> lock(inputMutex);
+				stepInputs = inputs;
+				stepInputs.shoot = shootRequested;
+				restarting = restartRequested;
+				shootRequested = false;
+				restartRequested = false;
+			}
+
+			if(restarting)
+			{
+				sim.restart();
+				if(replay) replay->recordRestart();
+				games++;
+				removedCount = 0;
+
+				std::lock_guard<std::mutex> lock(mazeMutex);
+				removedTargets.clear();
+				removedGames = games;
+			}
+
+			if(replay) replay->recordStep(stepInputs);
+			before = getMotion();
+			sim.step(stepInputs, timeStep);
+
+			// Targets removed by the step handed to the display, the lock is only held to append them
+			const std::vector<int64_t> & removed = sim.getRemovedTargets();
+			if(removed.size() > removedCount)
+			{
+				std::lock_guard<std::mutex> lock(mazeMutex);
+				removedTargets.insert(removedTargets.end(), removed.begin() + removedCount, removed.end());
+			}
+			removedCount = removed.size();
+			accumulator -= timeStep;
+			publish(++tick, games, before);
+		}
+
+		// Sleep until the next step is due
+		std::this_thread::sleep_for(std::chrono::duration<double>(timeStep - accumulator));
+	}
+}
+
+// Publish world after a step
+void SimThread::publish(long long tick, int games, const Motion & before)
+{
+	Snapshot & snapshot = snapshots.getWriteBuffer();
+	snapshot.state = sim.getWorld();
+	snapshot.before = before;
+	snapshot.removedTargets = sim.getRemovedTargets().size();
+	snapshot.tick = tick;
+	snapshot.games = games;
+	snapshot.time = now();
+	snapshots.publish();
+}
+
+// Tank and clock of the simulation
+Motion SimThread::getMotion() const
+{
+	const World & world = sim.getWorld();
+	Motion motion;
+	motion.tankPosition = world.tankPosition;
+	motion.tankAngle = world.tankAngle;
+	motion.tankDistanceTravelled = world.tankDistanceTravelled;
+	motion.timeRemaining = world.timeRemaining;
+	return motion;
+}
+
+// Seconds since start
+double SimThread::now() const
+{
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+	return elapsed.count();
+}
@@ -0,0 +1,144 @@
+#ifndef SIMTHREAD_H_
+#define SIMTHREAD_H_
+
+#include <GameSim.h>
+#include <Replay.h>
+#include <TripleBuffer.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Tank and clock values the display interpolates
+ */
+struct Motion
+{
+	//! Constructor
+	Motion() : tankAngle(0), tankDistanceTravelled(0), timeRemaining(0){};
+
+	Vector3f tankPosition;
+	float tankAngle;
+	float tankDistanceTravelled;
+	float timeRemaining;
+};
+
+/**
+ * World state published after a step, without the maze so publishing does not depend on its size
+ */
+struct Snapshot
+{
+	//! Constructor
+	Snapshot() : removedTargets(0), tick(0), games(0), time(0){};
+
+	//! World after the step besides the maze
+	WorldState state;
+
+	//! Tank and clock at the start of the step, after any restart taken with it, like the balls' previous positions
+	Motion before;
+
+	//! Targets removed from the maze since the last restart
+	size_t removedTargets;
+
+	//! Steps taken and restarts so far
+	long long tick;
+	int games;
+
+	//! Seconds since start when published
+	double time;
+};
+
+/**
+ * Runs a GameSim on its own thread in real time with fixed steps.
+ * Inputs are handed in from the display thread, and every step publishes a snapshot through a triple buffer.
+ * The display interpolates across the latest step, from the state before it to the one after, so frame time and step time
+ * do not affect each other.
+ * Snapshots leave out the maze, the display keeps its own copy and applies the targets removed since it last looked.
+ */
+class SimThread
+{
+
+public:
+
+	//! Constructor
+	SimThread(GameSim & sim, float timeStep);
+
+	//! Destructor, stops thread
+	~SimThread();
+
+	//! Record steps and restarts, set before start
+	void setReplay(Replay * replay);
+
+	//! Start stepping
+	void start();
+
+	//! Stop stepping, the simulation can be used again from the calling thread
+	void stop();
+
+	//! Keys and turret pan used from the next step on
+	void setInputs(const Inputs & inputs);
+
+	//! Fire a ball at the next step
+	void shoot();
+
+	//! Restart game before the next step
+	void restart();
+
+	//! World interpolated for now across the latest step, view keeps its maze between calls and only changes are applied
+	void getView(World & view);
+
+private:
+
+	//! Not copyable
+	SimThread(const SimThread &);
+	void operator=(const SimThread &);
+
+	//! Thread main loop
+	void run();
+
+	//! Publish world after a step, with the tank and clock before it
+	void publish(long long tick, int games, const Motion & before);
+
+	//! Tank and clock of the simulation now
+	Motion getMotion() const;
+
+	//! Seconds since start
+	double now() const;
+
+private:
+
+	//! Simulation, owned by the thread while it runs
+	GameSim & sim;
+	float timeStep;
+	Replay * replay;
+
+	//! Thread
+	std::thread thread;
+	std::atomic<bool> quit;
+	std::chrono::steady_clock::time_point startTime;
+
+	//! Inputs for the next step, guarded by inputMutex
+	std::mutex inputMutex;
+	Inputs inputs;
+	bool shootRequested;
+	bool restartRequested;
+
+	//! Snapshots from thread to display
+	TripleBuffer<Snapshot> snapshots;
+
+	//! Latest snapshot picked up by the display
+	Snapshot current;
+
+	//! Targets removed in the game the thread is on, i*cols+j in order, guarded by mazeMutex and only held to append or restart
+	std::mutex mazeMutex;
+	std::vector<int64_t> removedTargets;
+	int removedGames;
+
+	//! Restart and removed targets the display's maze is at, -1 before its first copy
+	int viewGames;
+	size_t viewRemoved;
+
+};
+
+#endif
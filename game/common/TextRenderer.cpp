@@ -0,0 +1,169 @@
+#include "TextRenderer.h"
+
+#include <GL/glut.h>
+#include <string.h>
+
+// Extent of the Roman stroke font above and below the baseline
+static const float strokeAscent = 119.05f;
+static const float strokeDescent = 33.33f;
+
+//! Constructor
+TextRenderer::TextRenderer(float unitWidth, float unitHeight)
+: unitWidth(unitWidth), unitHeight(unitHeight), atlasScale(cellHeight / (strokeAscent + strokeDescent)), atlas(0), vertexBuffer(0)
+{
+	memset(slots, 0, sizeof(slots));
+	memset(advance, 0, sizeof(advance));
+}
+
+// Draw glyphs and copy them to the atlas
+bool TextRenderer::buildAtlas()
+{
+	int rows = (glyphCount + atlasColumns - 1) / atlasColumns;
+	int width = atlasColumns * cellWidth, height = rows * cellHeight;
+	if(glutGet(GLUT_WINDOW_WIDTH) < width || glutGet(GLUT_WINDOW_HEIGHT) < height) return false;
+
+	// Pixel coordinates with white lines on black
+	glUseProgram(0);
+	glViewport(0, 0, width, height);
+	glMatrixMode(GL_PROJECTION);
+	glLoadIdentity();
+	glOrtho(0, width, 0, height, -1, 1);
+	glMatrixMode(GL_MODELVIEW);
+	glClearColor(0, 0, 0, 0);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glColor3f(1, 1, 1);
+	glLineWidth(3);
+
+	// Glyph origins at the padding and descent of their cell
+	for(int k = 0; k < glyphCount; k++)
+	{
+		advance[k] = (float)glutStrokeWidth(GLUT_STROKE_ROMAN, firstGlyph + k);
+		glLoadIdentity();
+		glTranslatef((float)(k % atlasColumns * cellWidth + cellPadding), k / atlasColumns * cellHeight + strokeDescent * atlasScale, 0);
+		glScalef(atlasScale, atlasScale, 1);
+		glutStrokeCharacter(GLUT_STROKE_ROMAN, firstGlyph + k);
+	}
+
+	// Coverage taken from the red channel, the window may have no alpha
+	glGenTextures(1, &atlas);
+	glBindTexture(GL_TEXTURE_2D, atlas);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, atlasSize, atlasSize, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, NULL);
+	glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	// Back to the state the HUD is drawn with
+	glMatrixMode(GL_PROJECTION);
+	glLoadIdentity();
+	glMatrixMode(GL_MODELVIEW);
+	glLoadIdentity();
+
+	// One range of maxLength characters per slot
+	glGenBuffers(1, &vertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, maxSlots * sizeof(scratch), NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	return true;
+}
+
+// Whether the atlas was built
+bool TextRenderer::hasAtlas() const
+{
+	return atlas != 0;
+}
+
+// Set slot text
+void TextRenderer::setText(int slot, float x, float y, const char * text)
+{
+	Slot & current = slots[slot];
+	if(current.x == x && current.y == y && strncmp(current.text, text, maxLength) == 0) return;
+
+	strncpy(current.text, text, maxLength);
+	current.text[maxLength] = 0;
+	current.x = x;
+	current.y = y;
+	buildSlot(slot);
+}
+
+// Quads of slot
+void TextRenderer::buildSlot(int slot)
+{
+	Slot & current = slots[slot];
+	GLfloat * vertex = scratch;
+	float penX = current.x;
+	float bottom = current.y - strokeDescent * unitHeight, top = current.y + strokeAscent * unitHeight;
+	float padding = cellPadding / atlasScale;
+
+	for(const char * c = current.text; *c; c++)
+	{
+		int glyph = (unsigned char)*c - firstGlyph;
+		if(glyph < 0 || glyph >= glyphCount) glyph = '?' - firstGlyph;
+
+		// Cell of the glyph, from the padding before its origin to the padding after its advance
+		float u0 = (float)(glyph % atlasColumns * cellWidth) / atlasSize;
+		float u1 = u0 + (advance[glyph] * atlasScale + 2 * cellPadding) / atlasSize;
+		float v0 = (float)(glyph / atlasColumns * cellHeight) / atlasSize;
+		float v1 = v0 + (float)cellHeight / atlasSize;
+		float x0 = penX - padding * unitWidth, x1 = penX + (advance[glyph] + padding) * unitWidth;
+
+		GLfloat quad[6 * 4] = {
+			x0, bottom, u0, v0,   x1, bottom, u1, v0,   x1, top, u1, v1,
+			x0, bottom, u0, v0,   x1, top, u1, v1,      x0, top, u0, v1 };
+		memcpy(vertex, quad, sizeof(quad));
+		vertex += 6 * 4;
+		penX += advance[glyph] * unitWidth;
+	}
+
+	current.vertexCount = (vertex - scratch) / 4;
+	if(current.vertexCount == 0) return;
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBufferSubData(GL_ARRAY_BUFFER, slot * sizeof(scratch), current.vertexCount * 4 * sizeof(GLfloat), scratch);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// Draw all slots
+void TextRenderer::draw()
+{
+	// Ranges of the slots with text
+	GLsizei drawCount = 0;
+	for(int k = 0; k < maxSlots; k++)
+	{
+		if(slots[k].vertexCount == 0) continue;
+		firsts[drawCount] = k * maxLength * 6;
+		counts[drawCount] = slots[k].vertexCount;
+		drawCount++;
+	}
+	if(drawCount == 0 || !hasAtlas()) return;
+
+	// Client arrays must not land in a mesh's vertex array object
+	if(GLEW_VERSION_3_0 || GLEW_ARB_vertex_array_object) glBindVertexArray(0);
+
+	// Text lightens what is behind it, on top of everything
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_COLOR);
+	glEnable(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, atlas);
+	glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+	glLoadIdentity();
+
+	const GLsizei stride = 4 * sizeof(GLfloat);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glVertexPointer(2, GL_FLOAT, stride, (void*)0);
+	glTexCoordPointer(2, GL_FLOAT, stride, (void*)(2 * sizeof(GLfloat)));
+
+	glMultiDrawArrays(GL_TRIANGLES, firsts, counts, drawCount);
+
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glDisable(GL_TEXTURE_2D);
+	glDisable(GL_BLEND);
+	glEnable(GL_DEPTH_TEST);
+}
@@ -0,0 +1,78 @@
+#ifndef TEXTRENDERER_H_
+#define TEXTRENDERER_H_
+
+#include <GL/glew.h>
+
+/**
+ * Screen text from a glyph atlas, the GLUT stroke font drawn once into a texture.
+ * Text lives in a fixed number of slots, each with its own range of one vertex buffer that is
+ * only rebuilt when the slot's text or position changes, and all slots are drawn with one call.
+ * Positions are in normalized device coordinates, sizes in stroke font units scaled by unitWidth and unitHeight.
+ */
+class TextRenderer
+{
+
+public:
+
+	//! Slots and characters per slot
+	enum { maxSlots = 8, maxLength = 96 };
+
+	//! Constructor, with the size of a stroke font unit on screen
+	TextRenderer(float unitWidth, float unitHeight);
+
+	//! Draw the glyphs into the back buffer and copy them to the atlas, call before clearing a frame,
+	//! returns false when the window is smaller than the atlas
+	bool buildAtlas();
+
+	//! Whether the atlas was built
+	bool hasAtlas() const;
+
+	//! Set the text of slot with its baseline starting at x, y, an empty text hides the slot
+	void setText(int slot, float x, float y, const char * text);
+
+	//! Draw every slot with text in one call, uses the fixed-function pipeline
+	void draw();
+
+private:
+
+	//! Write the quads of slot into its range of the vertex buffer
+	void buildSlot(int slot);
+
+	//! Characters in the atlas, printable ASCII
+	enum { firstGlyph = 32, glyphCount = 95 };
+
+	//! Atlas layout, cells in pixels at about the size text is shown at
+	enum { cellWidth = 40, cellHeight = 48, cellPadding = 3, atlasColumns = 12, atlasSize = 512 };
+
+	//! Text of a slot as last built
+	struct Slot
+	{
+		char text[maxLength + 1];
+		float x, y;
+		GLsizei vertexCount;
+	};
+
+private:
+
+	//! Stroke unit size on screen and in the atlas
+	float unitWidth, unitHeight;
+	float atlasScale;
+
+	//! Glyph advances in stroke units
+	float advance[glyphCount];
+
+	//! Atlas texture and text vertex buffer
+	GLuint atlas;
+	GLuint vertexBuffer;
+
+	//! Slots, and the vertex ranges of those drawn
+	Slot slots[maxSlots];
+	GLint firsts[maxSlots];
+	GLsizei counts[maxSlots];
+
+	//! Vertices of the slot being built, position and tex coord
+	GLfloat scratch[maxLength * 6 * 4];
+
+};
+
+#endif
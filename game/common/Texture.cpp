@@ -1,5 +1,134 @@
 #include "Texture.h"
 
+#include <Bitmap.h>
+#include <string.h>
+
+
+//! Constructor
+Texture::Texture()
+{
+	image.format = TextureCompressor::RGB;
+	image.width = image.height = 0;
+}
+
+
+/**
+ * Whether the driver takes S3TC (BC1 to BC3) compressed textures
+ */
+bool Texture::isCompressionSupported()
+{
+	return GLEW_EXT_texture_compression_s3tc != 0;
+}
+
+
+/**
+ * Function to read a BMP image as a mip chain without OpenGL.
+ * The BC1 chain is mapped from the .ktx cache while it was built from this image and is of the size wanted,
+ * otherwise the image is decoded, resampled, mipmapped and compressed, and the cache written for next time.
+ */
+bool Texture::prepareBMP(std::string filename, int width, int height, bool compressed)
+{
+	// Size wanted, the image's own unless given, left unknown when only the cache is there
+	if(width <= 0 || height <= 0)
+	{
+		width = height = 0;
+		Bitmap::readSize(filename, width, height);
+	}
+
+	std::string cacheName = TextureCache::getCacheName(filename);
+	if(compressed && !TextureCache::isStale(filename, cacheName) && cache.open(cacheName))
+	{
+		if(width == 0 || (cache.getWidth() == width && cache.getHeight() == height))
+			return true;
+		cache.close();
+	}
+
+	// Source stamped before it is read, so a change while decoding leaves the cache stale
+	std::string source = TextureCache::getSource(filename);
+	Bitmap bitmap;
+	Bitmap::Error error = bitmap.load(filename);
+	if(error != Bitmap::None)
+	{
+		std::cout << "Error loading " << filename << ": " << Bitmap::getErrorString(error) << std::endl;
+		return false;
+	}
+
+	// Resampled when another size is wanted
+	const unsigned char * pixels = (const unsigned char *)bitmap.getPixels();
+	std::vector<unsigned char> resized;
+	if(width != bitmap.getWidth() || height != bitmap.getHeight())
+	{
+		resized.resize((size_t)width * height * 3);
+		TextureCompressor::resample(pixels, bitmap.getWidth(), bitmap.getHeight(), 3, &resized[0], width, height);
+		pixels = &resized[0];
+	}
+
+	// Bitmaps come without alpha, so BC1 holds all of them
+	TextureCompressor::compress(pixels, width, height, 3, compressed ? TextureCompressor::BC1 : TextureCompressor::RGB, image);
+	if(compressed)
+		TextureCache::write(cacheName, source, image);
+	return true;
+}
+
+
+/**
+ * Function to create the texture of the prepared mip chain and release the chain
+ */
+GLuint Texture::upload()
+{
+	GLuint texture = Create(getFormat(), getLevels(), getData());
+	cache.close();
+	std::vector<TextureCompressor::Level>().swap(image.levels);
+	std::vector<unsigned char>().swap(image.data);
+	return texture;
+}
+
+
+// Format of the prepared image
+TextureCompressor::Format Texture::getFormat() const
+{
+	return cache.isOpen() ? cache.getFormat() : image.format;
+}
+
+
+// Width of the prepared image
+int Texture::getWidth() const
+{
+	return cache.isOpen() ? cache.getWidth() : image.width;
+}
+
+
+// Height of the prepared image
+int Texture::getHeight() const
+{
+	return cache.isOpen() ? cache.getHeight() : image.height;
+}
+
+
+// Mip levels of the prepared image
+const std::vector<TextureCompressor::Level> & Texture::getLevels() const
+{
+	return cache.isOpen() ? cache.getLevels() : image.levels;
+}
+
+
+// Data the level offsets are into
+const unsigned char * Texture::getData() const
+{
+	if(cache.isOpen()) return cache.getData();
+	return image.data.empty() ? NULL : &image.data[0];
+}
+
+
+// Bytes of all levels
+size_t Texture::getBytes() const
+{
+	size_t bytes = 0;
+	for(size_t level = 0; level < getLevels().size(); level++)
+		bytes += getLevels()[level].bytes;
+	return bytes;
+}
+
 
 /**
  * Function to load a BMP image passing back width, height and pixel data as char*
@@ -7,71 +136,18 @@
  */  
 bool Texture::LoadBMP(std::string filename, int & width, int & height, char * &data)
 {
-	std::ifstream input;
-	input.open(filename.c_str(), std::ifstream::binary);
-	assert(!input.fail() || !"Could not find file");
-	if(input.fail()) return false;
-
-	char buffer[2];
-	input.read(buffer, 2);
-	assert(buffer[0] == 'B' && buffer[1] == 'M' || !"Not a bitmap file");
-	input.ignore(8);
-	int dataOffset = readInt(input);
-	
-	//Read the header
-	int headerSize = readInt(input);
-	switch(headerSize)
+	Bitmap bitmap;
+	Bitmap::Error error = bitmap.load(filename);
+	if(error != Bitmap::None)
 	{
-		case 40:
-			//V3
-			width = readInt(input);
-			height = readInt(input);
-			input.ignore(2);
-			assert(readShort(input) == 24 || !"Image is not 24 bits per pixel");
-			assert(readShort(input) == 0 || !"Image is compressed");
-			break;
-		case 12:
-			//OS/2 V1
-			width = readShort(input);
-			height = readShort(input);
-			input.ignore(2);
-			assert(readShort(input) == 24 || !"Image is not 24 bits per pixel");
-			break;
-		case 64:
-			//OS/2 V2
-			assert(!"Can't load OS/2 V2 bitmaps");
-			break;
-		case 108:
-			//Windows V4
-			assert(!"Can't load Windows V4 bitmaps");
-			break;
-		case 124:
-			//Windows V5
-			assert(!"Can't load Windows V5 bitmaps");
-			break;
-		default:
-			assert(!"Unknown bitmap format");
+		std::cout << "Error loading " << filename << ": " << Bitmap::getErrorString(error) << std::endl;
+		return false;
 	}
-	
-	//Read the data
-	int bytesPerRow = ((width * 3 + 3) / 4) * 4 - (width * 3 % 4);
-	int size = bytesPerRow * height;
-	auto_array<char> pixels(new char[size]);
-	input.seekg(dataOffset, std::ios_base::beg);
-	input.read(pixels.get(), size);
-	
-	//Get the data into the right format
+
+	width = bitmap.getWidth();
+	height = bitmap.getHeight();
 	data = new char[width * height * 3];
-	for(int y = 0; y < height; y++) {
-		for(int x = 0; x < width; x++) {
-			for(int c = 0; c < 3; c++) {
-				data[3 * (width * y + x) + c] = pixels[bytesPerRow * y + 3 * x + (2 - c)];
-			}
-		}
-	}
-	
-	//Close input stream
-	input.close();
+	memcpy(data, bitmap.getPixels(), width * height * 3);
 	
 	std::cout << "Loaded " << filename << " size " << width << "x" << height << std::endl;
 	return true;
@@ -79,89 +155,68 @@ bool Texture::LoadBMP(std::string filename, int & width, int & height, char * &d
 
 
 /**
- * 
+ * Function to load a BMP image into a mipmapped texture, compressed when supported, returns 0 when it cannot be read
  */ 
 GLuint Texture::LoadBMP(std::string filename)
 {
-	std::ifstream input;
-	input.open(filename.c_str(), std::ifstream::binary);
-	assert(!input.fail() || !"Could not find file");
-	char buffer[2];
-	input.read(buffer, 2);
-	assert(buffer[0] == 'B' && buffer[1] == 'M' || !"Not a bitmap file");
-	input.ignore(8);
-	int dataOffset = readInt(input);
-	
-	//Read the header
-	int headerSize = readInt(input);
-	int width;
-	int height;
-	switch(headerSize)
-	{
-		case 40:
-			//V3
-			width = readInt(input);
-			height = readInt(input);
-			input.ignore(2);
-			assert(readShort(input) == 24 || !"Image is not 24 bits per pixel");
-			assert(readShort(input) == 0 || !"Image is compressed");
-			break;
-		case 12:
-			//OS/2 V1
-			width = readShort(input);
-			height = readShort(input);
-			input.ignore(2);
-			assert(readShort(input) == 24 || !"Image is not 24 bits per pixel");
-			break;
-		case 64:
-			//OS/2 V2
-			assert(!"Can't load OS/2 V2 bitmaps");
-			break;
-		case 108:
-			//Windows V4
-			assert(!"Can't load Windows V4 bitmaps");
-			break;
-		case 124:
-			//Windows V5
-			assert(!"Can't load Windows V5 bitmaps");
-			break;
-		default:
-			assert(!"Unknown bitmap format");
-	}
-	
-	//Read the data
-	int bytesPerRow = ((width * 3 + 3) / 4) * 4 - (width * 3 % 4);
-	int size = bytesPerRow * height;
-	auto_array<char> pixels(new char[size]);
-	input.seekg(dataOffset, std::ios_base::beg);
-	input.read(pixels.get(), size);
-	
-	//Get the data into the right format
-	auto_array<char> pixelData(new char[width * height * 3]);
-	for(int y = 0; y < height; y++) {
-		for(int x = 0; x < width; x++) {
-			for(int c = 0; c < 3; c++) {
-				pixelData[3 * (width * y + x) + c] = pixels[bytesPerRow * y + 3 * x + (2 - c)];
-			}
-		}
-	}
+	Texture image;
+	if(!image.prepareBMP(filename, 0, 0, isCompressionSupported()))
+		return 0;
 	
-	input.close();
+	int width = image.getWidth(), height = image.getHeight();
+	size_t bytes = image.getBytes();
+	GLuint texture = image.upload();
 	
+	std::cout << "Loaded " << filename << " into Texture " <<  texture << " with size " << width << "x" << height << " in " << bytes / 1024 << " KB" << std::endl;
 	
+	return texture;
+}
+
+
+/**
+ * Function to create a texture from RGB pixel data
+ */
+GLuint Texture::Create(int width, int height, const char * data)
+{
 	GLuint texture;
 	glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, pixelData.release());
-	
-	
-	std::cout << "Loaded " << filename << " into Texture " <<  texture << " with size " << width << "x" << height << std::endl;
-	
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+	// Rows of RGB data are not padded
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
 	return texture;
 }
 
 
+/**
+ * Function to create a trilinear filtered texture from mip levels, uncompressed RGB or block-compressed
+ */
+GLuint Texture::Create(TextureCompressor::Format format, const std::vector<TextureCompressor::Level> & levels, const unsigned char * data)
+{
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)levels.size() - 1);
+
+	// Rows of RGB data are not padded
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for(size_t level = 0; level < levels.size(); level++)
+	{
+		const TextureCompressor::Level & current = levels[level];
+		if(format == TextureCompressor::RGB)
+			glTexImage2D(GL_TEXTURE_2D, level, GL_RGB, current.width, current.height, 0, GL_RGB, GL_UNSIGNED_BYTE, data + current.offset);
+		else
+			glCompressedTexImage2D(GL_TEXTURE_2D, level, format, current.width, current.height, 0, current.bytes, data + current.offset);
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	return texture;
+}
@@ -3,6 +3,8 @@
 
 #include <GL/glew.h>
 #include <GL/gl.h>
+#include <TextureCache.h>
+#include <TextureCompressor.h>
 #include <string>
 #include <iostream> 
 #include <assert.h>
@@ -11,46 +13,54 @@
 #include <sstream>
 
 /** 
- *  
+ *  Textures from BMP images, decoded by Bitmap.
+ *  A texture is prepared without OpenGL, on any thread, as a full mip chain that is BC1-compressed where the driver
+ *  supports S3TC and then cached as a .ktx file next to the image, and uploaded level by level afterwards.
  */
 class Texture
 {
 
 public:
+
+    //! Constructor
+    Texture();
+
+    //! Whether the driver takes S3TC compressed textures
+    static bool isCompressionSupported();
+
+    //! Read a BMP image or its cache without OpenGL, resampled to width x height unless they are zero, returns false when it cannot be read
+    bool prepareBMP(std::string filename, int width = 0, int height = 0, bool compressed = true);
+
+    //! Create the OpenGL texture from the prepared mip chain, which is then released
+    GLuint upload();
+
+    //! Format, size and mip levels of the prepared image, level offsets are into getData()
+    TextureCompressor::Format getFormat() const;
+    int getWidth() const;
+    int getHeight() const;
+    const std::vector<TextureCompressor::Level> & getLevels() const;
+    const unsigned char * getData() const;
+
+    //! Bytes of all levels
+    size_t getBytes() const;
+
+    //! Create a texture with mipmaps from levels in a format
+    static GLuint Create(TextureCompressor::Format format, const std::vector<TextureCompressor::Level> & levels, const unsigned char * data);
 	
+    //! Load a BMP image into a texture, returns 0 when it cannot be read
     static GLuint LoadBMP(std::string filename);
     
+    //! Load a BMP image as RGB rows from the bottom into data allocated with new[], returns false when it cannot be read
     static bool LoadBMP(std::string filename, int & width, int & height, char * &data);
-    
-    
-private:    
-	//Converts a four-character array to an integer, using little-endian form
-	static int toInt(const char* bytes) {
-		return (int)(((unsigned char)bytes[3] << 24) |
-					 ((unsigned char)bytes[2] << 16) |
-					 ((unsigned char)bytes[1] << 8) |
-					 (unsigned char)bytes[0]);
-	}
-	
-	//Converts a two-character array to a short, using little-endian form
-	static short toShort(const char* bytes) {
-		return (short)(((unsigned char)bytes[1] << 8) |
-					   (unsigned char)bytes[0]);
-	}
-	
-	//Reads the next four bytes as an integer, using little-endian form
-	static int readInt(std::ifstream &input) {
-		char buffer[4];
-		input.read(buffer, 4);
-		return toInt(buffer);
-	}
-	
-	//Reads the next two bytes as a short, using little-endian form
-	static short readShort(std::ifstream &input) {
-		char buffer[2];
-		input.read(buffer, 2);
-		return toShort(buffer);
-	}
+
+    //! Create a texture from RGB pixels, rows from the bottom
+    static GLuint Create(int width, int height, const char * data);
+
+private:
+
+    //! Mapped cache, or the mip chain built from the image
+    TextureCache cache;
+    TextureCompressor::Image image;
  
 };
 	
@@ -0,0 +1,120 @@
+#include "TextureArray.h"
+
+#include <iostream>
+#include <string.h>
+
+//! Constructor
+TextureArray::TextureArray() : layerCount(0), format(TextureCompressor::RGB), width(0), height(0), texture(0)
+{
+}
+
+// Whether array textures are available
+bool TextureArray::isSupported()
+{
+	return GLEW_VERSION_3_0 || GLEW_EXT_texture_array;
+}
+
+// Add mip chain as next layer
+int TextureArray::add(const Texture & image)
+{
+	const std::vector<TextureCompressor::Level> & imageLevels = image.getLevels();
+	if(layerCount == 0)
+	{
+		format = image.getFormat();
+		width = image.getWidth();
+		height = image.getHeight();
+		size_t offset = 0;
+		levels = imageLevels;
+		for(size_t level = 0; level < levels.size(); level++)
+		{
+			levels[level].offset = offset;
+			offset += levels[level].bytes;
+		}
+	}
+	else if(image.getFormat() != format || image.getWidth() != width || image.getHeight() != height || imageLevels.size() != levels.size())
+	{
+		std::cout << "Error adding layer of " << image.getWidth() << "x" << image.getHeight() << " to texture array of " << width << "x" << height << std::endl;
+		return -1;
+	}
+
+	// Levels packed without whatever lies between them in a cache file
+	std::vector<unsigned char> layer;
+	for(size_t level = 0; level < imageLevels.size(); level++)
+		layer.insert(layer.end(), image.getData() + imageLevels[level].offset, image.getData() + imageLevels[level].offset + imageLevels[level].bytes);
+	layers.push_back(std::vector<unsigned char>());
+	layers.back().swap(layer);
+	return layerCount++;
+}
+
+// Create array texture
+bool TextureArray::build()
+{
+	if(!isSupported() || layers.empty()) return false;
+
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, (GLint)levels.size() - 1);
+
+	// Rows of RGB data are not padded
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	// Each level with all its layers in one go
+	std::vector<unsigned char> data;
+	for(size_t level = 0; level < levels.size(); level++)
+	{
+		const TextureCompressor::Level & current = levels[level];
+		data.resize(current.bytes * layers.size());
+		for(size_t layer = 0; layer < layers.size(); layer++)
+			memcpy(&data[current.bytes * layer], &layers[layer][current.offset], current.bytes);
+
+		if(format == TextureCompressor::RGB)
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGB, current.width, current.height, layers.size(), 0, GL_RGB, GL_UNSIGNED_BYTE, &data[0]);
+		else
+			glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, format, current.width, current.height, layers.size(), 0, data.size(), &data[0]);
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	std::cout << "Built texture array " << texture << " with " << layers.size() << " layers of " << width << "x" << height << " and " << levels.size() << " levels in " << getBytes() / 1024 << " KB" << std::endl;
+
+	// Pixels now live in the texture
+	layers.clear();
+	return true;
+}
+
+// Array texture
+GLuint TextureArray::getTexture() const
+{
+	return texture;
+}
+
+// Number of layers
+int TextureArray::getLayerCount() const
+{
+	return layerCount;
+}
+
+// Layer width
+int TextureArray::getWidth() const
+{
+	return width;
+}
+
+// Layer height
+int TextureArray::getHeight() const
+{
+	return height;
+}
+
+// Bytes of all layers and levels
+size_t TextureArray::getBytes() const
+{
+	size_t bytes = 0;
+	for(size_t level = 0; level < levels.size(); level++)
+		bytes += levels[level].bytes;
+	return bytes * layerCount;
+}
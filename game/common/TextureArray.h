@@ -0,0 +1,60 @@
+#ifndef TEXTUREARRAY_H_
+#define TEXTUREARRAY_H_
+
+#include <GL/glew.h>
+#include <Texture.h>
+#include <TextureCompressor.h>
+#include <string>
+#include <vector>
+
+/**
+ * Mipmapped textures as the layers of one array texture, so draws with different images share a single binding.
+ * Layers all need the size and format of the first one, Texture::prepareBMP resamples images to the size wanted.
+ */
+class TextureArray
+{
+
+public:
+
+	//! Constructor
+	TextureArray();
+
+	//! Whether array textures are available
+	static bool isSupported();
+
+	//! Add the mip chain of a prepared texture as the next layer, returns its layer or -1 when its size or format differs
+	int add(const Texture & image);
+
+	//! Create the array texture from the layers added, returns false without support or layers
+	bool build();
+
+	//! Array texture, zero until built
+	GLuint getTexture() const;
+
+	//! Number of layers
+	int getLayerCount() const;
+
+	//! Layer size
+	int getWidth() const;
+	int getHeight() const;
+
+	//! Bytes of all layers and levels
+	size_t getBytes() const;
+
+private:
+
+	//! Levels of each layer packed one after the other, until built
+	std::vector<std::vector<unsigned char> > layers;
+	int layerCount;
+
+	//! Format, size and levels shared by the layers, level offsets are into a layer
+	TextureCompressor::Format format;
+	int width, height;
+	std::vector<TextureCompressor::Level> levels;
+
+	//! OpenGL texture
+	GLuint texture;
+
+};
+
+#endif
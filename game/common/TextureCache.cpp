@@ -0,0 +1,291 @@
+#include "TextureCache.h"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+// KTX 1.1 file header, 4-byte fields only so there is no padding
+struct KtxHeader
+{
+	unsigned char identifier[12];
+	unsigned int endianness;
+	unsigned int glType, glTypeSize, glFormat;
+	unsigned int glInternalFormat, glBaseInternalFormat;
+	unsigned int pixelWidth, pixelHeight, pixelDepth;
+	unsigned int numberOfArrayElements, numberOfFaces, numberOfMipmapLevels;
+	unsigned int bytesOfKeyValueData;
+};
+
+// File signature and the value the endianness field has in native byte order
+static const unsigned char ktxIdentifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+static const unsigned int ktxEndianness = 0x04030201;
+
+// Base formats of the compressed formats, as OpenGL numbers them
+static const unsigned int baseFormatRGB = 0x1907;
+static const unsigned int baseFormatRGBA = 0x1908;
+
+// Keys holding the encoder version and the source's size and modification time
+static const char versionKey[] = "TankAssignment.encoder";
+static const char sourceKey[] = "TankAssignment.source";
+
+// Bytes to add to a size to reach a multiple of four
+static size_t padding(size_t size)
+{
+	return 3 - (size + 3) % 4;
+}
+
+// One key and its value, the size counts both terminators
+static void appendKeyValue(std::string & keyValue, const char * key, const std::string & value)
+{
+	std::string entry = std::string(key) + '\0' + value + '\0';
+	unsigned int size = entry.size();
+	keyValue.append((const char *)&size, sizeof(size));
+	keyValue.append(entry);
+	keyValue.append(padding(entry.size()), '\0');
+}
+
+// Value of a key among the key-value data, false when it is not there
+static bool findValue(const char * data, size_t bytes, const char * key, std::string & value)
+{
+	size_t position = 0, keySize = strlen(key) + 1;
+	while(position + sizeof(unsigned int) <= bytes)
+	{
+		unsigned int size;
+		memcpy(&size, data + position, sizeof(size));
+		position += sizeof(size);
+		if(size > bytes - position) return false;
+
+		// Value runs to its terminator
+		if(size > keySize && memcmp(data + position, key, keySize) == 0 && data[position + size - 1] == '\0')
+		{
+			value.assign(data + position + keySize, size - keySize - 1);
+			return true;
+		}
+		position += size + padding(size);
+	}
+	return false;
+}
+
+//! Constructor
+TextureCache::TextureCache() : format(TextureCompressor::BC1), width(0), height(0)
+{
+}
+
+// Cache file for a source file
+std::string TextureCache::getCacheName(std::string source)
+{
+	size_t dot = source.find_last_of('.');
+	size_t slash = source.find_last_of("/\\");
+	if(dot == std::string::npos || (slash != std::string::npos && dot < slash)) return source + ".ktx";
+	return source.substr(0, dot) + ".ktx";
+}
+
+// Size and modification time of a file
+std::string TextureCache::getSource(std::string filename)
+{
+	struct stat info;
+	if(stat(filename.c_str(), &info) != 0) return "";
+
+#ifdef __APPLE__
+	long nanoseconds = info.st_mtimespec.tv_nsec;
+#else
+	long nanoseconds = info.st_mtim.tv_nsec;
+#endif
+	std::ostringstream source;
+	source << (long long)info.st_size << ' ' << (long long)info.st_mtime << '.' << std::setw(9) << std::setfill('0') << nanoseconds;
+	return source.str();
+}
+
+// Whether cache is missing or built from another source
+bool TextureCache::isStale(std::string source, std::string cache)
+{
+	// Only the header and keys are read, open checks the rest
+	KtxHeader header;
+	std::ifstream in(cache.c_str(), std::ios::binary);
+	if(!in.read((char *)&header, sizeof(header))) return true;
+	// Keys are a few dozen bytes, more is not a cache this wrote
+	if(memcmp(header.identifier, ktxIdentifier, sizeof(ktxIdentifier)) != 0 || header.endianness != ktxEndianness ||
+		header.bytesOfKeyValueData == 0 || header.bytesOfKeyValueData > 4096)
+		return true;
+	std::vector<char> keyValue(header.bytesOfKeyValueData);
+	std::string stamp;
+	if(!in.read(&keyValue[0], keyValue.size()) || !findValue(&keyValue[0], keyValue.size(), sourceKey, stamp)) return true;
+
+	// A cache without its source is all there is
+	std::string current = getSource(source);
+	if(current.empty()) return false;
+
+	// Equal rather than older, a source copied or restored with an earlier time is still another source
+	return stamp != current;
+}
+
+// Write cache file
+bool TextureCache::write(std::string filename, const std::string & source, const TextureCompressor::Image & image)
+{
+	if(image.format != TextureCompressor::BC1 && image.format != TextureCompressor::BC3) return false;
+
+	// Encoder version and source stamp
+	std::ostringstream value;
+	value << version;
+	std::string keyValue;
+	appendKeyValue(keyValue, versionKey, value.str());
+	appendKeyValue(keyValue, sourceKey, source);
+
+	KtxHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.identifier, ktxIdentifier, sizeof(ktxIdentifier));
+	header.endianness = ktxEndianness;
+	header.glTypeSize = 1;
+	header.glInternalFormat = image.format;
+	header.glBaseInternalFormat = image.format == TextureCompressor::BC3 ? baseFormatRGBA : baseFormatRGB;
+	header.pixelWidth = image.width;
+	header.pixelHeight = image.height;
+	header.numberOfFaces = 1;
+	header.numberOfMipmapLevels = image.levels.size();
+	header.bytesOfKeyValueData = keyValue.size();
+
+	std::ofstream out(filename.c_str(), std::ios::binary | std::ios::trunc);
+	if(!out)
+	{
+		std::cout << "Error writing " << filename << std::endl;
+		return false;
+	}
+
+	out.write((const char *)&header, sizeof(header));
+	out.write(keyValue.data(), keyValue.size());
+
+	// Blocks are 8 or 16 bytes so levels need no padding
+	for(size_t level = 0; level < image.levels.size(); level++)
+	{
+		unsigned int imageSize = image.levels[level].bytes;
+		out.write((const char *)&imageSize, sizeof(imageSize));
+		out.write((const char *)&image.data[image.levels[level].offset], imageSize);
+	}
+	out.close();
+
+	// A partial file would only be rejected on the next load
+	if(!out)
+	{
+		std::cout << "Error writing " << filename << std::endl;
+		remove(filename.c_str());
+		return false;
+	}
+	return true;
+}
+
+// Map cache file
+bool TextureCache::open(std::string filename)
+{
+	levels.clear();
+	if(!file.open(filename, true) || file.getSize() < sizeof(KtxHeader)) return false;
+	KtxHeader header;
+	memcpy(&header, file.getData(), sizeof(header));
+
+	// Another container or byte order
+	if(memcmp(header.identifier, ktxIdentifier, sizeof(ktxIdentifier)) != 0 || header.endianness != ktxEndianness)
+	{
+		std::cout << "Error in " << filename << ": not a KTX file in native byte order" << std::endl;
+		file.close();
+		return false;
+	}
+
+	// Encoder version among the keys, files without it are from elsewhere or older
+	std::ostringstream expected;
+	expected << version;
+	std::string found;
+	size_t position = sizeof(KtxHeader), keyValueEnd = position + header.bytesOfKeyValueData;
+	if(keyValueEnd > file.getSize())
+	{
+		std::cout << "Error in " << filename << ": malformed texture cache" << std::endl;
+		file.close();
+		return false;
+	}
+	if(!findValue(file.getData() + position, header.bytesOfKeyValueData, versionKey, found) || found != expected.str())
+	{
+		file.close();
+		return false;
+	}
+
+	// Only 2D BC1 or BC3 textures with their whole mip chain
+	bool valid = (header.glInternalFormat == TextureCompressor::BC1 || header.glInternalFormat == TextureCompressor::BC3) &&
+		header.glType == 0 && header.glFormat == 0 && header.pixelWidth > 0 && header.pixelHeight > 0 && header.pixelDepth == 0 &&
+		header.numberOfArrayElements == 0 && header.numberOfFaces == 1 && header.pixelWidth <= 32768 && header.pixelHeight <= 32768 &&
+		header.numberOfMipmapLevels == (unsigned int)TextureCompressor::getLevelCount(header.pixelWidth, header.pixelHeight);
+	format = (TextureCompressor::Format)header.glInternalFormat;
+	width = header.pixelWidth;
+	height = header.pixelHeight;
+
+	// Level sizes that match the format and add up to the file
+	position = keyValueEnd;
+	for(unsigned int level = 0; valid && level < header.numberOfMipmapLevels; level++)
+	{
+		TextureCompressor::Level current;
+		current.width = width >> level > 0 ? width >> level : 1;
+		current.height = height >> level > 0 ? height >> level : 1;
+		current.offset = position + sizeof(unsigned int);
+		current.bytes = TextureCompressor::getLevelBytes(format, current.width, current.height);
+
+		unsigned int imageSize = 0;
+		valid = current.offset + current.bytes <= file.getSize();
+		if(valid) memcpy(&imageSize, file.getData() + position, sizeof(imageSize));
+		valid = valid && imageSize == current.bytes;
+		levels.push_back(current);
+		position = current.offset + current.bytes + padding(current.bytes);
+	}
+	if(!valid || position != file.getSize())
+	{
+		std::cout << "Error in " << filename << ": malformed texture cache" << std::endl;
+		levels.clear();
+		file.close();
+		return false;
+	}
+	return true;
+}
+
+// Unmap cache file
+void TextureCache::close()
+{
+	levels.clear();
+	file.close();
+}
+
+// Whether a cache file is mapped
+bool TextureCache::isOpen() const
+{
+	return file.getData() != NULL;
+}
+
+// Format of open cache
+TextureCompressor::Format TextureCache::getFormat() const
+{
+	return format;
+}
+
+// Width of open cache
+int TextureCache::getWidth() const
+{
+	return width;
+}
+
+// Height of open cache
+int TextureCache::getHeight() const
+{
+	return height;
+}
+
+// Levels of open cache
+const std::vector<TextureCompressor::Level> & TextureCache::getLevels() const
+{
+	return levels;
+}
+
+// Start of mapping, level offsets are from here
+const unsigned char * TextureCache::getData() const
+{
+	return (const unsigned char *)file.getData();
+}
@@ -0,0 +1,70 @@
+#ifndef TEXTURECACHE_H_
+#define TEXTURECACHE_H_
+
+#include <MappedFile.h>
+#include <TextureCompressor.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+/**
+ * Block-compressed mip chains saved as KTX 1.1 files next to their source image and memory-mapped back,
+ * so every level can be handed to OpenGL straight from the mapping.
+ * Only BC1 and BC3 2D textures with a full mip chain are written or read, in native byte order, and a key tags
+ * files with the encoder version so they are rebuilt when the way textures are compressed changes.
+ * Another key records the size and modification time of the source image, and the cache is stale as soon as either differs.
+ */
+class TextureCache
+{
+
+public:
+
+	//! Encoder version, bumped whenever mip chains or blocks are built differently
+	enum { version = 1 };
+
+	//! Constructor
+	TextureCache();
+
+	//! Cache file for a source file, its name with the extension replaced by .ktx
+	static std::string getCacheName(std::string source);
+
+	//! Size and modification time of a file as the cache stores them, to the nanosecond where the system keeps it, empty when it cannot be read
+	static std::string getSource(std::string filename);
+
+	//! Whether the cache is missing or was built from a source of another size or modification time
+	static bool isStale(std::string source, std::string cache);
+
+	//! Write a BC1 or BC3 image built from a source stamped by getSource, returns false on failure
+	static bool write(std::string filename, const std::string & source, const TextureCompressor::Image & image);
+
+	//! Map a cache file, returns false when it is missing, of another version or malformed
+	bool open(std::string filename);
+
+	//! Unmap the cache file
+	void close();
+
+	//! Whether a cache file is mapped
+	bool isOpen() const;
+
+	//! Format and size of the open cache
+	TextureCompressor::Format getFormat() const;
+	int getWidth() const;
+	int getHeight() const;
+
+	//! Levels, their offsets are into the data inside the mapping, valid while the cache is open
+	const std::vector<TextureCompressor::Level> & getLevels() const;
+	const unsigned char * getData() const;
+
+private:
+
+	//! Mapped file
+	MappedFile file;
+
+	//! Format, size and levels read from the header
+	TextureCompressor::Format format;
+	int width, height;
+	std::vector<TextureCompressor::Level> levels;
+
+};
+
+#endif
@@ -0,0 +1,448 @@
+#include "TextureCompressor.h"
+
+#include <string.h>
+
+// Pack colour to 5:6:5 bits, rounding to nearest
+static unsigned int pack565(const float * colour)
+{
+	int bits[3] = { 31, 63, 31 };
+	int packed[3];
+	for(int c = 0; c < 3; c++)
+	{
+		float value = colour[c] < 0 ? 0 : (colour[c] > 255 ? 255 : colour[c]);
+		packed[c] = (int)(value * bits[c] / 255 + 0.5f);
+	}
+	return (packed[0] << 11) | (packed[1] << 5) | packed[2];
+}
+
+// Expand 5:6:5 bits to 8 bits per channel
+static void unpack565(unsigned int packed, int * colour)
+{
+	int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+	colour[0] = (r << 3) | (r >> 2);
+	colour[1] = (g << 2) | (g >> 4);
+	colour[2] = (b << 3) | (b >> 2);
+}
+
+// Pixels of the 4x4 block at block column bx and row by as RGBA, repeating the last row and column past the edge
+static void fetchBlock(const unsigned char * pixels, int width, int height, int channels, int bx, int by, unsigned char block[16][4])
+{
+	for(int y = 0; y < 4; y++)
+	{
+		int sy = 4 * by + y < height ? 4 * by + y : height - 1;
+		for(int x = 0; x < 4; x++)
+		{
+			int sx = 4 * bx + x < width ? 4 * bx + x : width - 1;
+			const unsigned char * pixel = pixels + ((size_t)sy * width + sx) * channels;
+			unsigned char * target = block[4 * y + x];
+			target[0] = pixel[0];
+			target[1] = pixel[1];
+			target[2] = pixel[2];
+			target[3] = channels == 4 ? pixel[3] : 255;
+		}
+	}
+}
+
+// Pick the nearest of the four colours between two endpoints for each pixel, returns the squared error
+static int chooseIndices(const unsigned char block[16][4], unsigned int colour0, unsigned int colour1, unsigned int & indices)
+{
+	int palette[4][3];
+	unpack565(colour0, palette[0]);
+	unpack565(colour1, palette[1]);
+	for(int c = 0; c < 3; c++)
+	{
+		palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+		palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+	}
+
+	int error = 0;
+	indices = 0;
+	for(int i = 0; i < 16; i++)
+	{
+		int best = 0, bestDistance = 0x7fffffff;
+		for(int k = 0; k < 4; k++)
+		{
+			int dr = block[i][0] - palette[k][0], dg = block[i][1] - palette[k][1], db = block[i][2] - palette[k][2];
+			int distance = dr * dr + dg * dg + db * db;
+			if(distance < bestDistance)
+			{
+				bestDistance = distance;
+				best = k;
+			}
+		}
+		indices |= best << (2 * i);
+		error += bestDistance;
+	}
+	return error;
+}
+
+// Endpoints fitting pixels with their chosen indices best in the least squares sense, returns false when they cannot be solved for
+static bool refineEndpoints(const unsigned char block[16][4], unsigned int indices, float * colour0, float * colour1)
+{
+	// Weight of the first endpoint for each index
+	static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+	float aa = 0, ab = 0, bb = 0, ax[3] = { 0, 0, 0 }, bx[3] = { 0, 0, 0 };
+	for(int i = 0; i < 16; i++)
+	{
+		float a = weights[(indices >> (2 * i)) & 3], b = 1 - a;
+		aa += a * a;
+		ab += a * b;
+		bb += b * b;
+		for(int c = 0; c < 3; c++)
+		{
+			ax[c] += a * block[i][c];
+			bx[c] += b * block[i][c];
+		}
+	}
+
+	float determinant = aa * bb - ab * ab;
+	if(determinant < 1e-6f && determinant > -1e-6f) return false;
+	for(int c = 0; c < 3; c++)
+	{
+		colour0[c] = (bb * ax[c] - ab * bx[c]) / determinant;
+		colour1[c] = (aa * bx[c] - ab * ax[c]) / determinant;
+	}
+	return true;
+}
+
+// Encode the colours of a block as two 5:6:5 endpoints and sixteen 2-bit indices, always in four-colour mode
+static void encodeColourBlock(const unsigned char block[16][4], unsigned char * out)
+{
+	// Mean and covariance of the colours
+	float mean[3] = { 0, 0, 0 };
+	for(int i = 0; i < 16; i++)
+		for(int c = 0; c < 3; c++)
+			mean[c] += block[i][c];
+	for(int c = 0; c < 3; c++) mean[c] /= 16;
+
+	float covariance[6] = { 0, 0, 0, 0, 0, 0 };
+	for(int i = 0; i < 16; i++)
+	{
+		float r = block[i][0] - mean[0], g = block[i][1] - mean[1], b = block[i][2] - mean[2];
+		covariance[0] += r * r;
+		covariance[1] += r * g;
+		covariance[2] += r * b;
+		covariance[3] += g * g;
+		covariance[4] += g * b;
+		covariance[5] += b * b;
+	}
+
+	// Principal axis by power iteration, the colours spread along it the most
+	float axis[3] = { 1, 1, 1 };
+	for(int iteration = 0; iteration < 8; iteration++)
+	{
+		float next[3] = {
+			covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+			covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+			covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2] };
+		float largest = next[0] > next[1] ? next[0] : next[1];
+		if(next[2] > largest) largest = next[2];
+		float smallest = next[0] < next[1] ? next[0] : next[1];
+		if(next[2] < smallest) smallest = next[2];
+		if(-smallest > largest) largest = -smallest;
+		if(largest <= 0) break;
+		for(int c = 0; c < 3; c++) axis[c] = next[c] / largest;
+	}
+
+	// Pixels furthest apart along the axis as endpoints
+	int low = 0, high = 0;
+	float lowest = 1e30f, highest = -1e30f;
+	for(int i = 0; i < 16; i++)
+	{
+		float projection = block[i][0] * axis[0] + block[i][1] * axis[1] + block[i][2] * axis[2];
+		if(projection < lowest)
+		{
+			lowest = projection;
+			low = i;
+		}
+		if(projection > highest)
+		{
+			highest = projection;
+			high = i;
+		}
+	}
+	float colour0[3] = { (float)block[high][0], (float)block[high][1], (float)block[high][2] };
+	float colour1[3] = { (float)block[low][0], (float)block[low][1], (float)block[low][2] };
+	unsigned int packed0 = pack565(colour0), packed1 = pack565(colour1), indices;
+	int error = chooseIndices(block, packed0, packed1, indices);
+
+	// One least squares refinement, kept when it is better
+	if(error > 0 && refineEndpoints(block, indices, colour0, colour1))
+	{
+		unsigned int refined0 = pack565(colour0), refined1 = pack565(colour1), refinedIndices;
+		if(chooseIndices(block, refined0, refined1, refinedIndices) < error)
+		{
+			packed0 = refined0;
+			packed1 = refined1;
+			indices = refinedIndices;
+		}
+	}
+
+	// Four-colour mode needs the first endpoint larger, swapping them swaps indices 0 and 1 and 2 and 3
+	if(packed0 < packed1)
+	{
+		unsigned int swap = packed0;
+		packed0 = packed1;
+		packed1 = swap;
+		indices ^= 0x55555555;
+	}
+	else if(packed0 == packed1) indices = 0;
+
+	out[0] = packed0 & 0xff;
+	out[1] = packed0 >> 8;
+	out[2] = packed1 & 0xff;
+	out[3] = packed1 >> 8;
+	for(int k = 0; k < 4; k++) out[4 + k] = (indices >> (8 * k)) & 0xff;
+}
+
+// Eight alphas between two endpoints, interpolated in sevenths
+static void alphaPalette(int alpha0, int alpha1, int * palette)
+{
+	palette[0] = alpha0;
+	palette[1] = alpha1;
+	for(int k = 1; k < 7; k++) palette[k + 1] = ((7 - k) * alpha0 + k * alpha1 + 3) / 7;
+}
+
+// Encode the alphas of a block as their largest and smallest value and sixteen 3-bit indices
+static void encodeAlphaBlock(const unsigned char block[16][4], unsigned char * out)
+{
+	int alpha0 = 0, alpha1 = 255;
+	for(int i = 0; i < 16; i++)
+	{
+		if(block[i][3] > alpha0) alpha0 = block[i][3];
+		if(block[i][3] < alpha1) alpha1 = block[i][3];
+	}
+	memset(out, 0, 8);
+	out[0] = alpha0;
+	out[1] = alpha1;
+	if(alpha0 == alpha1) return;
+
+	int palette[8];
+	alphaPalette(alpha0, alpha1, palette);
+	unsigned long long indices = 0;
+	for(int i = 0; i < 16; i++)
+	{
+		int best = 0, bestDistance = 256;
+		for(int k = 0; k < 8; k++)
+		{
+			int distance = block[i][3] > palette[k] ? block[i][3] - palette[k] : palette[k] - block[i][3];
+			if(distance < bestDistance)
+			{
+				bestDistance = distance;
+				best = k;
+			}
+		}
+		indices |= (unsigned long long)best << (3 * i);
+	}
+	for(int k = 0; k < 6; k++) out[2 + k] = (indices >> (8 * k)) & 0xff;
+}
+
+// Decode the colours of a block, in three-colour mode with black when the first endpoint is not larger
+static void decodeColourBlock(const unsigned char * in, unsigned char block[16][4])
+{
+	unsigned int packed0 = in[0] | (in[1] << 8), packed1 = in[2] | (in[3] << 8);
+	unsigned int indices = in[4] | (in[5] << 8) | (in[6] << 16) | ((unsigned int)in[7] << 24);
+	int palette[4][4];
+	unpack565(packed0, palette[0]);
+	unpack565(packed1, palette[1]);
+	for(int c = 0; c < 3; c++)
+	{
+		if(packed0 > packed1)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		else
+		{
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+	}
+	palette[0][3] = palette[1][3] = palette[2][3] = 255;
+	palette[3][3] = packed0 > packed1 ? 255 : 0;
+
+	for(int i = 0; i < 16; i++)
+		for(int c = 0; c < 4; c++)
+			block[i][c] = palette[(indices >> (2 * i)) & 3][c];
+}
+
+// Decode the alphas of a block
+static void decodeAlphaBlock(const unsigned char * in, unsigned char block[16][4])
+{
+	int palette[8];
+	if(in[0] > in[1]) alphaPalette(in[0], in[1], palette);
+	else
+	{
+		// Six interpolated alphas, then fully transparent and opaque
+		palette[0] = in[0];
+		palette[1] = in[1];
+		for(int k = 1; k < 5; k++) palette[k + 1] = ((5 - k) * in[0] + k * in[1] + 2) / 5;
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+
+	unsigned long long indices = 0;
+	for(int k = 0; k < 6; k++) indices |= (unsigned long long)in[2 + k] << (8 * k);
+	for(int i = 0; i < 16; i++)
+		block[i][3] = palette[(indices >> (3 * i)) & 7];
+}
+
+// Build mip chain in format
+void TextureCompressor::compress(const unsigned char * pixels, int width, int height, int channels, Format format, Image & image)
+{
+	image.format = format;
+	image.width = width;
+	image.height = height;
+
+	// Level sizes and where they start
+	int levelCount = getLevelCount(width, height);
+	image.levels.resize(levelCount);
+	size_t offset = 0;
+	for(int level = 0; level < levelCount; level++)
+	{
+		Level & current = image.levels[level];
+		current.width = width >> level > 0 ? width >> level : 1;
+		current.height = height >> level > 0 ? height >> level : 1;
+		current.offset = offset;
+		current.bytes = getLevelBytes(format, current.width, current.height);
+		offset += current.bytes;
+	}
+	image.data.resize(offset);
+
+	// Each level from the one above
+	std::vector<unsigned char> source(pixels, pixels + (size_t)width * height * channels), halved;
+	for(int level = 0; level < levelCount; level++)
+	{
+		const Level & current = image.levels[level];
+		unsigned char * target = &image.data[current.offset];
+		if(format == BC1) encodeBC1(&source[0], current.width, current.height, channels, target);
+		else if(format == BC3) encodeBC3(&source[0], current.width, current.height, channels, target);
+		else
+		{
+			for(size_t i = 0; i < (size_t)current.width * current.height; i++)
+				memcpy(target + 3 * i, &source[channels * i], 3);
+		}
+
+		if(level + 1 < levelCount)
+		{
+			halved.resize((size_t)image.levels[level + 1].width * image.levels[level + 1].height * channels);
+			downsample(&source[0], current.width, current.height, channels, &halved[0]);
+			source.swap(halved);
+		}
+	}
+}
+
+// Levels in full mip chain
+int TextureCompressor::getLevelCount(int width, int height)
+{
+	int levels = 1;
+	for(int size = width > height ? width : height; size > 1; size >>= 1)
+		levels++;
+	return levels;
+}
+
+// Bytes of level
+size_t TextureCompressor::getLevelBytes(Format format, int width, int height)
+{
+	size_t blocks = (size_t)((width + 3) / 4) * ((height + 3) / 4);
+	if(format == BC1) return blocks * 8;
+	if(format == BC3) return blocks * 16;
+	return (size_t)width * height * 3;
+}
+
+// Halve with box filter
+void TextureCompressor::downsample(const unsigned char * source, int width, int height, int channels, unsigned char * target)
+{
+	int targetWidth = width / 2 > 0 ? width / 2 : 1, targetHeight = height / 2 > 0 ? height / 2 : 1;
+	for(int y = 0; y < targetHeight; y++)
+	{
+		const unsigned char * row0 = source + (size_t)(2 * y) * width * channels;
+		const unsigned char * row1 = 2 * y + 1 < height ? row0 + (size_t)width * channels : row0;
+		for(int x = 0; x < targetWidth; x++)
+		{
+			int x0 = 2 * x * channels, x1 = 2 * x + 1 < width ? x0 + channels : x0;
+			for(int c = 0; c < channels; c++)
+				*target++ = (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4;
+		}
+	}
+}
+
+// Bilinear resample
+void TextureCompressor::resample(const unsigned char * source, int sourceWidth, int sourceHeight, int channels, unsigned char * target, int targetWidth, int targetHeight)
+{
+	for(int y = 0; y < targetHeight; y++)
+	{
+		// Source row pair and weight, sampling at pixel centres
+		float sy = (y + 0.5f) * sourceHeight / targetHeight - 0.5f;
+		if(sy < 0) sy = 0;
+		int y0 = (int)sy, y1 = y0 + 1 < sourceHeight ? y0 + 1 : y0;
+		float fy = sy - y0;
+
+		for(int x = 0; x < targetWidth; x++)
+		{
+			float sx = (x + 0.5f) * sourceWidth / targetWidth - 0.5f;
+			if(sx < 0) sx = 0;
+			int x0 = (int)sx, x1 = x0 + 1 < sourceWidth ? x0 + 1 : x0;
+			float fx = sx - x0;
+
+			const unsigned char * p00 = source + channels * (y0 * sourceWidth + x0);
+			const unsigned char * p01 = source + channels * (y0 * sourceWidth + x1);
+			const unsigned char * p10 = source + channels * (y1 * sourceWidth + x0);
+			const unsigned char * p11 = source + channels * (y1 * sourceWidth + x1);
+			for(int c = 0; c < channels; c++)
+			{
+				float top = p00[c] + (p01[c] - p00[c]) * fx;
+				float bottom = p10[c] + (p11[c] - p10[c]) * fx;
+				target[channels * (y * targetWidth + x) + c] = (unsigned char)(top + (bottom - top) * fy + 0.5f);
+			}
+		}
+	}
+}
+
+// Encode as BC1
+void TextureCompressor::encodeBC1(const unsigned char * pixels, int width, int height, int channels, unsigned char * blocks)
+{
+	unsigned char block[16][4];
+	for(int by = 0; by < (height + 3) / 4; by++)
+		for(int bx = 0; bx < (width + 3) / 4; bx++, blocks += 8)
+		{
+			fetchBlock(pixels, width, height, channels, bx, by, block);
+			encodeColourBlock(block, blocks);
+		}
+}
+
+// Encode as BC3
+void TextureCompressor::encodeBC3(const unsigned char * pixels, int width, int height, int channels, unsigned char * blocks)
+{
+	unsigned char block[16][4];
+	for(int by = 0; by < (height + 3) / 4; by++)
+		for(int bx = 0; bx < (width + 3) / 4; bx++, blocks += 16)
+		{
+			fetchBlock(pixels, width, height, channels, bx, by, block);
+			encodeAlphaBlock(block, blocks);
+			encodeColourBlock(block, blocks + 8);
+		}
+}
+
+// Decode blocks to RGBA
+void TextureCompressor::decode(Format format, const unsigned char * blocks, int width, int height, unsigned char * pixels)
+{
+	int blockBytes = format == BC3 ? 16 : 8;
+	unsigned char block[16][4];
+	for(int by = 0; by < (height + 3) / 4; by++)
+		for(int bx = 0; bx < (width + 3) / 4; bx++, blocks += blockBytes)
+		{
+			if(format == BC3)
+			{
+				decodeColourBlock(blocks + 8, block);
+				decodeAlphaBlock(blocks, block);
+			}
+			else decodeColourBlock(blocks, block);
+
+			// Only the pixels inside the image
+			for(int y = 0; y < 4 && 4 * by + y < height; y++)
+				for(int x = 0; x < 4 && 4 * bx + x < width; x++)
+					memcpy(pixels + 4 * ((size_t)(4 * by + y) * width + 4 * bx + x), block[4 * y + x], 4);
+		}
+}
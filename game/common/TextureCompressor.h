@@ -0,0 +1,60 @@
+#ifndef TEXTURECOMPRESSOR_H_
+#define TEXTURECOMPRESSOR_H_
+
+#include <stddef.h>
+#include <vector>
+
+/**
+ * Mip chains and BC1/BC3 block compression of RGB or RGBA images, independent of OpenGL.
+ * Each level is a 2x2 box filter of the one above down to 1x1, and compressed levels are encoded block by block
+ * with endpoints along the principal axis of the block's colours, refined once by least squares.
+ */
+class TextureCompressor
+{
+
+public:
+
+	//! Pixel formats, with the values OpenGL uses for them as internal formats
+	enum Format { RGB = 0x1907, BC1 = 0x83F0, BC3 = 0x83F3 };
+
+	//! One mip level inside an image's data
+	struct Level
+	{
+		int width, height;
+		size_t offset, bytes;
+	};
+
+	//! Mip chain from the full size down to 1x1, levels packed one after the other, RGB rows without padding
+	struct Image
+	{
+		Format format;
+		int width, height;
+		std::vector<Level> levels;
+		std::vector<unsigned char> data;
+	};
+
+	//! Build the mip chain of RGB (3 channels) or RGBA (4 channels) pixels in the given format
+	static void compress(const unsigned char * pixels, int width, int height, int channels, Format format, Image & image);
+
+	//! Number of levels in a full mip chain
+	static int getLevelCount(int width, int height);
+
+	//! Bytes of a level in a format
+	static size_t getLevelBytes(Format format, int width, int height);
+
+	//! Halve an image with a 2x2 box filter, odd sizes repeat their last row or column
+	static void downsample(const unsigned char * source, int width, int height, int channels, unsigned char * target);
+
+	//! Bilinear resample of an image
+	static void resample(const unsigned char * source, int sourceWidth, int sourceHeight, int channels, unsigned char * target, int targetWidth, int targetHeight);
+
+	//! Encode pixels as BC1 blocks of 8 bytes, or as BC3 blocks of 16 bytes with alpha, edge blocks repeat their last pixels
+	static void encodeBC1(const unsigned char * pixels, int width, int height, int channels, unsigned char * blocks);
+	static void encodeBC3(const unsigned char * pixels, int width, int height, int channels, unsigned char * blocks);
+
+	//! Decode BC1 or BC3 blocks to RGBA pixels
+	static void decode(Format format, const unsigned char * blocks, int width, int height, unsigned char * pixels);
+
+};
+
+#endif
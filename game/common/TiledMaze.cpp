@@ -0,0 +1,613 @@
+#include "TiledMaze.h"
+#include "MappedFile.h"
+#include "MazeGrid.h"
+
+#include <algorithm>
+#include <bitset>
+#include <chrono>
+#include <iostream>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// Tile file header, followed by tiles in row-major order
+static const char tileMagic[4] = { 'T', 'M', 'Z', '2' };
+static const int64_t tileHeaderSize = 4 + 3 * 4 + 8 + 8;
+
+// FNV-1a of 64-bit words
+static uint64_t hashWords(uint64_t h, const uint64_t * words, size_t count)
+{
+	for(size_t k = 0; k < count; k++)
+		h = (h ^ words[k]) * 1099511628211ULL;
+	return h;
+}
+
+//! Constructor
+TiledMaze::TiledMaze()
+: rows(0), cols(0), tileSize(0), tilesX(0), tilesY(0), totalTargets(0), checksum(0), dataOffset(tileHeaderSize),
+  budget(0), followCenter(-1), followRadius(0), followReady(false), lastTile(NULL), quit(false), hitches(0), stallSeconds(0)
+{
+}
+
+//! Destructor
+TiledMaze::~TiledMaze()
+{
+	close();
+}
+
+// Convert a maze text file to a tile file
+bool TiledMaze::convert(std::string mazeFile, std::string tileFile, int tileSize)
+{
+	if(tileSize <= 0 || tileSize % 64 != 0)
+	{
+		std::cout << "Error: tile size " << tileSize << " is not a multiple of 64" << std::endl;
+		return false;
+	}
+
+	MappedFile text;
+	if(!text.open(mazeFile))
+	{
+		std::cout << "Error opening " << mazeFile << std::endl;
+		return false;
+	}
+
+	// Find lines, trailing whitespace and carriage returns are not part of a row
+	const char * data = text.getData();
+	const char * end = data + text.getSize();
+	std::vector<size_t> lineStart, lineLength;
+	size_t lastRow = 0;
+	for(const char * line = data; line && line < end; )
+	{
+		const char * newline = (const char *)memchr(line, '\n', end - line);
+		const char * lineEnd = newline ? newline : end;
+		while(lineEnd > line && (lineEnd[-1] == '\r' || lineEnd[-1] == ' ' || lineEnd[-1] == '\t')) lineEnd--;
+
+		lineStart.push_back(line - data);
+		lineLength.push_back(lineEnd - line);
+		if(lineEnd > line) lastRow = lineStart.size();
+		line = newline ? newline + 1 : NULL;
+	}
+
+	int rows = (int)lastRow;
+	int cols = rows > 0 ? (int)lineLength[0] : 0;
+	if(rows == 0 || cols == 0)
+	{
+		std::cout << "Error in " << mazeFile << ": maze is empty" << std::endl;
+		return false;
+	}
+
+	std::ofstream out(tileFile.c_str(), std::ios::binary);
+	if(!out)
+	{
+		std::cout << "Error creating " << tileFile << std::endl;
+		return false;
+	}
+
+	// Header, target count and checksum are filled in at the end
+	int32_t header[3] = { rows, cols, tileSize };
+	int64_t targetCount = 0;
+	uint64_t checksum = 14695981039346656037ULL;
+	out.write(tileMagic, 4);
+	out.write((const char *)header, sizeof(header));
+	out.write((const char *)&targetCount, sizeof(targetCount));
+	out.write((const char *)&checksum, sizeof(checksum));
+
+	// One band of tile rows at a time
+	int tilesX = (cols + tileSize - 1) / tileSize;
+	int tilesY = (rows + tileSize - 1) / tileSize;
+	int tileStride = tileSize / 64;
+	int bandStride = tilesX * tileStride;
+	std::vector<uint64_t> bandBlocks((size_t)tileSize * bandStride), bandTargets((size_t)tileSize * bandStride);
+	std::vector<uint64_t> tile((size_t)tileSize * tileStride);
+
+	const int maxReports = 10;
+	int errors = 0;
+	for(int ty = 0; ty < tilesY; ty++)
+	{
+		std::fill(bandBlocks.begin(), bandBlocks.end(), 0);
+		std::fill(bandTargets.begin(), bandTargets.end(), 0);
+
+		// Decode rows of band
+		for(int r = 0; r < tileSize; r++)
+		{
+			int i = ty * tileSize + r;
+			if(i >= rows) break;
+
+			int column = -1;
+			if((int)lineLength[i] == cols)
+				column = MazeGrid::decodeRow(data + lineStart[i], cols, &bandBlocks[(size_t)r * bandStride], &bandTargets[(size_t)r * bandStride]);
+			if((int)lineLength[i] == cols && column < 0)
+			{
+				for(int k = 0; k < bandStride; k++)
+					targetCount += std::bitset<64>(bandTargets[(size_t)r * bandStride + k]).count();
+				continue;
+			}
+
+			if(errors++ >= maxReports)
+				continue;
+			if((int)lineLength[i] != cols)
+				std::cout << "Error in " << mazeFile << " row " << i + 1 << ": " << lineLength[i] << " cells, expected " << cols << std::endl;
+			else
+				std::cout << "Error in " << mazeFile << " row " << i + 1 << " column " << column + 1 << ": '" << data[lineStart[i] + column] << "' is not 0, 1 or 2" << std::endl;
+		}
+
+		// Write tiles of band, block plane then target plane
+		for(int tx = 0; tx < tilesX; tx++)
+		{
+			const std::vector<uint64_t> * planes[2] = { &bandBlocks, &bandTargets };
+			for(int p = 0; p < 2; p++)
+			{
+				for(int r = 0; r < tileSize; r++)
+					memcpy(&tile[(size_t)r * tileStride], &(*planes[p])[(size_t)r * bandStride + tx * tileStride], tileStride * sizeof(uint64_t));
+				out.write((const char *)&tile[0], tile.size() * sizeof(uint64_t));
+				checksum = hashWords(checksum, &tile[0], tile.size());
+			}
+		}
+	}
+
+	if(errors > 0)
+	{
+		if(errors > maxReports) std::cout << "Error in " << mazeFile << ": " << errors << " malformed rows" << std::endl;
+		out.close();
+		remove(tileFile.c_str());
+		return false;
+	}
+
+	// Fill in target count and checksum
+	out.seekp(4 + sizeof(header));
+	out.write((const char *)&targetCount, sizeof(targetCount));
+	out.write((const char *)&checksum, sizeof(checksum));
+	return out.good();
+}
+
+// Open tile file and start loader thread
+bool TiledMaze::open(std::string tileFile, int budget)
+{
+	close();
+
+	file.open(tileFile.c_str(), std::ios::binary);
+	if(!file)
+	{
+		std::cout << "Error opening " << tileFile << std::endl;
+		return false;
+	}
+
+	// Read header
+	char magic[4];
+	int32_t header[3];
+	file.read(magic, 4);
+	file.read((char *)header, sizeof(header));
+	file.read((char *)&totalTargets, sizeof(totalTargets));
+	file.read((char *)&checksum, sizeof(checksum));
+	if(!file || memcmp(magic, tileMagic, 4) != 0 || header[0] <= 0 || header[1] <= 0 || header[2] <= 0 || header[2] % 64 != 0)
+	{
+		std::cout << "Error in " << tileFile << ": not a tile file" << std::endl;
+		file.close();
+		return false;
+	}
+
+	// Every tile has to be there, a short file would fail reads later
+	int64_t expectedTilesX = (header[1] + header[2] - 1) / header[2];
+	int64_t expectedTilesY = (header[0] + header[2] - 1) / header[2];
+	int64_t expectedSize = tileHeaderSize + expectedTilesX * expectedTilesY * 2 * header[2] * header[2] / 8;
+	file.seekg(0, std::ios::end);
+	int64_t size = (int64_t)file.tellg();
+	if(size != expectedSize)
+	{
+		std::cout << "Error in " << tileFile << ": " << size << " bytes, expected " << expectedSize << std::endl;
+		file.close();
+		return false;
+	}
+
+	filename = tileFile;
+	rows = header[0];
+	cols = header[1];
+	tileSize = header[2];
+	tilesX = (int)expectedTilesX;
+	tilesY = (int)expectedTilesY;
+	this->budget = budget;
+	hitches = 0;
+	stallSeconds = 0;
+
+	// Start loader
+	quit = false;
+	loader = std::thread(&TiledMaze::loaderLoop, this);
+	return true;
+}
+
+// Stop loader thread and release tiles
+void TiledMaze::close()
+{
+	if(loader.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			quit = true;
+		}
+		wake.notify_all();
+		loader.join();
+	}
+
+	// Release tiles
+	for(std::unordered_map<int64_t, Slot>::iterator it = resident.begin(); it != resident.end(); ++it)
+		delete it->second.tile;
+	for(size_t k = 0; k < loaded.size(); k++)
+		delete loaded[k];
+	resident.clear();
+	order.clear();
+	followReady = false;
+	loaded.clear();
+	requests.clear();
+	pending.clear();
+	failed.clear();
+	removed.clear();
+	lastTile = NULL;
+
+	if(file.is_open()) file.close();
+	rows = cols = tileSize = tilesX = tilesY = 0;
+	totalTargets = 0;
+	checksum = 0;
+}
+
+// Number of rows
+int TiledMaze::getRows() const
+{
+	return rows;
+}
+
+// Number of columns
+int TiledMaze::getCols() const
+{
+	return cols;
+}
+
+// Number of targets in file
+int64_t TiledMaze::getTotalTargets() const
+{
+	return totalTargets;
+}
+
+// Checksum of tile data
+uint64_t TiledMaze::getChecksum() const
+{
+	return checksum;
+}
+
+// Removed targets
+const std::unordered_set<int64_t> & TiledMaze::getRemovedTargets() const
+{
+	return removed;
+}
+
+// Checking for blocks
+bool TiledMaze::isBlock(int i, int j)
+{
+	Tile * tile = tileFor(i, j);
+	if(!tile) return false;
+
+	int r = i % tileSize, c = j % tileSize;
+	return (tile->blocks[(size_t)r * (tileSize / 64) + (c >> 6)] >> (c & 63)) & 1;
+}
+
+// Checking for targets
+bool TiledMaze::isTarget(int i, int j)
+{
+	Tile * tile = tileFor(i, j);
+	if(!tile) return false;
+
+	int r = i % tileSize, c = j % tileSize;
+	if(!((tile->targets[(size_t)r * (tileSize / 64) + (c >> 6)] >> (c & 63)) & 1)) return false;
+
+	// Tiles keep the file contents, removed targets are remembered separately
+	return removed.empty() || removed.count((int64_t)i * cols + j) == 0;
+}
+
+// Removing target
+bool TiledMaze::removeTarget(int i, int j)
+{
+	if(!isTarget(i, j)) return false;
+
+	removed.insert((int64_t)i * cols + j);
+	return true;
+}
+
+// Restore all removed targets
+void TiledMaze::resetTargets()
+{
+	removed.clear();
+}
+
+// Make tiles around position resident
+void TiledMaze::follow(Vector3f position, float cellSize, int radius)
+{
+	// Nothing changes while the tank stays in a tile whose neighbours are all resident
+	int64_t center = centerTile(position, cellSize);
+	if(followReady && center == followCenter && radius == followRadius) return;
+	followCenter = center;
+	followRadius = radius;
+
+	collectLoaded();
+
+	// Wanted tiles become most recently used, missing ones are requested
+	std::vector<int64_t> wanted;
+	tilesAround(position, cellSize, radius, wanted);
+	bool requested = false;
+	followReady = true;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for(size_t k = 0; k < wanted.size(); k++)
+		{
+			std::unordered_map<int64_t, Slot>::iterator it = resident.find(wanted[k]);
+			if(it != resident.end())
+			{
+				order.splice(order.begin(), order, it->second.order);
+				continue;
+			}
+
+			// Tiles that could not be read are not asked for again and do not keep follow scanning
+			if(failed.count(wanted[k])) continue;
+			followReady = false;
+			if(pending.insert(wanted[k]).second)
+			{
+				requests.push_back(wanted[k]);
+				requested = true;
+			}
+		}
+	}
+	if(requested) wake.notify_one();
+
+	evict(wanted);
+}
+
+// Load tiles around position and wait for them
+bool TiledMaze::preload(Vector3f position, float cellSize, int radius)
+{
+	follow(position, cellSize, radius);
+
+	std::vector<int64_t> wanted;
+	tilesAround(position, cellSize, radius, wanted);
+	for(;;)
+	{
+		collectLoaded();
+
+		bool ready = true;
+		for(size_t k = 0; k < wanted.size() && ready; k++)
+			ready = resident.count(wanted[k]) != 0;
+		if(ready) return true;
+
+		// Wait for the next tile, or give up on one the loader could not read
+		std::unique_lock<std::mutex> lock(mutex);
+		int64_t missing = -1;
+		done.wait(lock, [this, &wanted, &missing]
+		{
+			for(size_t k = 0; k < wanted.size() && missing < 0; k++)
+				if(failed.count(wanted[k])) missing = wanted[k];
+			return missing >= 0 || !loaded.empty();
+		});
+		if(missing >= 0)
+		{
+			reportFailed(missing);
+			return false;
+		}
+	}
+}
+
+// Number of queries that found their tile not ready
+int TiledMaze::getHitches() const
+{
+	return hitches;
+}
+
+// Total time spent waiting for tiles in hitches
+double TiledMaze::getStallSeconds() const
+{
+	return stallSeconds;
+}
+
+// Number of resident tiles
+int TiledMaze::getResidentCount() const
+{
+	return (int)resident.size();
+}
+
+// Tile holding cell
+TiledMaze::Tile * TiledMaze::tileFor(int i, int j)
+{
+	// Bound checking
+	if(i < 0 || i > rows - 1) return NULL;
+	if(j < 0 || j > cols - 1) return NULL;
+
+	int64_t id = (int64_t)(i / tileSize) * tilesX + j / tileSize;
+	if(lastTile && lastTile->id == id) return lastTile;
+
+	std::unordered_map<int64_t, Slot>::iterator it = resident.find(id);
+	if(it == resident.end())
+	{
+		// The loader may have finished it already
+		collectLoaded();
+		it = resident.find(id);
+	}
+
+	if(it == resident.end())
+	{
+		// Tiles that could not be read are open cells, without reading them again
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if(failed.count(id)) return NULL;
+		}
+
+		// Hitch, read tile on this thread
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		Tile * tile = new Tile;
+		bool read = readTile(file, id, tile);
+		if(read)
+		{
+			makeResident(tile);
+
+			// Stay within budget, follow requests evicted neighbours again
+			if(resident.size() > (size_t)budget)
+			{
+				evict(std::vector<int64_t>(1, id));
+				followReady = false;
+			}
+		}
+		else delete tile;
+		std::chrono::duration<double> stall = std::chrono::steady_clock::now() - start;
+
+		hitches++;
+		stallSeconds += stall.count();
+		if(!read)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			failed.insert(std::make_pair(id, false));
+			reportFailed(id);
+			return NULL;
+		}
+		std::cout << "Hitch: tile " << id % tilesX << "," << id / tilesX << " not ready, loaded in " << stall.count() * 1000 << " ms" << std::endl;
+		it = resident.find(id);
+	}
+
+	lastTile = it->second.tile;
+	return lastTile;
+}
+
+// Read tile from file
+bool TiledMaze::readTile(std::ifstream & input, int64_t id, Tile * tile)
+{
+	size_t words = (size_t)tileSize * tileSize / 64;
+	tile->id = id;
+	tile->blocks.resize(words);
+	tile->targets.resize(words);
+
+	input.clear();
+	input.seekg(dataOffset + id * (int64_t)(2 * words * sizeof(uint64_t)));
+	input.read((char *)&tile->blocks[0], words * sizeof(uint64_t));
+	input.read((char *)&tile->targets[0], words * sizeof(uint64_t));
+	return input.good();
+}
+
+// Report unreadable tile once
+void TiledMaze::reportFailed(int64_t id)
+{
+	std::unordered_map<int64_t, bool>::iterator it = failed.find(id);
+	if(it == failed.end() || it->second) return;
+	it->second = true;
+	std::cout << "Error in " << filename << ": tile " << id % tilesX << "," << id / tilesX << " could not be read, its cells stay open" << std::endl;
+}
+
+// Move finished tiles from the loader into the resident set
+void TiledMaze::collectLoaded()
+{
+	std::vector<Tile *> finished;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		finished.swap(loaded);
+		for(size_t k = 0; k < finished.size(); k++)
+			pending.erase(finished[k]->id);
+	}
+
+	for(size_t k = 0; k < finished.size(); k++)
+		makeResident(finished[k]);
+}
+
+// Add tile to resident set
+void TiledMaze::makeResident(Tile * tile)
+{
+	if(resident.count(tile->id))
+	{
+		delete tile;
+		return;
+	}
+
+	order.push_front(tile->id);
+	Slot slot;
+	slot.tile = tile;
+	slot.order = order.begin();
+	resident[tile->id] = slot;
+}
+
+// Evict least recently used tiles over budget
+void TiledMaze::evict(const std::vector<int64_t> & wanted)
+{
+	// Budget never drops below the wanted set
+	size_t limit = (size_t)budget > wanted.size() ? (size_t)budget : wanted.size();
+	while(resident.size() > limit)
+	{
+		int64_t id = order.back();
+		std::unordered_map<int64_t, Slot>::iterator it = resident.find(id);
+		if(lastTile == it->second.tile) lastTile = NULL;
+		delete it->second.tile;
+		resident.erase(it);
+		order.pop_back();
+	}
+}
+
+// Tile holding position, clamped to the maze
+int64_t TiledMaze::centerTile(Vector3f position, float cellSize) const
+{
+	if(tileSize == 0) return -1;
+
+	// Clamped so tiles at the edge stay loaded while the tank is off the maze
+	float ti = floorf((position.z / cellSize + 0.5f) / tileSize);
+	float tj = floorf((position.x / cellSize + 0.5f) / tileSize);
+	int y = ti < 0 ? 0 : ti > tilesY - 1 ? tilesY - 1 : (int)ti;
+	int x = tj < 0 ? 0 : tj > tilesX - 1 ? tilesX - 1 : (int)tj;
+	return (int64_t)y * tilesX + x;
+}
+
+// Tiles within radius tiles of position
+void TiledMaze::tilesAround(Vector3f position, float cellSize, int radius, std::vector<int64_t> & ids) const
+{
+	ids.clear();
+	if(tileSize == 0) return;
+
+	int64_t center = centerTile(position, cellSize);
+	int centerY = (int)(center / tilesX);
+	int centerX = (int)(center % tilesX);
+
+	for(int y = centerY - radius; y <= centerY + radius; y++)
+	for(int x = centerX - radius; x <= centerX + radius; x++)
+	{
+		if(y < 0 || y > tilesY - 1 || x < 0 || x > tilesX - 1) continue;
+		ids.push_back((int64_t)y * tilesX + x);
+	}
+}
+
+// Loader thread main loop
+void TiledMaze::loaderLoop()
+{
+	std::ifstream input(filename.c_str(), std::ios::binary);
+
+	for(;;)
+	{
+		// Wait for a request
+		int64_t id;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this]{ return quit || !requests.empty(); });
+			if(quit) break;
+			id = requests.front();
+			requests.pop_front();
+		}
+
+		// Read outside the lock
+		Tile * tile = new Tile;
+		if(!readTile(input, id, tile))
+		{
+			delete tile;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				pending.erase(id);
+				failed.insert(std::make_pair(id, false));
+			}
+			done.notify_all();
+			continue;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			loaded.push_back(tile);
+		}
+		done.notify_all();
+	}
+}
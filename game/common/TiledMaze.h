@@ -0,0 +1,184 @@
+#ifndef TILEDMAZE_H_
+#define TILEDMAZE_H_
+
+#include <Vector.h>
+#include <stdint.h>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * Maze streamed from a tile file, only tiles near the tank are resident.
+ * Tiles are square, tileSize cells a side, stored as block and target bitplanes.
+ * Queries and follow() run on the simulation thread, a loader thread reads requested tiles.
+ */
+class TiledMaze
+{
+
+public:
+
+	//! Constructor
+	TiledMaze();
+
+	//! Destructor, stops loader thread
+	~TiledMaze();
+
+	//! Convert a maze text file to a tile file one band of tile rows at a time, tileSize is a multiple of 64
+	static bool convert(std::string mazeFile, std::string tileFile, int tileSize);
+
+	//! Open tile file and start loader thread, at most budget tiles stay resident
+	bool open(std::string tileFile, int budget);
+
+	//! Stop loader thread and release tiles
+	void close();
+
+	//! Number of rows
+	int getRows() const;
+
+	//! Number of columns
+	int getCols() const;
+
+	//! Number of targets in file
+	int64_t getTotalTargets() const;
+
+	//! FNV-1a of the tile data written by convert, identifies the layout without reading the tiles
+	uint64_t getChecksum() const;
+
+	//! Targets removed by the game, as i * cols + j
+	const std::unordered_set<int64_t> & getRemovedTargets() const;
+
+	//! Checking for blocks, a tile that is not ready is loaded synchronously and reported as a hitch
+	bool isBlock(int i, int j);
+
+	//! Checking for targets, same loading as isBlock
+	bool isTarget(int i, int j);
+
+	//! Removing target, remembered across eviction
+	bool removeTarget(int i, int j);
+
+	//! Restore all removed targets
+	void resetTargets();
+
+	//! Make tiles within radius tiles of position resident, cells spaced cellSize apart
+	void follow(Vector3f position, float cellSize, int radius);
+
+	//! Load tiles within radius tiles of position and wait for them, no hitches reported, returns false when one cannot be read
+	bool preload(Vector3f position, float cellSize, int radius);
+
+	//! Number of queries that found their tile not ready
+	int getHitches() const;
+
+	//! Total time spent waiting for tiles in hitches
+	double getStallSeconds() const;
+
+	//! Number of resident tiles
+	int getResidentCount() const;
+
+private:
+
+	//! Tile bitplanes
+	struct Tile
+	{
+		int64_t id;
+		std::vector<uint64_t> blocks;
+		std::vector<uint64_t> targets;
+	};
+
+	//! Resident tile and its place in the LRU order
+	struct Slot
+	{
+		Tile * tile;
+		std::list<int64_t>::iterator order;
+	};
+
+private:
+
+	//! Not copyable
+	TiledMaze(const TiledMaze &);
+	void operator=(const TiledMaze &);
+
+	//! Tile holding cell, NULL when out of range or the tile cannot be read
+	Tile * tileFor(int i, int j);
+
+	//! Read tile from file
+	bool readTile(std::ifstream & file, int64_t id, Tile * tile);
+
+	//! Print that a tile could not be read, once per tile, called with mutex held
+	void reportFailed(int64_t id);
+
+	//! Move finished tiles from the loader into the resident set
+	void collectLoaded();
+
+	//! Add tile to resident set, frees it when already resident
+	void makeResident(Tile * tile);
+
+	//! Evict least recently used tiles over budget, keeping wanted ones
+	void evict(const std::vector<int64_t> & wanted);
+
+	//! Tile holding position, clamped to the maze
+	int64_t centerTile(Vector3f position, float cellSize) const;
+
+	//! Tiles within radius tiles of position
+	void tilesAround(Vector3f position, float cellSize, int radius, std::vector<int64_t> & ids) const;
+
+	//! Loader thread main loop
+	void loaderLoop();
+
+private:
+
+	//! Tile file and dimensions
+	std::string filename;
+	int rows, cols, tileSize;
+	int tilesX, tilesY;
+	int64_t totalTargets;
+	uint64_t checksum;
+	int64_t dataOffset;
+
+	//! File used for synchronous loads
+	std::ifstream file;
+
+	//! Resident tiles, LRU order with most recent at front
+	std::unordered_map<int64_t, Slot> resident;
+	std::list<int64_t> order;
+	int budget;
+
+	//! Tile and radius of the last follow, while all its tiles are resident follow has nothing to do
+	int64_t followCenter;
+	int followRadius;
+	bool followReady;
+
+	//! Last tile looked up
+	Tile * lastTile;
+
+	//! Targets removed by the game
+	std::unordered_set<int64_t> removed;
+
+	//! Tiles requested from the loader and not collected yet
+	std::unordered_set<int64_t> pending;
+
+	//! Tiles that could not be read and whether that was reported, never read again
+	std::unordered_map<int64_t, bool> failed;
+
+	//! Loader thread state, guarded by mutex
+	std::thread loader;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	std::deque<int64_t> requests;
+	std::vector<Tile *> loaded;
+	bool quit;
+
+	//! Hitch statistics
+	int hitches;
+	double stallSeconds;
+
+};
+
+#endif
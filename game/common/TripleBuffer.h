@@ -0,0 +1,63 @@
+#ifndef TRIPLEBUFFER_H_
+#define TRIPLEBUFFER_H_
+
+#include <atomic>
+
+/**
+ * Lock-free triple buffer between one writer and one reader thread.
+ * The writer fills its buffer and publishes it, the reader picks up the latest published buffer.
+ * Neither side ever waits, and the reader's buffer is never touched while it reads it.
+ */
+template<class T>
+class TripleBuffer
+{
+
+public:
+
+	//! Constructor
+	TripleBuffer() : writeIndex(0), readIndex(2), shared(1){};
+
+	//! Buffer owned by the writer
+	T & getWriteBuffer()
+	{
+		return buffers[writeIndex];
+	}
+
+	//! Hand the write buffer to the reader, the writer continues with the previously shared one
+	void publish()
+	{
+		writeIndex = shared.exchange(writeIndex | fresh, std::memory_order_acq_rel) & indexMask;
+	}
+
+	//! Pick up the latest published buffer, returns false when nothing new was published
+	bool update()
+	{
+		if(!(shared.load(std::memory_order_relaxed) & fresh)) return false;
+		readIndex = shared.exchange(readIndex, std::memory_order_acq_rel) & indexMask;
+		return true;
+	}
+
+	//! Buffer owned by the reader
+	const T & getReadBuffer() const
+	{
+		return buffers[readIndex];
+	}
+
+private:
+
+	//! Shared word is the index of the shared buffer plus a flag set when it is newer than the reader's
+	enum { indexMask = 3, fresh = 4 };
+
+	//! Buffers
+	T buffers[3];
+
+	//! Buffer indices owned by each side
+	int writeIndex;
+	int readIndex;
+
+	//! Buffer in between
+	std::atomic<int> shared;
+
+};
+
+#endif
@@ -0,0 +1,48 @@
+TEMPLATE = lib
+
+#Library Name
+TARGET = GameSim
+CONFIG = staticlib debug c++11 thread
+
+#Destination
+DESTDIR = .
+OBJECTS_DIR = ./build/
+
+HEADERS	+= 	../common/Vector.h		        \
+		../common/MappedFile.h		        \
+		../common/MazeGrid.h		        \
+		../common/ProjectilePool.h		        \
+		../common/TiledMaze.h		        \
+		../common/GameSim.h		        \
+		../common/BatchSim.h		        \
+		../common/Replay.h		        \
+		../common/TripleBuffer.h		        \
+		../common/SimThread.h		        \
+		../common/MazeMesher.h		        \
+		../common/ObjParser.h		        \
+		../common/AssetLoader.h		        \
+		../common/Bitmap.h		        \
+		../common/TextureCompressor.h		        \
+		../common/TextureCache.h		        \
+
+#Sources
+SOURCES += 	../common/Vector.cpp		    \
+		../common/MappedFile.cpp		    \
+		../common/MazeGrid.cpp		    \
+		../common/ProjectilePool.cpp		    \
+		../common/TiledMaze.cpp		    \
+		../common/GameSim.cpp		    \
+		../common/BatchSim.cpp		    \
+		../common/BatchSimAVX2.cpp	    \
+		../common/Replay.cpp		    \
+		../common/SimThread.cpp		    \
+		../common/MazeMesher.cpp		    \
+		../common/ObjParser.cpp		    \
+		../common/AssetLoader.cpp		    \
+		../common/Bitmap.cpp		    \
+		../common/TextureCompressor.cpp		    \
+		../common/TextureCache.cpp		    \
+
+INCLUDEPATH += 	../common/ 			\
+
+DEFINES += M_PI=3.141592653589793
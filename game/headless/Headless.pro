@@ -0,0 +1,20 @@
+TEMPLATE = app
+
+#Executable Name
+TARGET = Headless
+CONFIG = console debug c++11 thread
+
+#Destination
+DESTDIR = .
+OBJECTS_DIR = ./build/
+
+#Sources
+SOURCES += 	main.cpp			        \
+
+INCLUDEPATH += 	./ 				    \
+		        ../common/ 			\
+
+DEFINES += M_PI=3.141592653589793
+
+#Simulation Library
+LIBS += -L../game_sim/ -lGameSim
@@ -0,0 +1,617 @@
+// Includes
+#include <GameSim.h>
+#include <Replay.h>
+#include <BatchSim.h>
+#include <Bitmap.h>
+#include <MazeMesher.h>
+#include <ObjParser.h>
+#include <TextureCache.h>
+#include <TextureCompressor.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <math.h>
+#include <stdlib.h>
+#include <string>
+#include <string.h>
+#include <sstream>
+#include <vector>
+
+// Fixed simulation step, same as the GLUT front end
+const float timeStep = 0.01f;
+
+// Scripted input generator, switches keys every few hundred ticks
+class InputScript
+{
+
+public:
+
+	//! Constructor
+	InputScript(unsigned int seed) : state(seed), ticksLeft(0){};
+
+	//! Inputs for next tick
+	Inputs next()
+	{
+		if(ticksLeft-- <= 0)
+		{
+			unsigned int r = random();
+			inputs.accelerate = (r & 3) != 0;
+			inputs.decelerate = (r & 3) == 0;
+			inputs.turnLeft = (r & 12) == 4;
+			inputs.turnRight = (r & 12) == 8;
+			inputs.turretPan = (float)((r >> 8) & 1023) / 1023.0f * 2 * (float)M_PI;
+			ticksLeft = 50 + (int)((r >> 20) & 255);
+		}
+
+		// Fire roughly once a second
+		Inputs result = inputs;
+		result.shoot = (random() & 127) == 0;
+		return result;
+	}
+
+private:
+
+	//! Linear congruential generator
+	unsigned int random()
+	{
+		state = state * 1664525u + 1013904223u;
+		return state >> 8;
+	}
+
+	unsigned int state;
+	int ticksLeft;
+	Inputs inputs;
+};
+
+// Run many worlds in a BatchSim, returns world steps per second
+double runBatch(BatchSim & sim, std::vector<InputScript> & scripts, int ticks)
+{
+	int worldCount = sim.getWorldCount();
+	sim.restart();
+
+	double seconds = 0;
+	for(int tick = 0; tick < ticks; tick++)
+	{
+		// Restart finished games and set inputs, outside of timing
+		for(int w = 0; w < worldCount; w++)
+		{
+			if(sim.gameOver[w]) sim.restart(w);
+			sim.setInputs(w, scripts[w].next());
+		}
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		sim.step(timeStep);
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		seconds += elapsed.count();
+	}
+
+	return seconds > 0 ? (double)worldCount * ticks / seconds : 0;
+}
+
+// Batch benchmark, scalar against SIMD kernel
+int batchMain(int worldCount, int ticks, std::string mazeFile)
+{
+	BatchSim sim(worldCount);
+	if(!sim.loadMaze(mazeFile))
+		return -1;
+
+	// Same scripted inputs for both runs
+	std::vector<InputScript> scalarScripts, simdScripts;
+	for(int w = 0; w < worldCount; w++)
+		scalarScripts.push_back(InputScript(12345 + w));
+	simdScripts = scalarScripts;
+
+	sim.setSIMD(false);
+	double scalar = runBatch(sim, scalarScripts, ticks);
+	std::cout << "Worlds: " << worldCount << ", ticks: " << ticks << "\n"
+	          << "Scalar worlds per second: " << scalar << std::endl;
+
+	if(!sim.setSIMD(true))
+	{
+		std::cout << "AVX2 not supported" << std::endl;
+		return 0;
+	}
+	double simd = runBatch(sim, simdScripts, ticks);
+	std::cout << "AVX2 worlds per second: " << simd << "\n"
+	          << "Speedup: " << (scalar > 0 ? simd / scalar : 0) << std::endl;
+
+	return 0;
+}
+
+// Run games for a number of ticks, restarting whenever a game ends, and report
+void runGames(GameSim & sim, long long ticks, Replay * replay = NULL)
+{
+	InputScript script(12345);
+	long long games = 0, coins = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for(long long tick = 0; tick < ticks; tick++)
+	{
+		Inputs inputs = script.next();
+		if(replay) replay->recordStep(inputs);
+		sim.step(inputs, timeStep);
+
+		World & world = sim.getWorld();
+		if(world.gameOver)
+		{
+			coins += world.collectedCoins;
+			games++;
+			sim.restart();
+			if(replay) replay->recordRestart();
+		}
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	// Report
+	std::cout << "Ticks: " << ticks << "\n"
+	          << "Games: " << games << "\n"
+	          << "Coins: " << coins << "\n"
+	          << "Seconds: " << elapsed.count() << "\n"
+	          << "Ticks per second: " << (elapsed.count() > 0 ? ticks / elapsed.count() : 0) << std::endl;
+}
+
+// Run games on a maze streamed from a tile file
+int tiledMain(std::string tileFile, long long ticks, int budget)
+{
+	GameSim sim;
+	if(!sim.loadTiledMaze(tileFile, budget))
+		return -1;
+	sim.restart();
+
+	TiledMaze & maze = *sim.getTiledMaze();
+	std::cout << "Maze: " << maze.getRows() << "x" << maze.getCols() << " streamed, budget " << budget << " tiles" << std::endl;
+
+	runGames(sim, ticks);
+	std::cout << "Resident tiles: " << maze.getResidentCount() << "\n"
+	          << "Hitches: " << maze.getHitches() << "\n"
+	          << "Stall seconds: " << maze.getStallSeconds() << std::endl;
+
+	return 0;
+}
+
+// Record scripted games to a replay file
+int recordMain(std::string replayFile, long long ticks, std::string mazeFile)
+{
+	GameSim sim;
+	if(!sim.loadMaze(mazeFile))
+		return -1;
+	sim.restart();
+
+	Replay replay;
+	replay.begin(sim, timeStep);
+	runGames(sim, ticks, &replay);
+	replay.finish(sim);
+	if(!replay.save(replayFile))
+		return -1;
+
+	std::cout << "Final state: " << std::hex << replay.getFinalHash() << std::dec << std::endl;
+	return 0;
+}
+
+// Play back a replay file as fast as possible and check the final state
+int replayMain(std::string replayFile, std::string mazeFile)
+{
+	Replay replay;
+	if(!replay.load(replayFile))
+		return -1;
+
+	GameSim sim;
+	if(!sim.loadMaze(mazeFile))
+		return -1;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	bool match = replay.play(sim);
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	// Report
+	uint64_t ticks = replay.getTickCount();
+	std::cout << "Ticks: " << ticks << "\n"
+	          << "Seconds: " << elapsed.count() << "\n"
+	          << "Ticks per second: " << (elapsed.count() > 0 ? ticks / elapsed.count() : 0) << "\n"
+	          << "Final state: " << std::hex << Replay::hashState(sim) << std::dec
+	          << (match ? " matches" : " does not match") << " recording" << std::endl;
+
+	return match ? 0 : 1;
+}
+
+// Bake the maze blocks into chunk meshes and time a rebuild after an edit
+int meshMain(std::string mazeFile)
+{
+	MazeGrid maze;
+	if(!maze.loadFromFile(mazeFile))
+		return -1;
+
+	// One cube of 12 triangles per block before baking
+	long long blocks = 0;
+	for(int i = 0; i < maze.getRows(); i++)
+	for(int j = 0; j < maze.getCols(); j++)
+		if(maze.isBlock(i, j)) blocks++;
+
+	MazeMesher mesher(cubeSize);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	mesher.update(maze);
+	std::chrono::duration<double> bakeTime = std::chrono::steady_clock::now() - start;
+
+	int chunkCount = mesher.getChunkRows() * mesher.getChunkCols(), drawnChunks = 0;
+	for(int k = 0; k < chunkCount; k++)
+		if(!mesher.getChunk(k).indices.empty()) drawnChunks++;
+
+	std::cout << "Maze: " << maze.getRows() << "x" << maze.getCols() << ", " << blocks << " blocks\n"
+	          << "Cube triangles: " << blocks * 12 << " in " << blocks << " draws\n"
+	          << "Baked triangles: " << mesher.getTriangleCount() << " in " << drawnChunks << " chunks\n"
+	          << "Bake seconds: " << bakeTime.count() << std::endl;
+
+	// Flip the middle cell and flip it back, each rebuilds only the chunks around it
+	int i = maze.getRows() / 2, j = maze.getCols() / 2;
+	int type = maze.isTarget(i, j) ? 2 : maze.isBlock(i, j) ? 1 : 0;
+	for(int n = 0; n < 2; n++)
+	{
+		maze.setCell(i, j, n == 0 ? (type == 0 ? 1 : 0) : type);
+		start = std::chrono::steady_clock::now();
+		int rebuilt = mesher.update(maze);
+		std::chrono::duration<double> editTime = std::chrono::steady_clock::now() - start;
+		std::cout << "Edit " << n + 1 << ": " << rebuilt << " chunks rebuilt in " << editTime.count() << " s, "
+		          << mesher.getTriangleCount() << " triangles" << std::endl;
+	}
+
+	return 0;
+}
+
+// Face of the reference OBJ parser
+struct LegacyFace
+{
+	std::vector<unsigned int> position_index;
+	std::vector<unsigned int> normal_index;
+	std::vector<unsigned int> texturecoord_index;
+};
+
+// Reference OBJ parser, the getline and stringstream loop Mesh::loadOBJ used before, returns faces read
+size_t legacyParseOBJ(std::string filename)
+{
+	std::vector<Vector3f> positions, normals;
+	std::vector<Vector2f> texcoords;
+	std::vector<LegacyFace> faces;
+
+	std::ifstream filestream(filename.c_str());
+	std::string line_stream;
+	while(std::getline(filestream, line_stream))
+	{
+		std::stringstream str_stream(line_stream);
+		std::string type_str;
+		str_stream >> type_str;
+		if(type_str == "v")
+		{
+			Vector3f position;
+			str_stream >> position.x >> position.y >> position.z;
+			positions.push_back(position);
+		}
+		else if(type_str == "vt")
+		{
+			Vector2f texture;
+			str_stream >> texture.x >> texture.y;
+			texcoords.push_back(texture);
+		}
+		else if(type_str == "vn")
+		{
+			Vector3f normal;
+			str_stream >> normal.x >> normal.y >> normal.z;
+			normals.push_back(normal);
+		}
+		else if(type_str == "f")
+		{
+			char temp;
+			LegacyFace face;
+			unsigned int v1, v2, v3;
+			for(int i = 0; i < 3; ++i)
+			{
+				str_stream >> v1 >> temp >> v2 >> temp >> v3;
+				face.position_index.push_back(v1 - 1);
+				face.texturecoord_index.push_back(v2 - 1);
+				face.normal_index.push_back(v3 - 1);
+			}
+			faces.push_back(face);
+		}
+	}
+	return faces.size();
+}
+
+// Time the reference and the mapped OBJ parser over files, each parsed until about 64 MB went through
+int objMain(const std::vector<std::string> & files)
+{
+	double legacyBytes = 0, legacySeconds = 0, parserBytes = 0, parserSeconds = 0;
+	for(size_t f = 0; f < files.size(); f++)
+	{
+		std::ifstream probe(files[f].c_str(), std::ios::binary | std::ios::ate);
+		double size = probe ? (double)probe.tellg() : 0;
+		if(size <= 0)
+		{
+			std::cout << "Error opening " << files[f] << std::endl;
+			return -1;
+		}
+		int repeats = (int)(64e6 / size) + 1;
+
+		// Reference parser, fewer rounds as it is slow
+		size_t legacyTriangles = 0;
+		int legacyRepeats = repeats / 10 + 1;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for(int k = 0; k < legacyRepeats; k++) legacyTriangles = legacyParseOBJ(files[f]);
+		std::chrono::duration<double> legacyTime = std::chrono::steady_clock::now() - start;
+
+		ObjParser parser;
+		start = std::chrono::steady_clock::now();
+		for(int k = 0; k < repeats; k++)
+			if(!parser.load(files[f])) return -1;
+		std::chrono::duration<double> parserTime = std::chrono::steady_clock::now() - start;
+
+		double legacyRate = size * legacyRepeats / legacyTime.count() / 1e6, parserRate = size * repeats / parserTime.count() / 1e6;
+		std::cout << files[f] << ": " << parser.getCorners().size() / 3 << " triangles (" << legacyTriangles << " reference), "
+		          << legacyRate << " MB/s reference, " << parserRate << " MB/s mapped, " << parserRate / legacyRate << "x" << std::endl;
+		legacyBytes += size * legacyRepeats;
+		legacySeconds += legacyTime.count();
+		parserBytes += size * repeats;
+		parserSeconds += parserTime.count();
+	}
+
+	if(legacySeconds > 0 && parserSeconds > 0)
+		std::cout << "Total: " << legacyBytes / legacySeconds / 1e6 << " MB/s reference, " << parserBytes / parserSeconds / 1e6
+		          << " MB/s mapped, " << (parserBytes / parserSeconds) / (legacyBytes / legacySeconds) << "x" << std::endl;
+	return 0;
+}
+
+// Reference BMP decoder, the stream reads and per-byte loop Texture::LoadBMP used before, 24-bit V3 only
+bool legacyLoadBMP(std::string filename, int & width, int & height, std::vector<char> & data)
+{
+	std::ifstream input(filename.c_str(), std::ifstream::binary);
+	char buffer[4];
+	input.read(buffer, 2);
+	if(input.fail() || buffer[0] != 'B' || buffer[1] != 'M') return false;
+	input.ignore(8);
+	input.read(buffer, 4);
+	int dataOffset = (unsigned char)buffer[0] | ((unsigned char)buffer[1] << 8) | ((unsigned char)buffer[2] << 16) | ((unsigned char)buffer[3] << 24);
+	input.read(buffer, 4);
+	if(buffer[0] != 40) return false;
+	input.read(buffer, 4);
+	width = (unsigned char)buffer[0] | ((unsigned char)buffer[1] << 8) | ((unsigned char)buffer[2] << 16) | ((unsigned char)buffer[3] << 24);
+	input.read(buffer, 4);
+	height = (unsigned char)buffer[0] | ((unsigned char)buffer[1] << 8) | ((unsigned char)buffer[2] << 16) | ((unsigned char)buffer[3] << 24);
+
+	int bytesPerRow = ((width * 3 + 3) / 4) * 4 - (width * 3 % 4);
+	std::vector<char> pixels(bytesPerRow * height);
+	input.seekg(dataOffset, std::ios_base::beg);
+	input.read(&pixels[0], pixels.size());
+
+	data.resize(width * height * 3);
+	for(int y = 0; y < height; y++)
+		for(int x = 0; x < width; x++)
+			for(int c = 0; c < 3; c++)
+				data[3 * (width * y + x) + c] = pixels[bytesPerRow * y + 3 * x + (2 - c)];
+	return true;
+}
+
+// Time the reference and the mapped BMP decoder over files, each decoded until about 256 MB of pixels came out
+int bmpMain(const std::vector<std::string> & files)
+{
+	std::cout << "Row conversion: " << (Bitmap::usesSSSE3() ? "SSSE3" : "scalar") << std::endl;
+	double legacyBytes = 0, legacySeconds = 0, bitmapBytes = 0, bitmapSeconds = 0;
+	for(size_t f = 0; f < files.size(); f++)
+	{
+		Bitmap bitmap;
+		Bitmap::Error error = bitmap.load(files[f]);
+		if(error != Bitmap::None)
+		{
+			std::cout << "Error loading " << files[f] << ": " << Bitmap::getErrorString(error) << std::endl;
+			return -1;
+		}
+		double size = (double)bitmap.getWidth() * bitmap.getHeight() * 3;
+		int repeats = (int)(256e6 / size) + 1;
+
+		// Reference decoder, also checks the pixels match where it can read the file
+		int width = 0, height = 0;
+		std::vector<char> data;
+		bool legacy = legacyLoadBMP(files[f], width, height, data);
+		bool same = legacy && width == bitmap.getWidth() && height == bitmap.getHeight() && memcmp(&data[0], bitmap.getPixels(), data.size()) == 0;
+		int legacyRepeats = legacy ? repeats / 10 + 1 : 0;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for(int k = 0; k < legacyRepeats; k++) legacyLoadBMP(files[f], width, height, data);
+		std::chrono::duration<double> legacyTime = std::chrono::steady_clock::now() - start;
+
+		start = std::chrono::steady_clock::now();
+		for(int k = 0; k < repeats; k++) bitmap.load(files[f]);
+		std::chrono::duration<double> bitmapTime = std::chrono::steady_clock::now() - start;
+
+		double bitmapRate = size * repeats / bitmapTime.count() / 1e6;
+		std::cout << files[f] << ": " << bitmap.getWidth() << "x" << bitmap.getHeight() << ", ";
+		if(legacy)
+		{
+			double legacyRate = size * legacyRepeats / legacyTime.count() / 1e6;
+			std::cout << legacyRate << " MB/s reference, " << bitmapRate << " MB/s decoder, " << bitmapRate / legacyRate << "x, "
+			          << (same ? "same pixels" : "pixels differ") << std::endl;
+			legacyBytes += size * legacyRepeats;
+			legacySeconds += legacyTime.count();
+			bitmapBytes += size * repeats;
+			bitmapSeconds += bitmapTime.count();
+		}
+		else std::cout << bitmapRate << " MB/s decoder, not readable by the reference" << std::endl;
+	}
+
+	if(legacySeconds > 0 && bitmapSeconds > 0)
+		std::cout << "Total: " << legacyBytes / legacySeconds / 1e6 << " MB/s reference, " << bitmapBytes / bitmapSeconds / 1e6
+		          << " MB/s decoder, " << (bitmapBytes / bitmapSeconds) / (legacyBytes / legacySeconds) << "x" << std::endl;
+	return 0;
+}
+
+// Peak signal to noise ratio of RGBA pixels against RGB ones in dB
+double psnr(const unsigned char * rgb, const unsigned char * rgba, size_t count)
+{
+	double error = 0;
+	for(size_t i = 0; i < count; i++)
+		for(int c = 0; c < 3; c++)
+		{
+			double difference = (double)rgb[3 * i + c] - rgba[4 * i + c];
+			error += difference * difference;
+		}
+	error /= 3.0 * count;
+	return error > 0 ? 10 * log10(255.0 * 255.0 / error) : 99;
+}
+
+// Time building, caching and mapping BC1 mip chains of BMP files, and compare memory and quality with uncompressed textures without mipmaps
+int textureMain(const std::vector<std::string> & files)
+{
+	size_t uncompressedBytes = 0, compressedBytes = 0;
+	for(size_t f = 0; f < files.size(); f++)
+	{
+		std::string source = TextureCache::getSource(files[f]);
+		Bitmap bitmap;
+		Bitmap::Error error = bitmap.load(files[f]);
+		if(error != Bitmap::None)
+		{
+			std::cout << "Error loading " << files[f] << ": " << Bitmap::getErrorString(error) << std::endl;
+			return -1;
+		}
+		int width = bitmap.getWidth(), height = bitmap.getHeight();
+		const unsigned char * pixels = (const unsigned char *)bitmap.getPixels();
+
+		// Best of a few runs of the whole chain, as built on a cache miss
+		TextureCompressor::Image image;
+		double compressTime = 1e30;
+		for(int run = 0; run < 5; run++)
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			TextureCompressor::compress(pixels, width, height, 3, TextureCompressor::BC1, image);
+			std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - start;
+			if(time.count() < compressTime) compressTime = time.count();
+		}
+
+		// Quality of the full size level
+		std::vector<unsigned char> decoded((size_t)width * height * 4);
+		TextureCompressor::decode(image.format, &image.data[0], width, height, &decoded[0]);
+		double quality = psnr(pixels, &decoded[0], (size_t)width * height);
+
+		// Writing the cache, and mapping it as later loads do
+		std::string cacheName = TextureCache::getCacheName(files[f]);
+		if(!TextureCache::write(cacheName, source, image)) return -1;
+		TextureCache cache;
+		int maps = 1000;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for(int k = 0; k < maps; k++)
+		{
+			if(!cache.open(cacheName)) return -1;
+			cache.close();
+		}
+		std::chrono::duration<double, std::milli> mapTime = std::chrono::steady_clock::now() - start;
+
+		// Drivers store RGB textures with 4 bytes per texel
+		size_t before = (size_t)width * height * 4, after = image.data.size();
+		uncompressedBytes += before;
+		compressedBytes += after;
+		std::cout << files[f] << ": " << width << "x" << height << ", " << image.levels.size() << " levels, mipmaps and BC1 in " << compressTime << " ms, cache mapped in "
+		          << mapTime.count() / maps << " ms, " << before / 1024 << " KB -> " << after / 1024 << " KB, PSNR " << quality << " dB" << std::endl;
+	}
+
+	// A bilinear sample reads 4 texels, trilinear reads 8 from two levels of 4x4 blocks
+	std::cout << "Total: " << uncompressedBytes / 1024 << " KB as RGB without mipmaps, " << compressedBytes / 1024 << " KB as BC1 with mipmaps, "
+	          << (double)uncompressedBytes / compressedBytes << "x less" << std::endl;
+	std::cout << "Sampling: 4 bytes per texel before, 0.5 after, and minified draws read the level nearest their screen size instead of skipping across the full image" << std::endl;
+	return 0;
+}
+
+// Main Program Entry
+int main(int argc, char** argv)
+{
+	// Usage: Headless --batch [worlds] [ticks] [maze file]
+	if(argc > 1 && strcmp(argv[1], "--batch") == 0)
+	{
+		int worldCount = argc > 2 ? atoi(argv[2]) : 4096;
+		int ticks = argc > 3 ? atoi(argv[3]) : 1000;
+		if(worldCount < 1)
+		{
+			std::cout << "Error: at least one world is needed" << std::endl;
+			return -1;
+		}
+		return batchMain(worldCount, ticks, argc > 4 ? argv[4] : "../models/maze.txt");
+	}
+
+	// Usage: Headless --tile <maze file> <tile file> [tile size]
+	if(argc > 3 && strcmp(argv[1], "--tile") == 0)
+	{
+		int tileSize = argc > 4 ? atoi(argv[4]) : 256;
+		return TiledMaze::convert(argv[2], argv[3], tileSize) ? 0 : -1;
+	}
+
+	// Usage: Headless --tiled <tile file> [ticks] [tile budget]
+	if(argc > 2 && strcmp(argv[1], "--tiled") == 0)
+	{
+		long long ticks = argc > 3 ? atoll(argv[3]) : 1000000;
+		int budget = argc > 4 ? atoi(argv[4]) : 16;
+		return tiledMain(argv[2], ticks, budget);
+	}
+
+	// Usage: Headless --record <replay file> [ticks] [maze file]
+	if(argc > 2 && strcmp(argv[1], "--record") == 0)
+	{
+		long long ticks = argc > 3 ? atoll(argv[3]) : 1000000;
+		return recordMain(argv[2], ticks, argc > 4 ? argv[4] : "../models/maze.txt");
+	}
+
+	// Usage: Headless --replay <replay file> [maze file]
+	if(argc > 2 && strcmp(argv[1], "--replay") == 0)
+		return replayMain(argv[2], argc > 3 ? argv[3] : "../models/maze.txt");
+
+	// Usage: Headless --mesh [maze file]
+	if(argc > 1 && strcmp(argv[1], "--mesh") == 0)
+		return meshMain(argc > 2 ? argv[2] : "../models/maze.txt");
+
+	// Usage: Headless --obj [obj files]
+	if(argc > 1 && strcmp(argv[1], "--obj") == 0)
+	{
+		std::vector<std::string> files(argv + 2, argv + argc);
+		if(files.empty())
+		{
+			const char * models[] = { "ball", "back_wheel", "chassis", "coin", "front_wheel", "turret" };
+			for(int k = 0; k < 6; k++) files.push_back(std::string("../models/") + models[k] + ".obj");
+		}
+		return objMain(files);
+	}
+
+	// Usage: Headless --textures [bmp files]
+	if(argc > 1 && strcmp(argv[1], "--textures") == 0)
+	{
+		std::vector<std::string> files(argv + 2, argv + argc);
+		if(files.empty())
+		{
+			const char * images[] = { "Crate", "ball", "hamvee" };
+			for(int k = 0; k < 3; k++) files.push_back(std::string("../models/") + images[k] + ".bmp");
+		}
+		return textureMain(files);
+	}
+
+	// Usage: Headless --bmp [bmp files]
+	if(argc > 1 && strcmp(argv[1], "--bmp") == 0)
+	{
+		std::vector<std::string> files(argv + 2, argv + argc);
+		if(files.empty())
+		{
+			const char * images[] = { "Crate", "ball", "hamvee" };
+			for(int k = 0; k < 3; k++) files.push_back(std::string("../models/") + images[k] + ".bmp");
+		}
+		return bmpMain(files);
+	}
+
+	// Usage: Headless [ticks] [maze file]
+	long long ticks = argc > 1 ? atoll(argv[1]) : 10000000;
+	std::string mazeFile = argc > 2 ? argv[2] : "../models/maze.txt";
+
+	// Load maze and start game
+	GameSim sim;
+	std::chrono::steady_clock::time_point loadStart = std::chrono::steady_clock::now();
+	if(!sim.loadMaze(mazeFile))
+		return -1;
+	std::chrono::duration<double> loadTime = std::chrono::steady_clock::now() - loadStart;
+	sim.restart();
+
+	MazeGrid & maze = sim.getWorld().maze;
+	std::cout << "Maze: " << maze.getRows() << "x" << maze.getCols() << " loaded in " << loadTime.count() << " s" << std::endl;
+
+	runGames(sim, ticks);
+
+	return 0;
+}
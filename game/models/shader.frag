@@ -1,14 +1,41 @@
 #version 120
+#ifdef GL_ARB_uniform_buffer_object
+#extension GL_ARB_uniform_buffer_object : enable
+#endif
+#ifdef GL_EXT_texture_array
+#extension GL_EXT_texture_array : enable
+#endif
 
+// Frame constants, same block as the vertex shader
+#ifdef GL_ARB_uniform_buffer_object
+layout(std140) uniform Frame_block
+{
+   mat4  ViewMatrix_uniform;
+   mat4  ProjMatrix_uniform;
+   vec4  LightPosition_uniform;
+   vec4  Ambient_uniform;
+   float SpecularPower_uniform;
+};
+#else
 uniform vec4        Ambient_uniform;
-uniform vec4        Specular_uniform;
 uniform float       SpecularPower_uniform;
+#endif
+
+// Per material
+uniform vec4        Specular_uniform;
+
+// All textures as layers of one array where supported
+#ifdef GL_EXT_texture_array
+uniform sampler2DArray TextureArray_uniform;
+#else
 uniform sampler2D   Texture_uniform;
+#endif
 
 varying vec3    ViewDirection;
 varying vec3    LightDirection;
 varying vec3    Normal;
 varying vec2    texCoord;
+varying float   texLayer;
 
 void main( void )
 {
@@ -20,7 +47,12 @@ void main( void )
    vec3  fvViewDirection  = normalize( ViewDirection );
    float fRDotV           = max( 0.0, dot( fvReflection, fvViewDirection ) );
    
-   vec4  fvTotalDiffuse   = fNDotL *  texture2D(Texture_uniform, texCoord);
+#ifdef GL_EXT_texture_array
+   vec4  fvBaseColor      = texture2DArray(TextureArray_uniform, vec3(texCoord, texLayer));
+#else
+   vec4  fvBaseColor      = texture2D(Texture_uniform, texCoord);
+#endif
+   vec4  fvTotalDiffuse   = fNDotL *  fvBaseColor;
    vec4  fvTotalSpecular  = Specular_uniform * ( pow( fRDotV, SpecularPower_uniform ) );
   
    gl_FragColor = vec4((Ambient_uniform.rgb + fvTotalDiffuse.rgb + fvTotalSpecular.rgb), 1.0);
@@ -1,26 +1,55 @@
 #version 120
+#ifdef GL_ARB_uniform_buffer_object
+#extension GL_ARB_uniform_buffer_object : enable
+#endif
 
 // Attributes
 attribute vec3 aVertexPosition;
 attribute vec3 aVertexNormal;
 attribute vec2 aVertexTexcoord;
 
-uniform mat4x4 MVMatrix_uniform;
+// Per-instance offset in xyz and scale in w, constant (0, 0, 0, 1) when not instancing
+attribute vec4 aInstanceTransform;
+
+// Per-instance layer of the texture array, constant per draw when not instancing
+attribute float aInstanceLayer;
+
+// Frame constants, one uniform buffer when blocks are supported
+#ifdef GL_ARB_uniform_buffer_object
+layout(std140) uniform Frame_block
+{
+   mat4 ViewMatrix_uniform;
+   mat4 ProjMatrix_uniform;
+   vec4 LightPosition_uniform;
+   vec4 Ambient_uniform;
+   float SpecularPower_uniform;
+};
+#else
+uniform mat4x4 ViewMatrix_uniform;
 uniform mat4x4 ProjMatrix_uniform;
-uniform vec3   LightPosition_uniform;
+uniform vec4   LightPosition_uniform;
+#endif
+
+// Per draw
+uniform mat4x4 ModelMatrix_uniform;
 
 varying vec3 ViewDirection;
 varying vec3 LightDirection;
 varying vec3 Normal;
 varying vec2 texCoord;
+varying float texLayer;
 
 void main( void )
 {
    texCoord = aVertexTexcoord;
+   texLayer = aInstanceLayer;
+
+   vec4 position  = vec4(aVertexPosition * aInstanceTransform.w + aInstanceTransform.xyz, 1.0);
+   mat4 modelview = ViewMatrix_uniform * ModelMatrix_uniform;
 
-   ViewDirection  = -vec3(MVMatrix_uniform * vec4(aVertexPosition, 1.0));
-   LightDirection = LightPosition_uniform;
-   Normal         = (MVMatrix_uniform * vec4(aVertexNormal,0.0)).xyz;  
+   ViewDirection  = -vec3(modelview * position);
+   LightDirection = LightPosition_uniform.xyz;
+   Normal         = (modelview * vec4(aVertexNormal,0.0)).xyz;  
 
-   gl_Position = ProjMatrix_uniform * MVMatrix_uniform * vec4(aVertexPosition,1.0);
+   gl_Position = ProjMatrix_uniform * modelview * position;
 }
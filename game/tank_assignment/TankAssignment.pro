@@ -2,7 +2,7 @@ TEMPLATE = app
 
 #Executable Name
 TARGET = TankAssignment
-CONFIG = debug
+CONFIG = debug c++11 thread
 
 #Destination
 DESTDIR = .
@@ -12,8 +12,17 @@ HEADERS	+= 	../common/Shader.h	    	\
 		../common/Vector.h		        \	
 		../common/Matrix.h		        \
 		../common/Mesh.h		        \
+		../common/MeshOptimizer.h	\
+		../common/MeshCache.h		\
+		../common/Frustum.h		        \
+		../common/RenderQueue.h		        \
+		../common/FrameUniforms.h		        \
+		../common/MazeChunkBuffer.h		        \
+		../common/TextureArray.h		        \
+		../common/TextRenderer.h		        \
         ../common/Texture.h             \		
         ../common/SphericalCameraManipulator.h   \
+        ../common/GameSim.h                      \
 
 #Sources
 SOURCES += 	main.cpp			        \
@@ -21,6 +30,14 @@ SOURCES += 	main.cpp			        \
 		../common/Vector.cpp		    \
 		../common/Matrix.cpp		    \
 		../common/Mesh.cpp		        \
+		../common/MeshOptimizer.cpp	\
+		../common/MeshCache.cpp		\
+		../common/Frustum.cpp		    \
+		../common/RenderQueue.cpp		    \
+		../common/FrameUniforms.cpp		    \
+		../common/MazeChunkBuffer.cpp		    \
+		../common/TextureArray.cpp		    \
+		../common/TextRenderer.cpp		    \
         ../common/Texture.cpp           \
         ../common/SphericalCameraManipulator.cpp \
 
@@ -35,3 +52,6 @@ LIBS += ..\lib\freeglutd.lib
 LIBS += ..\lib\opengl32.lib
 LIBS += ..\lib\glut32.lib
 LIBS += ..\lib\glew32.lib
+
+#Simulation Library
+LIBS += -L../game_sim/ -lGameSim
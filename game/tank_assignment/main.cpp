@@ -1,48 +1,41 @@
 // Includes
 #include <GL/glew.h>
 #include <GL/glut.h>
+#include <AssetLoader.h>
+#include <Bitmap.h>
 #include <Shader.h>
 #include <Vector.h>
 #include <Matrix.h>
 #include <Mesh.h>
+#include <Frustum.h>
+#include <RenderQueue.h>
+#include <FrameUniforms.h>
+#include <MazeMesher.h>
+#include <MazeChunkBuffer.h>
 #include <Texture.h>
+#include <TextureArray.h>
+#include <TextRenderer.h>
 #include <SphericalCameraManipulator.h>
+#include <GameSim.h>
+#include <Replay.h>
+#include <SimThread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
 #include <iostream>
 #include <math.h>
 #include <string>
-#include <sstream>
-
-// Maze dimensions and integer matrix
-const int N = 8;       // Rows
-const int M = 10;      // Columns
-std::vector<int> maze; // MxN matrix
+#include <vector>
 
 // Camera properties
 const float cameraHeight = 5;
 const float cameraDistance = 7;
 
-// Tank properties
-const float tankAcceleration = 100;
-const float tankDeceleration = 100;
-const float tankMaxVelocity = 25;
-const float tankFriction = 30;
-const float tankTurningRate = 100;
-
-// Cube properties
-const float cubeSize = 15;
-
-// Coin properties
-const float coinSize = 1;
-const float coinHeight = 2;
-
-// Ball properties
-const float ballSize = 0.4f;
-const float ballSpeed = 50;
-
 // Game properties
 int screenWidth  = 630;
 int screenHeight = 630;
-const float gravity = -30;
+const float timeStep = 0.01f;
 
 // Light properties
 Vector3f lightPosition = Vector3f(0, 1, 1);
@@ -50,53 +43,90 @@ Vector3f ambient       = Vector3f(0.1f, 0.1f, 0.2f);
 Vector3f specular      = Vector3f(1.0f, 1.0f, 1.0f);
 float specularPower    = 50.0f;
 
-// Tank variables
-Vector3f tankPosition;
-float tankDistanceTravelled = 0;
-float tankAngle = 0;
-float tankVelocity = 0;
-float tankFallVelocity = 0;
-float tankFallingTime = 0;
-bool tankAccelerating = false;
-bool tankDecelerating = false;
-bool tankTurningLeft = false;
-bool tankTurningRight = false;
-bool tankFalling = false;
-
-// Coin variables
-int totalCoins = 0;
-int collectedCoins = 0;
-
-// Ball variables
-bool shooting = false;
-Vector3f ballPosition, ballVelocity;
+// Camera view and frustum, set once per frame
+Matrix4x4 viewMatrix;
+Frustum frustum;
+
+// Pixels a unit at unit distance covers on screen, for choosing levels of detail
+float pixelsPerUnit = 1;
+
+// Objects drawn and culled in the last frame
+struct CullCounters
+{
+	int chunksDrawn, chunksCulled;
+	int coinsDrawn, coinsCulled;
+	int meshesDrawn, meshesCulled;
+	int meshTriangles;
+	int boxesTested;
+};
+CullCounters cullCounters;
+bool showCounters = false;
 
 // Game variables
 SphericalCameraManipulator cameraManip;
-float timeRemaining = 0;
-bool gameOver = false;
-std::string gameOverMessage;
+GameSim sim;
+Inputs inputs;
+
+// Simulation thread and the world it last showed
+SimThread simThread(sim, timeStep);
+World view;
+
+// Session recording, saved on exit
+Replay replay;
+std::string replayFile = "session.replay";
 
 // Objects and texture IDs
-Mesh cube, coin, ball, chassis, backWheel, frontWheel, turret;
+Mesh coin, ball, chassis, backWheel, frontWheel, turret;
 GLuint cubeTextureID, tankTextureID, ballTextureID, coinTextureID;
 
+// Textures as layers of one array texture when supported, all IDs are then the array
+TextureArray textureArray;
+GLenum textureTarget = GL_TEXTURE_2D;
+int cubeLayer = 0, tankLayer = 0, ballLayer = 0, coinLayer = 0;
+
+// Levels of detail drawn last, kept per object for hysteresis
+int chassisLevel = 0, frontWheelLevel = 0, backWheelLevel = 0, turretLevel = 0;
+
+// Mesh draws of a frame, sorted by state before drawing
+RenderQueue renderQueue;
+RenderQueue::Material tankMaterial, ballMaterial, coinMaterial;
+
 // Shader variables
 GLuint shaderProgramID;
-GLuint MVMatrixUniformLocation;
-GLuint ProjectionUniformLocation;
+GLuint ModelMatrixUniformLocation;
 GLuint TextureMapUniformLocation;
+GLint TextureArrayUniformLocation;
+
+// Camera and light values, uploaded once per frame
+FrameUniforms frameUniforms;
 
 // Vertex attribute locations
 GLuint vertexPositionAttribute;
 GLuint vertexNormalAttribute;
 GLuint vertexTexcoordAttribute;
 
-// Light uniform locations
-GLuint LightPositionUniformLocation;
-GLuint AmbientUniformLocation;
+// Per-instance transform and texture layer attribute locations
+GLint vertexInstanceAttribute;
+GLint vertexLayerAttribute;
+
+// Instanced coin drawing, transforms of the coins in view gathered every frame
+bool instancing = false;
+GLuint coinInstanceBuffer;
+std::vector<GLfloat> instanceData;
+
+// Maze blocks baked into chunk meshes, packed in one buffer where a chunk is uploaded again when its revision changes
+MazeMesher mazeMesher(cubeSize);
+MazeChunkBuffer mazeChunks;
+unsigned int bakedRevision = 0;
+bool mazeBaked = false;
+
+// HUD text from a glyph atlas, one slot per line
+TextRenderer hudText(0.0008f, 0.001f);
+enum { hudTime, hudScore, hudCounters, hudQueue, hudMessage, hudContinue };
+bool hudAtlasTried = false;
+
+// Material uniform location
 GLuint SpecularUniformLocation;
-GLuint SpecularPowerUniformLocation;
 
 // Array of key states
 bool keyStates[256];
@@ -109,19 +139,7 @@ void keyUp(unsigned char key, int x, int y);
 void handleKeys();
 void mouse(int button, int state, int x, int y);
 void motion(int x, int y);
-void Timer(int value);
-
-// Converting degrees to radians
-float degreesToRadians(float angle)
-{
-	return angle * (float)M_PI / 180;
-}
-
-// Converting radians to degrees
-float radiansToDegrees(float angle)
-{
-	return angle * 180 / (float)M_PI;
-}
+void saveReplay();
 
 // Rotating around point
 void rotateAroundPoint(Matrix4x4 & matrix, const Vector3f & point, float angle)
@@ -132,72 +150,6 @@ void rotateAroundPoint(Matrix4x4 & matrix, const Vector3f & point, float angle)
 	matrix.translate(-point.x, -point.y, -point.z);
 }
 
-// Loading maze from file
-bool loadMaze()
-{
-	maze.clear();
-	totalCoins = 0;
-
-	// Open file
-	std::ifstream file("../models/maze.txt");
-	if(!file)
-	{
-		std::cout << "Error opening ../models/maze.txt" << std::endl;
-		return false;
-	}
-
-	// Read file
-	char c = 0;
-	while(file >> c)
-	{
-		// Convert char to integer, count coins, add to matrix
-		int type = c - '0';
-		if(type == 2) totalCoins++;
-		maze.push_back(type);
-	}
-
-	return true;
-}
-
-// Checking for blocks
-bool isBlock(int i, int j)
-{
-	// Bound checking
-	if(i < 0 || i > N - 1) return false;
-	if(j < 0 || j > M - 1) return false;
-	int index = i * M + j;
-	if(index < 0 || index > (int)maze.size()) return false;
-
-	// 1 or 2 indicates blocks
-	return maze[index] == 1 || maze[index] == 2;
-}
-
-// Checking for targets
-bool isTarget(int i, int j)
-{
-	// Bound checking
-	if(i < 0 || i > N - 1) return false;
-	if(j < 0 || j > M - 1) return false;
-	int index = i * M + j;
-	if(index < 0 || index > (int)maze.size()) return false;
-
-	// 2 indicates targets
-	return maze[index] == 2;
-}
-
-// Removing targets
-void removeTarget(int i, int j)
-{
-	// Bound checking
-	if(i < 0 || i > N - 1) return;
-	if(j < 0 || j > M - 1) return;
-	int index = i * M + j;
-	if(index < 0 || index > (int)maze.size()) return;
-
-	// 1 indicates blocks without target
-	maze[index] = 1;
-}
-
 // Loading shaders
 void loadShaders()
 {
@@ -208,42 +160,99 @@ void loadShaders()
 	vertexPositionAttribute = glGetAttribLocation(shaderProgramID, "aVertexPosition");
 	vertexNormalAttribute = glGetAttribLocation(shaderProgramID,   "aVertexNormal");
 	vertexTexcoordAttribute = glGetAttribLocation(shaderProgramID, "aVertexTexcoord");
+	vertexInstanceAttribute = glGetAttribLocation(shaderProgramID, "aInstanceTransform");
+	vertexLayerAttribute = glGetAttribLocation(shaderProgramID, "aInstanceLayer");
 
 	// Get uniforms locations
-	MVMatrixUniformLocation      = glGetUniformLocation(shaderProgramID, "MVMatrix_uniform");
-	ProjectionUniformLocation    = glGetUniformLocation(shaderProgramID, "ProjMatrix_uniform");
-	LightPositionUniformLocation = glGetUniformLocation(shaderProgramID, "LightPosition_uniform");
-	AmbientUniformLocation       = glGetUniformLocation(shaderProgramID, "Ambient_uniform");
+	ModelMatrixUniformLocation   = glGetUniformLocation(shaderProgramID, "ModelMatrix_uniform");
 	SpecularUniformLocation      = glGetUniformLocation(shaderProgramID, "Specular_uniform");
-	SpecularPowerUniformLocation = glGetUniformLocation(shaderProgramID, "SpecularPower_uniform");
 	TextureMapUniformLocation    = glGetUniformLocation(shaderProgramID, "Texture_uniform");
+	TextureArrayUniformLocation  = glGetUniformLocation(shaderProgramID, "TextureArray_uniform");
+
+	// Camera and light block, or plain uniforms without uniform buffers
+	frameUniforms.init(shaderProgramID);
+
+	// Texture mapping from unit 0
+	glUseProgram(shaderProgramID);
+	glUniform1i(TextureMapUniformLocation, 0);
+	glUniform1i(TextureArrayUniformLocation, 0);
+	glUseProgram(0);
 }
 
-void restart()
+// Mesh read on a loader thread and uploaded on this one
+struct MeshLoad : public AssetLoader::Job
 {
-	loadMaze();
-
-	// Reset tank
-	tankPosition = Vector3f(cubeSize * (M - 1), -0.5f, cubeSize * 0);
-	tankDistanceTravelled = 0;
-	tankAngle = -90;
-	tankVelocity = 0;
-	tankFallVelocity = 0;
-	tankFallingTime = 0;
-	tankAccelerating = false;
-	tankDecelerating = false;
-	tankTurningLeft = false;
-	tankTurningRight = false;
-	tankFalling = false;
-
-	// Reset game
-	timeRemaining = 60;
-	collectedCoins = 0;
-	shooting = false;
-	gameOver = false;
-	gameOverMessage.clear();
+	MeshLoad(Mesh & mesh, const char * filename, bool levelsOfDetail) : mesh(mesh), filename(filename), levelsOfDetail(levelsOfDetail), loaded(false){};
+
+	void load() { loaded = mesh.prepareOBJ(filename, levelsOfDetail); }
+	void upload() { if(loaded) mesh.upload(); }
+
+	Mesh & mesh;
+	const char * filename;
+	bool levelsOfDetail;
+	bool loaded;
+};
+
+// Texture read as a mip chain on a loader thread, from its cache or compressed there, created with the others once all are read
+struct TextureLoad : public AssetLoader::Job
+{
+	TextureLoad(Texture & image, const char * filename, GLuint & texture, int & layer) : image(image), filename(filename), texture(texture), layer(layer), width(0), height(0), compressed(false), loaded(false){};
+
+	void load()
+	{
+		loaded = image.prepareBMP(filename, width, height, compressed);
+	}
+	void upload() {}
+
+	Texture & image;
+	const char * filename;
+	GLuint & texture;
+	int & layer;
+	int width, height;
+	bool compressed;
+	bool loaded;
 };
 
+// Creating textures from the mip chains read, as layers of one array texture when the shader samples one
+void createTextures(TextureLoad * loads, int count, bool useArray)
+{
+	// Memory taken, and what the same images took before as RGB without mipmaps, which drivers store with 4 bytes per texel
+	size_t bytes = 0, uncompressedBytes = 0;
+
+	bool arrayBuilt = false;
+	if(useArray)
+	{
+		for(int k = 0; k < count; k++)
+			loads[k].layer = loads[k].loaded ? textureArray.add(loads[k].image) : -1;
+		arrayBuilt = textureArray.build();
+		if(arrayBuilt)
+		{
+			textureTarget = GL_TEXTURE_2D_ARRAY;
+			bytes = textureArray.getBytes();
+			uncompressedBytes = (size_t)textureArray.getWidth() * textureArray.getHeight() * 4 * textureArray.getLayerCount();
+		}
+		else std::cout << "Error building texture array" << std::endl;
+	}
+
+	// All IDs are the array, or one texture each
+	for(int k = 0; k < count; k++)
+	{
+		if(arrayBuilt) loads[k].texture = textureArray.getTexture();
+		else
+		{
+			if(loads[k].loaded)
+			{
+				bytes += loads[k].image.getBytes();
+				uncompressedBytes += (size_t)loads[k].image.getWidth() * loads[k].image.getHeight() * 4;
+			}
+			loads[k].texture = loads[k].loaded ? loads[k].image.upload() : 0;
+			loads[k].layer = 0;
+		}
+	}
+
+	std::cout << "Texture memory " << bytes / 1024 << " KB with mipmaps, " << uncompressedBytes / 1024 << " KB as uncompressed RGB without" << std::endl;
+}
+
 // Main Program Entry
 int main(int argc, char** argv)
 {
@@ -255,30 +264,97 @@ int main(int argc, char** argv)
 	for(int i = 0 ; i < 256; i++)
 		keyStates[i] = false;
 
-	// Load objects
-	cube.loadOBJ("../models/cube.obj");
-	coin.loadOBJ("../models/coin.obj");
-	ball.loadOBJ("../models/ball.obj");
-	chassis.loadOBJ("../models/chassis.obj");
-	backWheel.loadOBJ("../models/back_wheel.obj");
-	frontWheel.loadOBJ("../models/front_wheel.obj");
-	turret.loadOBJ("../models/turret.obj");
+	// Loader threads, Usage: TankAssignment [--loaders count]
+	int loaderCount = AssetLoader::getDefaultWorkerCount();
+	for(int k = 1; k + 1 < argc; k++)
+		if(std::string(argv[k]) == "--loaders") loaderCount = atoi(argv[k + 1]);
+
+	// Load objects on loader threads while the shaders compile here, then textures
+	std::chrono::steady_clock::time_point loadStart = std::chrono::steady_clock::now();
+	{
+		AssetLoader loader(loaderCount);
+		MeshLoad meshLoads[] = {
+			MeshLoad(coin, "../models/coin.obj", false),
+			MeshLoad(ball, "../models/ball.obj", true),
+			MeshLoad(chassis, "../models/chassis.obj", false),
+			MeshLoad(backWheel, "../models/back_wheel.obj", true),
+			MeshLoad(frontWheel, "../models/front_wheel.obj", true),
+			MeshLoad(turret, "../models/turret.obj", false) };
+		Texture images[4];
+		TextureLoad textureLoads[] = {
+			TextureLoad(images[0], "../models/crate.bmp", cubeTextureID, cubeLayer),
+			TextureLoad(images[1], "../models/coin.bmp", coinTextureID, coinLayer),
+			TextureLoad(images[2], "../models/ball.bmp", ballTextureID, ballLayer),
+			TextureLoad(images[3], "../models/hamvee.bmp", tankTextureID, tankLayer) };
+		const int meshCount = sizeof(meshLoads) / sizeof(meshLoads[0]), textureCount = sizeof(textureLoads) / sizeof(textureLoads[0]);
+		for(int k = 0; k < meshCount; k++)
+			loader.add(&meshLoads[k]);
+
+		// Load OpenGL shaders, which tell whether textures become layers of one array
+		loadShaders();
+		bool useArray = TextureArrayUniformLocation != -1 && TextureArray::isSupported();
+
+		// Array layers take the size of the largest image, read from the headers alone
+		int layerWidth = 0, layerHeight = 0;
+		for(int k = 0; useArray && k < textureCount; k++)
+		{
+			int width, height;
+			if(Bitmap::readSize(textureLoads[k].filename, width, height) != Bitmap::None) continue;
+			if(width > layerWidth) layerWidth = width;
+			if(height > layerHeight) layerHeight = height;
+		}
+		for(int k = 0; k < textureCount; k++)
+		{
+			textureLoads[k].width = layerWidth;
+			textureLoads[k].height = layerHeight;
+			textureLoads[k].compressed = Texture::isCompressionSupported();
+			loader.add(&textureLoads[k]);
+		}
+
+		// Upload meshes as they finish, then textures in the form the shader samples
+		loader.uploadAll();
+		createTextures(textureLoads, textureCount, useArray);
 
-	// Load textures
-	cubeTextureID = Texture::LoadBMP("../models/crate.bmp");
-	coinTextureID = Texture::LoadBMP("../models/coin.bmp");
-	ballTextureID = Texture::LoadBMP("../models/ball.bmp");
-	tankTextureID = Texture::LoadBMP("../models/hamvee.bmp");
+		std::chrono::duration<double, std::milli> loadTime = std::chrono::steady_clock::now() - loadStart;
+		std::cout << "Loaded assets in " << loadTime.count() << " ms with " << loader.getWorkerCount() << " loader threads" << std::endl;
+	}
 
-	// Load OpenGL shaders
-	loadShaders();
+	// Render queue state
+	renderQueue.setAttributes(vertexPositionAttribute, vertexNormalAttribute, vertexTexcoordAttribute);
+	renderQueue.setUniforms(ModelMatrixUniformLocation, SpecularUniformLocation);
+	renderQueue.setSpecular(specular);
+	renderQueue.setTextures(textureTarget, vertexLayerAttribute);
+	RenderQueue::Material shiny = { shaderProgramID, 0, 0, true };
+	tankMaterial = ballMaterial = coinMaterial = shiny;
+	tankMaterial.texture = tankTextureID;
+	tankMaterial.layer = tankLayer;
+	ballMaterial.texture = ballTextureID;
+	ballMaterial.layer = ballLayer;
+	coinMaterial.texture = coinTextureID;
+	coinMaterial.layer = coinLayer;
+
+	// Instance buffer for coins
+	instancing = instancing && vertexInstanceAttribute != -1;
+	glGenBuffers(1, &coinInstanceBuffer);
+
+	// Load maze and measure turret for the simulation
+	sim.loadMaze("../models/maze.txt");
+	sim.setTurretHeight(turret.getMeshCentroid().y);
 
 	// Set up camera manipulator with initial turret centering
 	cameraManip.setPanTiltRadius(0, 0, 10);
 	cameraManip.handleMouseMotion(screenWidth / 2, screenHeight / 2);
 
+	// Record session, Usage: TankAssignment [--record replay file]
+	for(int k = 1; k + 1 < argc; k++)
+		if(std::string(argv[k]) == "--record") replayFile = argv[k + 1];
+
 	// Start game
-	restart();
+	sim.restart();
+	replay.begin(sim, timeStep);
+	simThread.setReplay(&replay);
+	simThread.start();
+	atexit(saveReplay);
 
 	// Enter main loop
 	glutMainLoop();
@@ -314,6 +390,9 @@ bool initGL(int argc, char** argv)
 		return false;
 	}
 
+	// Instanced drawing needs divisors and instanced draw calls
+	instancing = GLEW_VERSION_3_3 != 0;
+
 	// Set Display function
 	glutDisplayFunc(display);
 
@@ -326,218 +405,212 @@ bool initGL(int argc, char** argv)
 	glutPassiveMotionFunc(motion);
 	glutMotionFunc(motion);
 
-	// Start timer function after 100 milliseconds
-	glutTimerFunc(100, Timer, 0);
-
 	glEnable(GL_DEPTH_TEST);
 	return true;
 }
 
-// Colliding coins
-void collideCoins(Vector3f position)
+// Setting view matrix, frustum and frame uniforms for the frame
+void setView(Matrix4x4 & projectionMatrix)
 {
-	// For each grid cell
-	for(int i = 0; i < N; i++)
-	for(int j = 0; j < M; j++)
-	{
-		// Ignore cells without coins
-		if(!isTarget(i, j)) continue;
-
-		// Coin position
-		Vector3f coinPosition(cubeSize * j, coinHeight, cubeSize * i);
-
-		// If coin is close to position
-		if((position - coinPosition).length() < 2)
-		{
-			// Remove target
-			removeTarget(i, j);
-			collectedCoins++;
+	// View matrix with camera following tank from fixed distance
+	viewMatrix.toIdentity();
+	viewMatrix.translate(0, -cameraHeight, -cameraDistance);
+	viewMatrix.rotate(180 - view.tankAngle, 0, 1, 0);
+	viewMatrix.translate(-view.tankPosition.x, -view.tankPosition.y, -view.tankPosition.z);
+
+	// Frustum in world space
+	Matrix4x4 viewProjection = projectionMatrix * viewMatrix;
+	frustum.set(viewProjection);
+	memset(&cullCounters, 0, sizeof(cullCounters));
+	pixelsPerUnit = projectionMatrix.getPtr()[5] * screenHeight * 0.5f;
+
+	// Camera and light for every draw of the frame
+	frameUniforms.update(viewMatrix, projectionMatrix, lightPosition, ambient, specularPower);
+}
 
-			// Winning condition
-			if(collectedCoins == totalCoins)
-			{
-				gameOver = true;
-				gameOverMessage = "YOU WIN!";
-			}
-		}
-	}
+// Setting model matrix, the view is applied in the shader
+void setModelMatrix(Matrix4x4 & matrix)
+{
+	glUniformMatrix4fv(
+		ModelMatrixUniformLocation, // Uniform location
+		1,                          // Number of uniforms
+		false,                      // Transpose matrix
+		matrix.getPtr());           // Pointer to matrix values
 }
 
-// Updating tank variables
-void updateTank(float timeStep)
+// Queueing mesh unless its bounding sphere is outside the frustum, at a level of detail for its size on screen
+void drawMesh(Mesh & mesh, Matrix4x4 & matrix, const RenderQueue::Material & material, int & level)
 {
-	// Tank direction
-	Vector3f TankDirection(sinf(degreesToRadians(tankAngle)), 0, cosf(degreesToRadians(tankAngle)));
-
-	// Total tank acceleration according to driving, braking, and friction
-	float totalAcceleration = 0;
-	if(tankAccelerating) totalAcceleration += tankAcceleration;
-	if(tankDecelerating) totalAcceleration -= tankDeceleration;
-	if(tankVelocity < 0) totalAcceleration += tankFriction;
-	if(tankVelocity > 0) totalAcceleration -= tankFriction;
-
-	// Update tank velocity according to total acceleration
-	tankVelocity += totalAcceleration * timeStep;
-
-	// Limit maximum and minimum velocity
-	if(tankVelocity > tankMaxVelocity) tankVelocity = tankMaxVelocity;
-	if(tankVelocity < -tankMaxVelocity) tankVelocity = -tankMaxVelocity;
-	if(fabsf(tankVelocity) < 1) tankVelocity = 0;
-
-	// Tank angular velocity according to left/right turning
-	float tankOmega = 0;
-	if(tankTurningLeft) tankOmega += tankTurningRate;
-	if(tankTurningRight) tankOmega -= tankTurningRate;
-
-	// Update tank angle according to forward/backward motion
-	if(tankVelocity < 0) tankAngle -= tankOmega * timeStep;
-	if(tankVelocity > 0) tankAngle += tankOmega * timeStep;
-
-	// Update tank falling velocity
-	if(tankFalling)
+	Vector3f center;
+	float radius;
+	Frustum::transformSphere(matrix, mesh.getBoundingCenter(), mesh.getBoundingRadius(), center, radius);
+	if(!frustum.testSphere(center, radius))
 	{
-		tankFallVelocity += gravity * timeStep;
-		tankFallingTime += timeStep;
-
-		// Losing condition
-		if(tankFallingTime > 0.6f)
-		{
-			gameOver = true;
-			gameOverMessage = "YOU LOSE!";
-		}
+		cullCounters.meshesCulled++;
+		return;
 	}
+	cullCounters.meshesDrawn++;
 
-	// Update tank position according to movement and falling
-	tankPosition = tankPosition + TankDirection * tankVelocity * timeStep;
-	tankPosition.y = tankPosition.y + tankFallVelocity * timeStep;
+	// Projected diameter from the depth of the sphere centre, full size when the camera is inside it
+	float * v = viewMatrix.getPtr();
+	float depth = -(v[2] * center.x + v[6] * center.y + v[10] * center.z + v[14]);
+	float screenSize = depth > radius ? 2 * radius * pixelsPerUnit / depth : (float)screenHeight;
+	level = mesh.selectLevel(screenSize, level);
+	cullCounters.meshTriangles += mesh.getLevelTriangles(level);
 
-	// Update distance travelled
-	tankDistanceTravelled += tankVelocity * timeStep;
-
-	// Collision detection between coins and tank top
-	Vector3f tankTop = tankPosition;
-	tankTop.y += turret.getMeshCentroid().y;
-	collideCoins(tankTop);
-
-	// Convert tank position to maze coordinates
-	int i = (int)floorf(tankPosition.z / cubeSize + 0.5f);
-	int j = (int)floorf(tankPosition.x / cubeSize + 0.5f);
-
-	// If tank position is not over block, it should fall
-	if(!isBlock(i, j)) tankFalling = true;
+	// Drawn sorted by state when the queue is submitted
+	renderQueue.push(mesh, material, matrix, level);
 }
 
-// Updating ball variables
-void updateBall(float timeStep)
+// Adding instance transform, offset and uniform scale
+void addInstance(float x, float y, float z, float scale)
 {
-	if(!shooting) return;
-
-	// Falling under gravity
-	ballVelocity.y += gravity * timeStep;
-	ballPosition = ballPosition + ballVelocity * timeStep;
-
-	// End of falling
-	if(ballPosition.y < 0) shooting = false;
+	instanceData.push_back(x);
+	instanceData.push_back(y);
+	instanceData.push_back(z);
+	instanceData.push_back(scale);
+}
 
-	// Collision detection between coins and ball
-	collideCoins(ballPosition);
+// Setting texture and layer for the following draws
+void setTexture(GLuint textureID, int layer)
+{
+	glBindTexture(textureTarget, textureID);
+	if(vertexLayerAttribute != -1) glVertexAttrib1f(vertexLayerAttribute, (float)layer);
 }
 
-// Shooting ball
-void shootBall()
+// Drawing all instances of a mesh with one call
+void drawInstances(Mesh & mesh, GLuint instanceBuffer, int instanceCount, GLuint textureID, int layer)
 {
-	// One ball at time
-	if(shooting) return;
+	if(instanceCount == 0) return;
 
-	// Initial ball velocity in turret direction
-	float turretAngle = radiansToDegrees(cameraManip.getPan()) + 90;
-	float ballAngle = tankAngle + turretAngle;
-	Vector3f ballDirection(sinf(degreesToRadians(ballAngle)), 0, cosf(degreesToRadians(ballAngle)));
-	ballVelocity = ballDirection * ballSpeed;
+	// Instances carry their own transform
+	Matrix4x4 identity;
+	setModelMatrix(identity);
+	setTexture(textureID, layer);
 
-	// Initial ball position at turret muzzle
-	ballPosition = tankPosition + ballDirection * 4;
-	ballPosition.y += turret.getMeshCentroid().y;
+	// One transform per instance
+	mesh.DrawInstanced(instanceCount, instanceBuffer, vertexInstanceAttribute, vertexPositionAttribute, vertexNormalAttribute, vertexTexcoordAttribute);
 
-	shooting = true;
+	// Back to the identity transform for single draws
+	glVertexAttrib4f(vertexInstanceAttribute, 0, 0, 0, 1);
 }
 
-// Drawing mesh
-void drawMesh(Mesh & mesh, Matrix4x4 & matrix, GLuint textureID)
+// Baking maze blocks and uploading the chunks that were rebuilt
+void bakeMaze()
 {
-	// View matrix with camera following tank from fixed distance
-	Matrix4x4 view;
-	view.translate(0, -cameraHeight, -cameraDistance);
-	view.rotate(180 - tankAngle, 0, 1, 0);
-	view.translate(-tankPosition.x, -tankPosition.y, -tankPosition.z);
-
-	// Modelview matrix
-	Matrix4x4 modelview = view * matrix;
-
-	// Set modelview matrix
-	glUniformMatrix4fv(
-		MVMatrixUniformLocation, // Uniform location
-		1,                       // Number of uniforms
-		false,                   // Transpose matrix
-		modelview.getPtr());     // Pointer to matrix values
-
-	// Set texture and draw mesh
-	glBindTexture(GL_TEXTURE_2D, textureID);
-	mesh.Draw(vertexPositionAttribute, vertexNormalAttribute, vertexTexcoordAttribute);
+	if(mazeBaked && view.mazeRevision == bakedRevision) return;
+	mazeMesher.update(view.maze);
+	mazeChunks.update(mazeMesher);
+	bakedRevision = view.mazeRevision;
+	mazeBaked = true;
 }
 
-// Drawing cubes
-void drawCubes()
+// Queueing the baked chunks in a range of the chunk grid
+struct ChunkDrawer
 {
-	// For each grid cell
-	for(int i = 0; i < N; i++)
-	for(int j = 0; j < M; j++)
+	void operator()(int i0, int j0, int i1, int j1)
 	{
-		if(isBlock(i, j))
-		{
-			// Cube position and size
-			Matrix4x4 m;
-			m.translate(cubeSize * j, -cubeSize * 0.5f, cubeSize * i);
-			m.scale(cubeSize * 0.5f, cubeSize * 0.5f, cubeSize * 0.5f);
-
-			// Draw cube
-			drawMesh(cube, m, cubeTextureID);
-		}
+		for(int ci = i0; ci < i1; ci++)
+		for(int cj = j0; cj < j1; cj++)
+			mazeChunks.add(ci * mazeMesher.getChunkCols() + cj);
 	}
+};
+
+// Drawing cubes, all baked chunks in view in one call
+void drawCubes()
+{
+	// Chunks are in world space
+	Matrix4x4 identity;
+	setModelMatrix(identity);
+	setTexture(cubeTextureID, cubeLayer);
+
+	// Plain attribute state, not that of a mesh's vertex array object
+	if(GLEW_VERSION_3_0 || GLEW_ARB_vertex_array_object) glBindVertexArray(0);
+	glEnableVertexAttribArray(vertexPositionAttribute);
+	if(vertexNormalAttribute != (GLuint)-1) glEnableVertexAttribArray(vertexNormalAttribute);
+	if(vertexTexcoordAttribute != (GLuint)-1) glEnableVertexAttribArray(vertexTexcoordAttribute);
+
+	// Chunk grid culled hierarchically, chunk (ci, cj) starts half a cell before cell (chunkSize * ci, chunkSize * cj)
+	ChunkDrawer drawer;
+	float chunkLength = cubeSize * MazeMesher::chunkSize;
+	cullCounters.boxesTested += frustum.visitGrid(mazeMesher.getChunkRows(), mazeMesher.getChunkCols(),
+		-cubeSize * 0.5f, -cubeSize * 0.5f, chunkLength, -cubeSize, 0, drawer);
+	cullCounters.chunksDrawn = mazeChunks.draw(vertexPositionAttribute, vertexNormalAttribute, vertexTexcoordAttribute);
+	cullCounters.chunksCulled = mazeChunks.getChunkCount() - cullCounters.chunksDrawn;
+
+	glDisableVertexAttribArray(vertexPositionAttribute);
+	if(vertexNormalAttribute != (GLuint)-1) glDisableVertexAttribArray(vertexNormalAttribute);
+	if(vertexTexcoordAttribute != (GLuint)-1) glDisableVertexAttribArray(vertexTexcoordAttribute);
 }
 
-// Drawing coins
-void drawCoins()
+// Gathering or drawing the coins in a range of maze cells
+struct CoinDrawer
 {
-	// For each grid cell
-	for(int i = 0; i < N; i++)
-	for(int j = 0; j < M; j++)
+	void operator()(int i0, int j0, int i1, int j1)
 	{
-		if(isTarget(i, j))
+		MazeGrid & maze = view.maze;
+		for(int i = i0; i < i1; i++)
+		for(int j = j0; j < j1; j++)
 		{
+			if(!maze.isTarget(i, j)) continue;
+
+			// One draw call for all instances later
+			if(instancing)
+			{
+				addInstance(cubeSize * j, coinHeight, cubeSize * i, coinSize);
+				cullCounters.coinsDrawn++;
+				continue;
+			}
+
 			// Coin position and size
 			Matrix4x4 m;
 			m.translate(cubeSize * j, coinHeight, cubeSize * i);
 			m.scale(coinSize, coinSize, coinSize);
 
-			// Draw coin
-			drawMesh(coin, m, coinTextureID);
+			// Queue coin, its cell was already tested
+			renderQueue.push(coin, coinMaterial, m);
+			cullCounters.coinsDrawn++;
 		}
 	}
-}
+};
 
-// Drawing ball
-void drawBall()
+// Drawing coins in view
+void drawCoins()
 {
-	if(!shooting) return;
-
-	// Ball position and size
-	Matrix4x4 m;
-	m.translate(ballPosition.x, ballPosition.y, ballPosition.z);
-	m.scale(ballSize, ballSize, ballSize);
+	// Height the scaled coin mesh reaches around its cell centre
+	float reach = coinSize * (fabsf(coin.getBoundingCenter().y) + coin.getBoundingRadius());
+
+	// Cells culled hierarchically
+	CoinDrawer drawer;
+	instanceData.clear();
+	cullCounters.boxesTested += frustum.visitGrid(view.maze.getRows(), view.maze.getCols(),
+		-cubeSize * 0.5f, -cubeSize * 0.5f, cubeSize, coinHeight - reach, coinHeight + reach, drawer);
+	cullCounters.coinsCulled = view.maze.countTargets() - cullCounters.coinsDrawn;
+
+	// Visible coins in one call
+	if(instancing && !instanceData.empty())
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, coinInstanceBuffer);
+		glBufferData(GL_ARRAY_BUFFER, instanceData.size() * sizeof(GLfloat), &instanceData[0], GL_STREAM_DRAW);
+		drawInstances(coin, coinInstanceBuffer, instanceData.size() / 4, coinTextureID, coinLayer);
+	}
+}
 
-	// Draw ball
-	drawMesh(ball, m, ballTextureID);
+// Drawing balls
+void drawBalls()
+{
+	ProjectilePool & balls = view.balls;
+	for(int k = 0; k < balls.getCount(); k++)
+	{
+		// Ball position and size
+		Matrix4x4 m;
+		m.translate(balls.positionX[k], balls.positionY[k], balls.positionZ[k]);
+		m.scale(ballSize, ballSize, ballSize);
+
+		// Level from the size alone, the pool moves balls between slots as others are removed so no state follows a ball
+		int level = 0;
+		drawMesh(ball, m, ballMaterial, level);
+	}
 }
 
 // Drawing tank
@@ -545,32 +618,32 @@ void drawTank()
 {
 	// Draw chassis
 	Matrix4x4 tankMatrix;
-	tankMatrix.translate(tankPosition.x, tankPosition.y, tankPosition.z);
-	tankMatrix.rotate(tankAngle, 0, 1, 0);
-	drawMesh(chassis, tankMatrix, tankTextureID);
+	tankMatrix.translate(view.tankPosition.x, view.tankPosition.y, view.tankPosition.z);
+	tankMatrix.rotate(view.tankAngle, 0, 1, 0);
+	drawMesh(chassis, tankMatrix, tankMaterial, chassisLevel);
 
 	// Wheel angle according to distance travelled
 	const float wheelRadius = 0.5f;
-	float wheelAngle = radiansToDegrees(tankDistanceTravelled / wheelRadius);
+	float wheelAngle = radiansToDegrees(view.tankDistanceTravelled / wheelRadius);
 
 	// Draw front wheel
 	Matrix4x4 frontWheelMatrix = tankMatrix;
 	rotateAroundPoint(frontWheelMatrix, frontWheel.getMeshCentroid(), wheelAngle);
-	drawMesh(frontWheel, frontWheelMatrix, tankTextureID);
+	drawMesh(frontWheel, frontWheelMatrix, tankMaterial, frontWheelLevel);
 
 	// Draw back wheel
 	Matrix4x4 backWheelMatrix = tankMatrix;
 	rotateAroundPoint(backWheelMatrix, backWheel.getMeshCentroid(), wheelAngle);
-	drawMesh(backWheel, backWheelMatrix, tankTextureID);
+	drawMesh(backWheel, backWheelMatrix, tankMaterial, backWheelLevel);
 
 	// Draw turret
 	Matrix4x4 turretMatrix = tankMatrix;
 	float turretAngle = radiansToDegrees(cameraManip.getPan()) + 90;
 	turretMatrix.rotate(turretAngle, 0, 1, 0);
-	drawMesh(turret, turretMatrix, tankTextureID);
+	drawMesh(turret, turretMatrix, tankMaterial, turretLevel);
 }
 
-void drawHUD(float x, float y, std::string text)
+void drawHUD(float x, float y, const char * text)
 {
 	// Position and size
 	glLoadIdentity();
@@ -579,18 +652,34 @@ void drawHUD(float x, float y, std::string text)
 	glLineWidth(3);
 
 	// Draw text
-	int length = text.length();
-	for(int i = 0; i < length; i++)
+	for(const char * c = text; *c; c++)
 	{
-		glutStrokeCharacter(GLUT_STROKE_ROMAN, text[i]);
+		glutStrokeCharacter(GLUT_STROKE_ROMAN, *c);
 	}
 }
 
+// Setting HUD line, rebuilt only when it changed, stroked directly when there is no atlas
+void setHUD(int slot, float x, float y, const char * text)
+{
+	if(hudText.hasAtlas())
+		hudText.setText(slot, x, y, text);
+	else if(*text)
+		drawHUD(x, y, text);
+}
+
 // Display loop
 void display(void)
 {
-	// Handle keys
+	// Handle keys and pick up the latest simulation state
 	handleKeys();
+	simThread.getView(view);
+
+	// Glyph atlas drawn on the first frame, before the frame is cleared
+	if(!hudAtlasTried)
+	{
+		hudAtlasTried = true;
+		if(!hudText.buildAtlas()) std::cout << "Error building HUD atlas, window smaller than the atlas" << std::endl;
+	}
 
 	// Set viewport
 	glViewport(0, 0, screenWidth, screenHeight);
@@ -599,58 +688,75 @@ void display(void)
 	glClearColor(0.4f, 0.5f, 0.6f, 1);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	// Enable shaders
+	// Enable shaders, single draws use the identity instance transform
 	glUseProgram(shaderProgramID);
+	if(vertexInstanceAttribute != -1) glVertexAttrib4f(vertexInstanceAttribute, 0, 0, 0, 1);
+	bakeMaze();
 
 	// Set perspective projection matrix
 	Matrix4x4 ProjectionMatrix;
 	float fieldOfView = 90;
 	float aspectRatio = float(screenWidth) / screenHeight;
 	ProjectionMatrix.perspective(fieldOfView, aspectRatio, 0.1f, 1000);
-	glUniformMatrix4fv(
-		ProjectionUniformLocation,  // Uniform location
-		1,                          // Number of uniforms
-		false,                      // Transpose matrix
-		ProjectionMatrix.getPtr()); // Pointer to matrix values
 
-	// Enable texture mapping
-	glUniform1i(TextureMapUniformLocation, 0);
+	// Camera, frustum, light and projection for this frame
+	setView(ProjectionMatrix);
 
-	// Set non-shiny light for cubes
-	glUniform3f(LightPositionUniformLocation, lightPosition.x, lightPosition.y, lightPosition.z);
-	glUniform4f(AmbientUniformLocation, ambient.x, ambient.y, ambient.z, 1);
+	// Set non-shiny material for cubes
 	glUniform4f(SpecularUniformLocation, 0, 0, 0, 1);
-	glUniform1f(SpecularPowerUniformLocation, specularPower);
 
 	// Draw non-shiny objects
 	drawCubes();
 
-	// Set shiny light for other objects
+	// Set shiny material for other objects
 	glUniform4f(SpecularUniformLocation, specular.x, specular.y, specular.z, 1);
 
-	// Draw shiny objects
+	// Draw shiny objects, meshes are queued and drawn sorted by state
 	drawCoins();
 	drawTank();
-	drawBall();
+	drawBalls();
+	renderQueue.submit();
 
 	// Disable shaders
 	glUseProgram(0);
 
-	// Show time and score
-	std::stringstream stream1, stream2;
-	stream1.precision(2);
-	stream1 << std::fixed << "Time: " << timeRemaining;
-	stream2 << "Score: " << collectedCoins << "/" << totalCoins;
-	drawHUD(-0.8f, 0.8f, stream1.str());
-	drawHUD(+0.1f, 0.8f, stream2.str());
+	// Show time and score, formatted without allocating
+	char line[TextRenderer::maxLength + 1];
+	snprintf(line, sizeof(line), "Time: %.2f", view.timeRemaining);
+	setHUD(hudTime, -0.8f, 0.8f, line);
+	snprintf(line, sizeof(line), "Score: %d/%d", view.collectedCoins, view.totalCoins);
+	setHUD(hudScore, +0.1f, 0.8f, line);
 
-	// Show win/lose message
-	if(gameOver)
+	// Show culling and render queue counters
+	if(showCounters)
+	{
+		snprintf(line, sizeof(line), "Chunks %d/%d Coins %d/%d Meshes %d/%d (%d tris) Tests %d",
+			cullCounters.chunksDrawn, cullCounters.chunksDrawn + cullCounters.chunksCulled,
+			cullCounters.coinsDrawn, cullCounters.coinsDrawn + cullCounters.coinsCulled,
+			cullCounters.meshesDrawn, cullCounters.meshesDrawn + cullCounters.meshesCulled,
+			cullCounters.meshTriangles, cullCounters.boxesTested);
+		setHUD(hudCounters, -0.95f, -0.8f, line);
+
+		// State changes the sorted queue did not need
+		const RenderQueue::Stats & stats = renderQueue.getStats();
+		snprintf(line, sizeof(line), "Queued %d avoided: program %d texture %d layer %d material %d mesh %d",
+			stats.items, stats.programBindsAvoided, stats.textureBindsAvoided, stats.layerSetsAvoided,
+			stats.materialSetsAvoided, stats.meshBindsAvoided);
+		setHUD(hudQueue, -0.95f, -0.9f, line);
+	}
+	else
 	{
-		drawHUD(-0.20f, 0.5f, gameOverMessage);
-		drawHUD(-0.55f, 0.3f, "press Space to continue");
+		setHUD(hudCounters, -0.95f, -0.8f, "");
+		setHUD(hudQueue, -0.95f, -0.9f, "");
 	}
 
+	// Show win/lose message
+	setHUD(hudMessage, -0.20f, 0.5f, view.gameOver ? view.gameOverMessage : "");
+	setHUD(hudContinue, -0.55f, 0.3f, view.gameOver ? "press Space to continue" : "");
+
+	// All HUD lines in one call
+	hudText.draw();
+
 	// Swap buffers and post redisplay
 	glutSwapBuffers();
 	glutPostRedisplay();
@@ -663,7 +769,10 @@ void keyboard(unsigned char key, int x, int y)
 	if(key == 27) exit(0);
 
 	// Restart game
-	if(key == ' ') restart();
+	if(key == ' ') simThread.restart();
+
+	// Toggle culling and render queue counters
+	if(key == 'c') showCounters = !showCounters;
 
 	// Set key status
 	keyStates[key] = true;
@@ -679,49 +788,36 @@ void keyUp(unsigned char key, int x, int y)
 void handleKeys()
 {
 	// Tank acceleration and deceleration
-	tankAccelerating = keyStates['w'];
-	tankDecelerating = keyStates['s'];
+	inputs.accelerate = keyStates['w'];
+	inputs.decelerate = keyStates['s'];
 
 	// Tank turning
-	tankTurningLeft = keyStates['a'];
-	tankTurningRight = keyStates['d'];
+	inputs.turnLeft = keyStates['a'];
+	inputs.turnRight = keyStates['d'];
+
+	// Turret follows camera
+	inputs.turretPan = cameraManip.getPan();
+	simThread.setInputs(inputs);
 }
 
 // Mouse interaction
 void mouse(int button, int state, int x, int y)
 {
-	// Shoot ball on left mouse button
-	if(button == GLUT_LEFT_BUTTON && state == GLUT_DOWN && !gameOver) shootBall();
+	// Shoot ball on left mouse button at the next step
+	if(button == GLUT_LEFT_BUTTON && state == GLUT_DOWN && !view.gameOver) simThread.shoot();
 }
 
 // Motion
 void motion(int x, int y)
 {
-	if(!gameOver) cameraManip.handleMouseMotion(x, y);
+	if(!view.gameOver) cameraManip.handleMouseMotion(x, y);
 }
 
-// Timer Function
-void Timer(int value)
+// Save recorded session
+void saveReplay()
 {
-	// Update tank and ball
-	float timeStep = 0.01f;
-	if(!gameOver) updateTank(timeStep);
-	updateBall(timeStep);
-
-	if(!gameOver)
-	{
-		// Update timer
-		timeRemaining -= timeStep;
-
-		// Losing condition
-		if(timeRemaining < 0)
-		{
-			timeRemaining = 0;
-			gameOver = true;
-			gameOverMessage = "YOU LOSE!";
-		}
-	}
-
-	// Call function again after 10 milliseconds
-	glutTimerFunc(10, Timer, 0);
+	simThread.stop();
+	replay.finish(sim);
+	if(replay.save(replayFile))
+		std::cout << "Session saved to " << replayFile << ", " << replay.getTickCount() << " ticks" << std::endl;
 }